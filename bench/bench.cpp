@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <net/ancillarycat/waver/waver.hpp>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "vcd_generator.hpp"
+
+namespace {
+using namespace net::ancillarycat::waver;
+using bench::generated;
+using bench::vcd_generator;
+using bench::workload;
+
+/// @brief the files the benchmarks write to the temporary directory, removed when the process exits
+std::filesystem::path temporary(std::filesystem::path path) {
+  static struct files {
+    std::vector<std::filesystem::path> paths;
+    ~files() {
+      for (const auto &path : paths)
+        if (auto error = std::error_code{}; not std::filesystem::remove(path, error) and error)
+          std::cerr << "Failed to remove " << path << ": " << error.message() << '\n';
+    }
+  } written;
+  return written.paths.emplace_back(std::move(path));
+}
+
+/// @brief the shapes of dump, besides their size: the default, a deep hierarchy of scalars, a flat one of wide
+///        buses, and rare and frequent changes
+constexpr workload shapes[] = {
+  {}, {.depth = 6, .max_width = 1}, {.depth = 1, .max_width = 256}, {.density = 0.005}, {.density = 0.5},
+};
+
+/// @brief a synthetic dump of about `bytes` bytes, of one of the shapes, written to the temporary directory once
+///        per process
+struct fixture {
+  std::filesystem::path path;
+  generated             stats;
+};
+
+const fixture &dump_of_size(const std::size_t bytes, const std::size_t shape = 0) {
+  static auto fixtures = std::map<std::pair<std::size_t, std::size_t>, fixture>{};
+  if (const auto it = fixtures.find({bytes, shape}); it != fixtures.end())
+    return it->second;
+
+  auto load = shapes[shape];
+  // keep the header a small part of the smaller dumps
+  load.signals    = std::clamp(bytes / 512, std::size_t{8}, std::size_t{1000});
+  load.timestamps = std::numeric_limits<std::size_t>::max();
+  load.max_bytes  = bytes;
+  const auto path  = temporary(std::filesystem::temp_directory_path() /
+                              ("waver_bench_" + std::to_string(bytes) + "_" + std::to_string(shape) + ".vcd"));
+  auto       file  = std::ofstream{path, std::ios::binary};
+  const auto stats = vcd_generator{load}.write(file);
+  return fixtures[{bytes, shape}] = {path, stats};
+}
+
+/// @brief report both MB/s and changes/s for `iterations` passes over `dump`
+void report(benchmark::State &state, const fixture &dump) {
+  state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(dump.stats.bytes));
+  state.counters["changes"] = benchmark::Counter(
+    static_cast<double>(state.iterations()) * static_cast<double>(dump.stats.changes), benchmark::Counter::kIsRate);
+}
+
+/// @brief a stream that discards everything, so that serialization is measured without the I/O
+class null_buffer : public std::streambuf {
+protected:
+  std::streamsize xsputn(const char *, const std::streamsize count) override { return count; }
+  int_type        overflow(const int_type c) override { return traits_type::not_eof(c); }
+};
+
+void BM_get_contents(benchmark::State &state) {
+  const auto &dump = dump_of_size(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(file_reader<>{dump.path}.get_contents());
+  report(state, dump);
+}
+
+void BM_lex(benchmark::State &state) {
+  const auto &dump     = dump_of_size(static_cast<std::size_t>(state.range(0)));
+  const auto  contents = file_reader<>{dump.path}.get_contents();
+  for (auto _ : state) {
+    auto tokens = lexer<>{};
+    (void)tokens.borrow(contents);
+    benchmark::DoNotOptimize(tokens.lex());
+  }
+  report(state, dump);
+}
+
+/// @brief a parse into the model, on `threads` workers, of a dump of one of the shapes
+void BM_parse(benchmark::State &state) {
+  const auto  shape   = static_cast<std::size_t>(state.range(2));
+  const auto &dump    = dump_of_size(static_cast<std::size_t>(state.range(0)), shape);
+  const auto  options = parse_options{.threads = static_cast<std::size_t>(state.range(1))};
+  for (auto _ : state) {
+    auto vcd = value_change_dump::parse(dump.path, options);
+    if (not vcd.ok())
+      state.SkipWithError(vcd.status().ToString().c_str());
+    benchmark::DoNotOptimize(vcd);
+  }
+  report(state, dump);
+}
+
+/// @brief like BM_parse on one thread, with the model on an arena freed at once after every iteration
+void BM_parse_arena(benchmark::State &state) {
+  const auto &dump   = dump_of_size(static_cast<std::size_t>(state.range(0)));
+  auto        memory = arena{};
+  auto        used   = std::size_t{0};
+  for (auto _ : state) {
+    {
+      auto vcd = value_change_dump::parse(dump.path, {.memory = &memory});
+      if (not vcd.ok())
+        state.SkipWithError(vcd.status().ToString().c_str());
+      benchmark::DoNotOptimize(vcd);
+    }
+    used = memory.used();
+    memory.release();
+  }
+  state.counters["arena_bytes"] = static_cast<double>(used);
+  report(state, dump);
+}
+
+/// @brief visit every change through the generator, without building the model
+void BM_stream(benchmark::State &state) {
+  const auto &dump = dump_of_size(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    auto changes = std::size_t{0};
+    for (auto &&item : value_change_dump::stream(dump.path)) {
+      if (const auto *error = std::get_if<Status>(&item)) {
+        state.SkipWithError(error->ToString().c_str());
+        break;
+      }
+      changes += std::holds_alternative<change_view>(item);
+    }
+    benchmark::DoNotOptimize(changes);
+  }
+  report(state, dump);
+}
+
+void BM_parse_handler(benchmark::State &state) {
+  struct counter {
+    WAVER_FORCEINLINE void on_change(signal_id_t, std::string_view) noexcept { ++changes; }
+    std::size_t            changes = 0;
+  };
+  const auto &dump = dump_of_size(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    auto handler = counter{};
+    if (const auto res = value_change_dump::parse(dump.path, handler); not res.ok())
+      state.SkipWithError(res.ToString().c_str());
+    benchmark::DoNotOptimize(handler.changes);
+  }
+  report(state, dump);
+}
+
+/// @brief the value change section through the body_scanner (`scanner` 1) or the lexer and the token parser (0), on
+///        one thread, into the model and into a handler that only counts the changes (`model` 0)
+void BM_parse_body(benchmark::State &state) {
+  struct counter {
+    WAVER_FORCEINLINE void on_change(signal_id_t, std::string_view) noexcept { ++changes; }
+    std::size_t            changes = 0;
+  };
+  const auto &dump    = dump_of_size(static_cast<std::size_t>(state.range(0)));
+  const auto  options = parse_options{.byte_scanner = state.range(1) != 0};
+  for (auto _ : state) {
+    if (state.range(2)) {
+      auto vcd = value_change_dump::parse(dump.path, options);
+      if (not vcd.ok())
+        state.SkipWithError(vcd.status().ToString().c_str());
+      benchmark::DoNotOptimize(vcd);
+    } else {
+      auto handler = counter{};
+      if (const auto res = value_change_dump::parse(dump.path, handler, options); not res.ok())
+        state.SkipWithError(res.ToString().c_str());
+      benchmark::DoNotOptimize(handler.changes);
+    }
+  }
+  report(state, dump);
+}
+
+void BM_to_json(benchmark::State &state) {
+  const auto &dump = dump_of_size(static_cast<std::size_t>(state.range(0)));
+  const auto  vcd  = value_change_dump::parse(dump.path);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(vcd->as_json().dump());
+  report(state, dump);
+}
+
+void BM_write_json(benchmark::State &state) {
+  const auto &dump   = dump_of_size(static_cast<std::size_t>(state.range(0)));
+  const auto  vcd    = value_change_dump::parse(dump.path);
+  auto        buffer = null_buffer{};
+  auto        output = std::ostream{&buffer};
+  for (auto _ : state)
+    vcd->write_json(output);
+  report(state, dump);
+}
+
+/// @brief the database of a dump, written once per process
+const std::filesystem::path &database_of(const fixture &dump) {
+  static auto databases = std::map<std::filesystem::path, std::filesystem::path>{};
+  if (const auto it = databases.find(dump.path); it != databases.end())
+    return it->second;
+  auto path = temporary(std::filesystem::path{dump.path}.replace_extension(".wdb"));
+  if (const auto vcd = value_change_dump::parse(dump.path); vcd.ok())
+    (void)waveform_db::write(*vcd, path);
+  return databases[dump.path] = std::move(path);
+}
+
+/// @brief reopen a converted dump and query the last value of every signal
+void BM_db_open(benchmark::State &state) {
+  const auto &dump = dump_of_size(static_cast<std::size_t>(state.range(0)));
+  const auto &path = database_of(dump);
+  for (auto _ : state) {
+    const auto db = waveform_db::open(path);
+    if (not db.ok()) {
+      state.SkipWithError(db.status().ToString().c_str());
+      break;
+    }
+    for (signal_id_t signal = 0; signal < db->signal_count(); ++signal)
+      benchmark::DoNotOptimize(db->value_at(signal, std::numeric_limits<std::size_t>::max()));
+  }
+  report(state, dump);
+}
+
+void BM_db_to_dump(benchmark::State &state) {
+  const auto &dump = dump_of_size(static_cast<std::size_t>(state.range(0)));
+  const auto  db   = waveform_db::open(database_of(dump));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(db->to_dump());
+  report(state, dump);
+}
+
+/// @brief open a scope with up to 16 ports and, up to 4 levels deep, 16 subscopes, until `declarations` ports are
+///        declared; every other port is an alias of one of the parent scope, as a port passed down to an instance is
+void declare(scope_table &scopes, const std::size_t declarations, const std::size_t depth, const signal_id_t inherited,
+             signal_id_t &signals) {
+  scopes.open(scope_kind::kModule, "u" + std::to_string(scopes.size()));
+  const auto first = signals;
+  for (auto port = 0u; port < 16 and scopes.ports().size() < declarations; ++port)
+    scopes.add_port(port::kWire, 1, port % 2 ? inherited + port / 2 : signals++, "p" + std::to_string(port), {});
+  for (auto child = 0; child < 16 and depth < 4 and scopes.ports().size() < declarations; ++child)
+    declare(scopes, declarations, depth + 1, first, signals);
+  scopes.close();
+}
+
+/// @brief a hierarchy of `declarations` ports, built once per process
+const scope_table &hierarchy_of(const std::size_t declarations) {
+  static auto hierarchies = std::map<std::size_t, scope_table>{};
+  if (const auto it = hierarchies.find(declarations); it != hierarchies.end())
+    return it->second;
+  auto &scopes  = hierarchies[declarations];
+  auto  signals = signal_id_t{0};
+  while (scopes.ports().size() < declarations)
+    declare(scopes, declarations, 0, 0, signals);
+  return scopes;
+}
+
+void BM_name_index(benchmark::State &state) {
+  const auto &scopes = hierarchy_of(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(name_index{scopes});
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(scopes.ports().size()));
+}
+
+/// @brief look up every declared path, through the index and by walking the scopes
+void BM_name_lookup(benchmark::State &state) {
+  const auto &scopes = hierarchy_of(static_cast<std::size_t>(state.range(0)));
+  const auto  names  = name_index{scopes};
+  const auto  paths  = [&] {
+    auto result = std::vector<std::string>{};
+    for (const auto &declaration : names.all())
+      result.emplace_back(names.path(declaration));
+    return result;
+  }();
+  for (auto _ : state)
+    for (const auto &path : paths)
+      if (state.range(1))
+        benchmark::DoNotOptimize(names.find(path));
+      else
+        benchmark::DoNotOptimize(scopes.find_port(path));
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(paths.size()));
+}
+
+/// @brief the largest dump, `WAVER_BENCH_MAX_BYTES` or 64 MiB; raise it to benchmark tens of GB
+std::int64_t max_bytes() {
+  const auto *const limit = std::getenv("WAVER_BENCH_MAX_BYTES");
+  return limit ? std::strtoll(limit, nullptr, 10) : std::int64_t{64} << 20;
+}
+/// @brief 1 KiB up to max_bytes() in steps of 8x
+void sizes(benchmark::internal::Benchmark *benchmark) {
+  for (auto bytes = std::int64_t{1} << 10; bytes <= max_bytes(); bytes *= 8)
+    benchmark->Arg(bytes);
+}
+/// @brief sizes() with a serial and a parallel (one worker per hardware thread) parse of each of the shapes
+void sizes_threads_and_shapes(benchmark::internal::Benchmark *benchmark) {
+  benchmark->ArgNames({"bytes", "threads", "shape"});
+  for (auto bytes = std::int64_t{1} << 10; bytes <= max_bytes(); bytes *= 8)
+    for (auto shape = std::int64_t{0}; shape < std::ssize(shapes); ++shape)
+      for (const auto threads : {1, 0})
+        benchmark->Args({bytes, threads, shape});
+}
+/// @brief sizes() with the lexer and the body_scanner, into a handler and into the model each
+void sizes_and_paths(benchmark::internal::Benchmark *benchmark) {
+  benchmark->ArgNames({"bytes", "scanner", "model"});
+  for (auto bytes = std::int64_t{1} << 10; bytes <= max_bytes(); bytes *= 8)
+    for (const auto model : {0, 1})
+      for (const auto scanner : {0, 1})
+        benchmark->Args({bytes, scanner, model});
+}
+} // namespace
+
+BENCHMARK(BM_get_contents)->Apply(sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_lex)->Apply(sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_parse)->Apply(sizes_threads_and_shapes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_parse_arena)->Apply(sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_stream)->Apply(sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_parse_handler)->Apply(sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_parse_body)->Apply(sizes_and_paths)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_to_json)->Apply(sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_write_json)->Apply(sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_db_open)->Apply(sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_db_to_dump)->Apply(sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_name_index)->RangeMultiplier(32)->Range(1 << 10, 1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_name_lookup)->ArgNames({"declarations", "indexed"})->ArgsProduct({{1 << 10, 1 << 15, 1 << 20}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,158 @@
+/**************************************************************************************
+ * @file vcd_generator.hpp
+ * @brief deterministic generator of synthetic VCD workloads for the benchmarks.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace net::ancillarycat::waver::bench {
+/// @brief the shape of a synthetic dump
+struct workload {
+  using size_type = std::size_t;
+
+  /// @brief levels of nested scopes; the signals are spread over the leaves of a binary tree this deep
+  size_type depth = 3;
+  /// @brief number of distinct signals
+  size_type signals = 1000;
+  /// @brief widest bus; about half of the signals are scalars, the rest are 2 to max_width bits wide
+  size_type max_width = 64;
+  /// @brief changes per timestamp, as a fraction of the signal count
+  double density = 0.05;
+  /// @brief number of `#` timestamps
+  size_type timestamps = 1000;
+  /// @brief stop once at least this many bytes have been written, 0 for no limit
+  size_type max_bytes = 0;
+  /// @brief seed of the generator; the same workload always yields the same bytes
+  std::uint64_t seed = 0x5eed;
+};
+
+/// @brief what a generator run produced
+struct generated {
+  std::size_t bytes   = 0;
+  std::size_t changes = 0;
+};
+
+/// @brief writes the dump described by a workload
+class vcd_generator {
+public:
+  using size_type = std::size_t;
+  using string_t  = std::string;
+
+public:
+  inline explicit vcd_generator(const workload &load) : load(load), state(load.seed) {
+    widths.reserve(load.signals);
+    for (size_type i = 0; i < load.signals; ++i)
+      widths.emplace_back(load.max_width < 2 or next() % 2 ? 1 : 2 + next() % (load.max_width - 1));
+  }
+
+public:
+  /// @brief write the whole dump to `output`
+  inline generated write(std::ostream &output) {
+    auto result = generated{};
+    auto buffer = string_t{};
+    const auto flush = [&] {
+      output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+      result.bytes += buffer.size();
+      buffer.clear();
+    };
+
+    buffer.append("$version waver vcd_generator $end\n$timescale 1ns $end\n");
+    auto next_signal = size_type{0};
+    write_scope(buffer, 0, 0, next_signal);
+    buffer.append("$enddefinitions $end\n$dumpvars\n");
+    for (size_type signal = 0; signal < load.signals; ++signal)
+      write_value(buffer, signal, 'x');
+    buffer.append("$end\n");
+    flush();
+
+    const auto per_timestamp = static_cast<size_type>(static_cast<double>(load.signals) * load.density) + 1;
+    const auto limit         = load.max_bytes ? load.max_bytes : std::numeric_limits<size_type>::max();
+    for (size_type time = 1; time <= load.timestamps and result.bytes + buffer.size() < limit; ++time) {
+      buffer.push_back('#');
+      buffer.append(std::to_string(time * 10)).push_back('\n');
+      for (size_type i = 0; i < per_timestamp; ++i)
+        write_value(buffer, next() % load.signals, 0);
+      result.changes += per_timestamp;
+      if (buffer.size() >= buffer_size)
+        flush();
+    }
+    flush();
+    return result;
+  }
+
+  /// @brief the whole dump as a string
+  inline string_t to_string() {
+    auto output = std::ostringstream{};
+    write(output);
+    return std::move(output).str();
+  }
+
+  /// @brief the identifier code of a signal, the inverse of signal_table::decode
+  inline static string_t code(size_type signal) {
+    auto code = string_t{};
+    for (++signal; signal; signal = (signal - 1) / 94)
+      code.push_back(static_cast<char>('!' + (signal - 1) % 94));
+    return code;
+  }
+
+private:
+  static inline constexpr size_type buffer_size = size_type{1} << 20;
+
+  /// @brief splitmix64, fixed so that the output does not depend on the standard library
+  inline std::uint64_t next() noexcept {
+    auto z = state += 0x9e3779b97f4a7c15;
+    z      = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z      = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+
+  inline void write_scope(string_t &buffer, const size_type level, const size_type index, size_type &next_signal) {
+    buffer.append("$scope module ").append(level ? "u" + std::to_string(index) : "top").append(" $end\n");
+    if (level + 1 >= load.depth) {
+      // a leaf takes its share of the signals
+      const auto leaves = size_type{1} << (load.depth ? load.depth - 1 : 0);
+      const auto last   = load.signals * (index + 1) / leaves;
+      for (; next_signal < last; ++next_signal) {
+        const auto width = widths[next_signal];
+        buffer.append("$var wire ").append(std::to_string(width)).push_back(' ');
+        buffer.append(code(next_signal)).append(" s").append(std::to_string(next_signal));
+        if (width > 1)
+          buffer.append(" [").append(std::to_string(width - 1)).append(":0]");
+        buffer.append(" $end\n");
+      }
+    } else {
+      write_scope(buffer, level + 1, index * 2, next_signal);
+      write_scope(buffer, level + 1, index * 2 + 1, next_signal);
+    }
+    buffer.append("$upscope $end\n");
+  }
+
+  /// @brief write a change of `signal`, every bit being `digit`, or random 0/1 if `digit` is 0
+  inline void write_value(string_t &buffer, const size_type signal, const char digit) {
+    const auto width = widths[signal];
+    if (width > 1)
+      buffer.push_back('b');
+    auto bits = next();
+    for (size_type i = 0; i < width; ++i, bits >>= 1) {
+      if (i % 64 == 63)
+        bits = next();
+      buffer.push_back(digit ? digit : static_cast<char>('0' + (bits & 1)));
+    }
+    if (width > 1)
+      buffer.push_back(' ');
+    buffer.append(code(signal)).push_back('\n');
+  }
+
+private:
+  const workload         load;
+  std::uint64_t          state;
+  std::vector<size_type> widths;
+};
+} // namespace net::ancillarycat::waver::bench
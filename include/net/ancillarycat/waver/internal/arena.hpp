@@ -0,0 +1,71 @@
+/**************************************************************************************
+ * @file arena.hpp
+ * @brief a monotonic memory resource with a cap, to build a dump on and free it at once.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <new>
+#include "config.hpp"
+
+namespace net::ancillarycat::waver {
+/// @brief hands out memory from a few growing blocks, counts it, and refuses to hand out more than its limit
+/// @note set as parse_options::memory, the whole model of a dump is carved out of the arena: there is no allocation
+///       per scope, port or growth of the event log from the global heap, and release() frees all of it at once.
+///       Deallocating is a no-op, so the buffers a growing vector leaves behind stay until release() as well; the
+///       peak is higher than on the default resource in exchange.
+/// @note allocating past limit() throws std::bad_alloc, which value_change_dump::parse() reports as a
+///       resource-exhausted status. Not thread-safe, like std::pmr::monotonic_buffer_resource.
+/// @warning whatever was allocated from the arena, e.g. a dump, has to be destroyed before release() is called or
+///          the arena is destroyed.
+class arena final : public std::pmr::memory_resource {
+public:
+  using size_type = std::size_t;
+
+  /// @brief the limit of an arena that may grow as long as its upstream does
+  static inline constexpr auto unlimited = std::numeric_limits<size_type>::max();
+  /// @brief the size of the first block taken from upstream; each following one is larger
+  static inline constexpr size_type initial_block_size = size_type{1} << 16;
+
+public:
+  /// @param limit the most bytes handed out between two release()s
+  /// @param upstream where the blocks come from
+  inline explicit arena(const size_type limit = unlimited,
+                        std::pmr::memory_resource *const upstream = std::pmr::new_delete_resource()) noexcept :
+      cap(limit), blocks(initial_block_size, upstream) {}
+  inline arena(const arena &)            = delete;
+  inline arena &operator=(const arena &) = delete;
+  inline ~arena() noexcept override      = default;
+
+public:
+  /// @brief free everything allocated so far, and start counting from 0 again
+  inline void release() noexcept {
+    blocks.release();
+    allocated = 0;
+  }
+
+  /// @brief the bytes handed out since construction or the last release(), not counting alignment
+  WAVER_NODISCARD inline size_type used() const noexcept { return allocated; }
+  WAVER_NODISCARD inline size_type limit() const noexcept { return cap; }
+
+private:
+  inline void *do_allocate(const size_type bytes, const size_type alignment) override {
+    if (bytes > cap - allocated)
+      throw std::bad_alloc{};
+    auto *const memory = blocks.allocate(bytes, alignment);
+    allocated += bytes;
+    return memory;
+  }
+  inline void do_deallocate(void *, size_type, size_type) noexcept override {}
+  WAVER_NODISCARD inline bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+private:
+  size_type                           cap;
+  size_type                           allocated = 0;
+  std::pmr::monotonic_buffer_resource blocks;
+};
+} // namespace net::ancillarycat::waver
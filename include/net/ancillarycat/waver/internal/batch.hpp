@@ -0,0 +1,260 @@
+/**************************************************************************************
+ * @file batch.hpp
+ * @brief conversion of many dumps to JSON in one process, on a thread pool.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "arena.hpp"
+#include "config.hpp"
+#include "signal_filter.hpp"
+#include "thread_pool.hpp"
+#include "vcd.hpp"
+#include "waveform_db.hpp"
+
+namespace net::ancillarycat::waver {
+/// @brief converts dumps to JSON files, one file per task of a thread_pool
+/// @note every thread keeps the lexer buffers of the file it converted last and lexes the next file into them, so
+///       their capacity is grown once per thread rather than once per file. Likewise every thread builds its dumps on
+///       its own arena, released once the output is written.
+/// @note each file is parsed by a single thread; the parallelism is across files. The largest files are started
+///       first, so that a long one does not end up last on an otherwise idle pool.
+class batch {
+public:
+  using size_type     = std::size_t;
+  using path_t        = std::filesystem::path;
+  using string_t      = std::string;
+  using string_view_t = std::string_view;
+  using duration_t    = std::chrono::steady_clock::duration;
+
+  /// @brief the extensions of the files collect() takes from a directory
+  static inline constexpr auto extensions = std::array{".vcd"sv, ".vcd.gz"sv, ".vcd.zst"sv};
+
+  /// @brief a file to convert and where to write it
+  struct job {
+    path_t source;
+    path_t output;
+  };
+
+  /// @brief how the conversion of a job went
+  struct result {
+    path_t source;
+    path_t output;
+    Status status;
+    /// @brief the size of the source, and the number of value changes in it
+    size_type bytes   = 0;
+    size_type changes = 0;
+    /// @brief the time from starting to parse the source to having written the output
+    duration_t wall = {};
+  };
+
+public:
+  /// @param options see parse_options; `threads`, `stats` and `memory` are ignored
+  /// @param threads the size of the pool, 0 for one thread per hardware thread
+  /// @param memory_limit the most memory the model of one file may take, see arena
+  inline explicit batch(parse_options options = {}, const size_type threads = 0,
+                        const size_type memory_limit = arena::unlimited) :
+      options(std::move(options)), pool(threads), scratch(pool.size()), arenas(pool.size()) {
+    this->options.threads = 1;
+    this->options.stats   = nullptr;
+    this->options.memory  = nullptr;
+    for (auto &arena : arenas)
+      arena = std::make_unique<waver::arena>(memory_limit);
+  }
+
+public:
+  /// @brief the jobs `spec` stands for
+  /// @param spec a directory, whose files with one of `extensions` are converted; a path whose last component has
+  ///        `*` or `?` wildcards, matched against the names of the files in its directory; or a manifest, a text file
+  ///        listing one source per line, optionally followed by a tab and its output. Blank lines and lines starting
+  ///        with `#` are skipped, and relative paths are relative to the manifest.
+  /// @param output_directory where the outputs not named by a manifest go, next to their source if empty
+  /// @return the jobs, sorted by source unless listed in a manifest
+  WAVER_NODISCARD inline static absl::StatusOr<std::vector<job>> collect(const path_t &spec,
+                                                                         const path_t &output_directory = {});
+
+  /// @brief the output of `source` in `output_directory`: its name with `.json` for the extensions of a dump
+  WAVER_NODISCARD inline static path_t output_of(const path_t &source, const path_t &output_directory = {}) {
+    auto name = source.filename();
+    if (name.extension() == ".gz" or name.extension() == ".zst")
+      name.replace_extension();
+    name.replace_extension(".json");
+    return (output_directory.empty() ? source.parent_path() : output_directory) / name;
+  }
+
+  /// @brief convert every job, creating the directories of the outputs as needed
+  /// @param done called with the result of each job as it finishes, from one thread at a time; must not throw
+  /// @return the result of every job, in the order of `jobs`
+  WAVER_NODISCARD inline std::vector<result> run(const std::vector<job>              &jobs,
+                                                 const std::function<void(const result &)> &done = {});
+
+  WAVER_NODISCARD inline size_type threads() const noexcept { return pool.size(); }
+
+private:
+  /// @brief convert `job`, lexing into `buffers` and building the dump on `memory`
+  WAVER_NODISCARD inline result convert(const job &job, value_change_dump::lexer_t::buffers_t &buffers,
+                                        arena &memory) const;
+
+private:
+  parse_options options;
+  thread_pool   pool;
+  /// @brief thread index -> the buffers of the last file it lexed
+  std::vector<value_change_dump::lexer_t::buffers_t> scratch;
+  /// @brief thread index -> where it builds its dumps
+  std::vector<std::unique_ptr<arena>> arenas;
+};
+
+inline absl::StatusOr<std::vector<batch::job>> batch::collect(const path_t &spec, const path_t &output_directory) {
+  auto jobs = std::vector<job>{};
+  auto ec   = std::error_code{};
+  const auto add_matching = [&](const path_t &directory, auto &&matches) -> Status {
+    for (const auto &entry : std::filesystem::directory_iterator{directory, ec})
+      if (auto unreadable = std::error_code{};
+          entry.is_regular_file(unreadable) and matches(entry.path().filename().string()))
+        jobs.emplace_back(entry.path(), output_of(entry.path(), output_directory));
+    if (ec)
+      return NotFoundError("Unable to list " + directory.string() + ": " + ec.message());
+    std::ranges::sort(jobs, {}, &job::source);
+    return OkStatus();
+  };
+
+  if (const auto pattern = spec.filename().string(); pattern.find_first_of("*?") != string_t::npos) {
+    const auto directory = spec.has_parent_path() ? spec.parent_path() : path_t{"."};
+    const auto matches = [&](const string_view_t name) { return signal_filter::glob(pattern, name); };
+    if (auto res = add_matching(directory, matches); not res.ok())
+      return res;
+    return jobs;
+  }
+  if (std::filesystem::is_directory(spec, ec)) {
+    if (auto res = add_matching(spec,
+                                [](const string_view_t name) {
+                                  return std::ranges::any_of(extensions, [&](const auto extension) {
+                                    return name.ends_with(extension);
+                                  });
+                                });
+        not res.ok())
+      return res;
+    return jobs;
+  }
+
+  auto manifest = std::ifstream{spec};
+  if (not manifest)
+    return NotFoundError("Unable to open " + spec.string());
+  const auto base = spec.parent_path();
+  for (auto line = string_t{}; std::getline(manifest, line);) {
+    if (line.ends_with('\r'))
+      line.pop_back();
+    if (line.empty() or line.starts_with('#'))
+      continue;
+    const auto tab    = line.find('\t');
+    const auto source = base / line.substr(0, tab);
+    jobs.emplace_back(source,
+                      tab == string_t::npos ? output_of(source, output_directory) : base / line.substr(tab + 1));
+  }
+  return jobs;
+}
+
+inline std::vector<batch::result> batch::run(const std::vector<job>                    &jobs,
+                                             const std::function<void(const result &)> &done) {
+  auto results = std::vector<result>(jobs.size());
+  // largest first
+  auto order = std::vector<size_type>(jobs.size());
+  auto sizes = std::vector<std::uintmax_t>(jobs.size());
+  std::iota(order.begin(), order.end(), size_type{0});
+  for (size_type i = 0; i < jobs.size(); ++i) {
+    auto ec  = std::error_code{};
+    sizes[i] = std::filesystem::file_size(jobs[i].source, ec);
+    // a source that cannot be read fails at once, it is not the largest
+    if (ec)
+      sizes[i] = 0;
+  }
+  std::ranges::stable_sort(order, std::ranges::greater{}, [&](const size_type i) { return sizes[i]; });
+
+  auto reporting = std::mutex{};
+  for (const auto i : order)
+    pool.submit([&, i](const size_type self) {
+      results[i] = convert(jobs[i], scratch[self], *arenas[self]);
+      if (done) {
+        auto lock = std::scoped_lock{reporting};
+        done(results[i]);
+      }
+    });
+  pool.wait();
+  return results;
+}
+
+inline batch::result batch::convert(const job &job, value_change_dump::lexer_t::buffers_t &buffers,
+                                    arena &memory) const {
+  const auto started = std::chrono::steady_clock::now();
+  auto       res     = result{.source = job.source, .output = job.output};
+  auto       ec      = std::error_code{};
+  // file_size() reports an error as the largest size
+  if (const auto size = std::filesystem::file_size(job.source, ec); not ec)
+    res.bytes = static_cast<size_type>(size);
+
+  // a task of the pool must not throw, so whatever goes wrong becomes the status of the job
+  try {
+    auto options   = this->options;
+    options.memory = &memory;
+    // the dump has to be gone before its arena is released
+    const auto vcd = [&]() -> value_change_dump::expected_t {
+      if (waveform_db::is_database(job.source)) {
+        const auto db = waveform_db::open(job.source);
+        if (not db.ok())
+          return db.status();
+        return db->to_dump(options.allocator());
+      }
+      if (options.cache and options.filter.empty())
+        // only value_change_dump::parse() consults the cache
+        return value_change_dump::parse(job.source, options);
+      auto dump   = value_change_dump{options.allocator()};
+      auto parser = value_change_dump::parser_t{dump, options};
+      parser.reuse(std::move(buffers));
+      auto status = parser.load(job.source);
+      if (status.ok())
+        status = parser.parse();
+      buffers = parser.release();
+      if (not status.ok())
+        return status;
+      return dump;
+    }();
+    res.status = vcd.status();
+    if (res.status.ok()) {
+      if (job.output.has_parent_path())
+        std::filesystem::create_directories(job.output.parent_path(), ec);
+      auto output = std::ofstream{job.output, std::ios::binary};
+      vcd->write_json(output, 4);
+      output.flush();
+      if (not output)
+        res.status = absl::UnavailableError("Failed to write to " + job.output.string());
+      res.changes = vcd->value_changes.event_count();
+    }
+  } catch (const std::bad_alloc &) {
+    res.status = absl::ResourceExhaustedError("Ran out of memory while converting " + job.source.string());
+  } catch (const std::exception &error) {
+    res.status = absl::InternalError("Failed to convert " + job.source.string() + ": " + error.what());
+  }
+  memory.release();
+  res.wall = std::chrono::steady_clock::now() - started;
+  return res;
+}
+} // namespace net::ancillarycat::waver
@@ -0,0 +1,265 @@
+/**************************************************************************************
+ * @file body_scanner.hpp
+ * @brief a byte-level scanner of the value change section, bypassing the lexer.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <utility>
+#include "config.hpp"
+#include "contract.hpp"
+#include "meta_elements.hpp"
+#include "signal_table.hpp"
+#include "token.hpp"
+
+namespace net::ancillarycat::waver {
+/// @brief scans the value change section of a dump in memory, i.e. the bytes after `$enddefinitions $end`, straight
+///        into a visitor, without splitting it into tokens first
+/// @note a state machine over the bytes rather than a token stream: the first byte of a word decides whether it is a
+///       timestamp, a keyword, a scalar or a vector change, and the scanner reads exactly that. Timestamps are
+///       decoded eight digits at a time, and identifier codes are decoded while they are read and looked up with
+///       signal_table::find_decoded(), so a change costs a single pass over its bytes and no allocation.
+/// @note it accepts what the token parser accepts, except that a timestamp has to end at a separator and may not
+///       appear inside `$dumpvars`.
+/// @note the visitor has
+/// - `on_time(timestamp::time_t)`, at every timestamp
+/// - `on_dump_begin(std::string_view keyword)` and `on_dump_end(std::string_view keyword)`, around `$dumpvars`, and
+///   around `$dumpall`, `$dumpon` and `$dumpoff` after the first timestamp
+/// - `on_change(signal_id_t, std::string_view value)`, returning false to reject the value and stop the scan
+class body_scanner {
+public:
+  using size_type     = std::size_t;
+  using string_view_t = std::string_view;
+  using time_t        = timestamp::time_t;
+
+  /// @brief how a scan ended
+  enum class status : std::uint8_t {
+    kSuccess = 0,
+    /// @brief a malformed timestamp, a timestamp inside `$dumpvars`, or a change before the first timestamp outside it
+    kInvalidTimestamp,
+    kUnknownIdentifier,
+    /// @brief a vector change without its identifier code, or an unterminated `$comment` or `$dumpvars`
+    kUnexpectedEndOfFile,
+    /// @brief the visitor rejected a value
+    kInvalidValue,
+  };
+
+public:
+  /// @param signals where the identifier codes are looked up
+  inline explicit body_scanner(const signal_table &signals) noexcept : signals(signals) {}
+
+public:
+  /// @brief scan `body`, reporting what it contains to `visitor`
+  template <typename Visitor>
+  WAVER_NODISCARD inline status scan(string_view_t body, Visitor &visitor);
+
+  /// @brief the word the last scan stopped at, empty if it succeeded
+  WAVER_NODISCARD inline string_view_t where() const noexcept { return failed; }
+
+  /// @brief decode the decimal digits at the start of [first, last) into `time`
+  /// @return the end of the digits, or null if there are none or they do not fit in a time_t
+  WAVER_NODISCARD inline static const char *decode_time(const char *first, const char *last, time_t &time) noexcept;
+
+  /// @brief the same separators as the lexer's: space, `\t`, `\n`, `\v`, `\f` and `\r`
+  WAVER_NODISCARD WAVER_FORCEINLINE static constexpr bool is_separator(const char c) noexcept {
+    const auto byte = static_cast<unsigned char>(c);
+    return byte == ' ' or (byte >= '\t' and byte <= '\r');
+  }
+
+private:
+  WAVER_NODISCARD WAVER_FORCEINLINE static const char *skip_separators(const char *first, const char *last) noexcept {
+    while (first != last and is_separator(*first))
+      ++first;
+    return first;
+  }
+  WAVER_NODISCARD WAVER_FORCEINLINE static const char *word_end(const char *first, const char *last) noexcept {
+    while (first != last and not is_separator(*first))
+      ++first;
+    return first;
+  }
+  /// @brief the number of decimal digits the eight bytes of `chunk` start with, in memory order
+  WAVER_NODISCARD WAVER_FORCEINLINE static size_type leading_digits(const std::uint64_t chunk) noexcept {
+    constexpr auto ones = std::uint64_t{0x0101010101010101};
+    // a byte is a digit iff its high nibble is 3 both as it is and with 6 added; the top bits are cleared before the
+    // addition so that it cannot carry into the next byte, and checked with the high nibble
+    const auto high     = chunk & ones * 0xF0;
+    const auto adjusted = ((chunk & ones * 0x7F) + ones * 0x06) & ones * 0xF0;
+    return static_cast<size_type>(std::countr_zero((high ^ ones * 0x30) | (adjusted ^ ones * 0x30))) / 8;
+  }
+  /// @brief the value of eight digits whose low nibbles are the bytes of `chunk`, the first byte most significant
+  WAVER_NODISCARD WAVER_FORCEINLINE static std::uint64_t eight_digits(std::uint64_t chunk) noexcept {
+    chunk = ((chunk & 0x0F0F0F0F0F0F0F0F) * 2561) >> 8;
+    chunk = ((chunk & 0x00FF00FF00FF00FF) * 6553601) >> 16;
+    return ((chunk & 0x0000FFFF0000FFFF) * 42949672960001) >> 32;
+  }
+  /// @brief read the identifier code starting at `first` and look it up
+  /// @return the end of the code
+  WAVER_NODISCARD WAVER_FORCEINLINE const char *read_code(const char *first, const char *last,
+                                                          signal_id_t &signal) const {
+    auto value     = signal_table::code_t{0};
+    auto weight    = signal_table::code_t{1};
+    auto printable = true;
+    auto cursor    = first;
+    // the same bijective base-94 decoding as signal_table::decode(), done while looking for the end of the code
+    for (; cursor != last and not is_separator(*cursor); ++cursor) {
+      const auto digit = static_cast<unsigned>(static_cast<unsigned char>(*cursor)) - '!';
+      printable        = printable and digit < 94;
+      value += (digit + 1) * weight;
+      weight *= 94;
+    }
+    if (const auto length = static_cast<size_type>(cursor - first);
+        printable and length != 0 and length <= signal_table::max_decoded_length) [[likely]]
+      signal = signals.find_decoded(value);
+    else
+      signal = signals.find({first, length});
+    return cursor;
+  }
+
+private:
+  const signal_table &signals;
+  string_view_t       failed;
+};
+
+inline const char *body_scanner::decode_time(const char *const first, const char *const last, time_t &time) noexcept {
+  static constexpr auto powers = [] {
+    auto result = std::array<std::uint64_t, 9>{1};
+    for (size_type i = 1; i < result.size(); ++i)
+      result[i] = result[i - 1] * 10;
+    return result;
+  }();
+
+  auto cursor = first;
+  auto value  = std::uint64_t{0};
+  if constexpr (std::endian::native == std::endian::little)
+    while (last - cursor >= 8) {
+      auto chunk = std::uint64_t{};
+      std::memcpy(&chunk, cursor, sizeof chunk);
+      const auto digits = leading_digits(chunk);
+      if (digits == 0)
+        break;
+      // the digits are the low bytes; shifting them up pads the number with leading zeros
+      value = value * powers[digits] + eight_digits(chunk << (64 - 8 * digits));
+      cursor += digits;
+      if (digits < 8)
+        break;
+    }
+  for (; cursor != last and *cursor >= '0' and *cursor <= '9'; ++cursor)
+    value = value * 10 + static_cast<std::uint64_t>(*cursor - '0');
+
+  if (cursor == first)
+    return nullptr;
+  if (cursor - first > std::numeric_limits<std::uint64_t>::digits10) {
+    // may have overflowed; rare enough to leave to the standard library
+    if (std::from_chars(first, cursor, time).ec != std::errc())
+      return nullptr;
+    return cursor;
+  }
+  time = static_cast<time_t>(value);
+  return cursor;
+}
+
+template <typename Visitor>
+inline auto body_scanner::scan(const string_view_t body, Visitor &visitor) -> status {
+  const auto *cursor     = body.data();
+  const auto *const last = cursor + body.size();
+  // whether a timestamp has been met
+  auto timed = false;
+  // the `$dumpvars`, `$dumpall`, `$dumpon` or `$dumpoff` whose `$end` has not been met yet, kEof if none
+  auto block      = token_kind::kEof;
+  const auto fail = [&](const char *const word, const status why) {
+    failed = {word, word_end(word, last)};
+    return why;
+  };
+
+  failed = {};
+  for (;;) {
+    if (cursor = skip_separators(cursor, last); cursor == last)
+      return block == token_kind::kDumpvars ? fail(last, status::kUnexpectedEndOfFile) : status::kSuccess;
+    const auto *const word = cursor;
+
+    switch (*cursor) {
+    case '#': {
+      auto time = time_t{};
+      if (block == token_kind::kDumpvars)
+        return fail(word, status::kInvalidTimestamp);
+      if (cursor = decode_time(cursor + 1, last, time); not cursor or (cursor != last and not is_separator(*cursor)))
+        return fail(word, status::kInvalidTimestamp);
+      timed = true;
+      visitor.on_time(time);
+      continue;
+    }
+    case '$':
+      cursor = word_end(cursor, last);
+      switch (const auto kind = keyword_table::find({word, cursor}); kind) {
+      case token_kind::kDumpall:
+      case token_kind::kDumpon:
+      case token_kind::kDumpoff:
+        // before the first timestamp these are skipped like any other keyword, as by the token parser
+        if (not timed)
+          continue;
+        [[fallthrough]];
+      case token_kind::kDumpvars:
+        block = kind;
+        visitor.on_dump_begin(keyword_table::text(kind));
+        continue;
+      case token_kind::kEnd:
+        if (block != token_kind::kEof)
+          visitor.on_dump_end(keyword_table::text(std::exchange(block, token_kind::kEof)));
+        continue;
+      case token_kind::kComment:
+        // everything up to and including its `$end`
+        for (;;) {
+          if (cursor = skip_separators(cursor, last); cursor == last)
+            return fail(word, status::kUnexpectedEndOfFile);
+          const auto *const end = word_end(cursor, last);
+          if (string_view_t{cursor, end} == keywords::$end) {
+            cursor = end;
+            break;
+          }
+          cursor = end;
+        }
+        continue;
+      default:
+        continue;
+      }
+    default:
+      break;
+    }
+
+    if (not timed and block != token_kind::kDumpvars)
+      return fail(word, status::kInvalidTimestamp);
+    auto        value = string_view_t{};
+    const char *code  = nullptr;
+    switch (*cursor) {
+    case '0':
+    case '1':
+    case 'x':
+    case 'X':
+    case 'z':
+    case 'Z':
+      // a scalar change, the value is immediately followed by the identifier code
+      value = {cursor, 1};
+      code  = cursor + 1;
+      break;
+    default:
+      // a vector (`b`), real (`r`) or string (`s`) change, the identifier code is the next word
+      cursor = word_end(cursor, last);
+      value  = {word, cursor};
+      if (code = skip_separators(cursor, last); code == last)
+        return fail(word, status::kUnexpectedEndOfFile);
+    }
+    auto signal = invalid_signal_id;
+    if (cursor = read_code(code, last, signal); signal == invalid_signal_id)
+      return fail(code, status::kUnknownIdentifier);
+    if (not visitor.on_change(signal, value))
+      return fail(word, status::kInvalidValue);
+  }
+}
+} // namespace net::ancillarycat::waver
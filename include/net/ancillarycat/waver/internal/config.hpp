@@ -6,6 +6,9 @@
 
 #pragma once
 #include <absl/status/status.h>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
 #include <nlohmann/json_fwd.hpp>
 #include <string>
 #include <string_view>
@@ -39,6 +42,21 @@
 #define WAVER_NODISCARD [[nodiscard]]
 #endif
 
+#ifndef WAVER_STATS
+#ifdef WAVER_ENABLE_STATS
+/*!
+ * @brief Expands to its arguments if `WAVER_ENABLE_STATS` is defined, and to nothing otherwise.
+ *
+ * @def WAVER_STATS
+ *
+ * @param [in] ... the instrumentation statement(s), see parse_stats.
+ */
+#define WAVER_STATS(...) __VA_ARGS__
+#else
+#define WAVER_STATS(...)
+#endif
+#endif
+
 /*!
  * @}
  */
@@ -53,6 +71,12 @@ using absl::StatusCode;
 
 using identifier_t = std::string;
 using json_t       = nlohmann::json;
+/// @brief the allocator of the model; the default one allocates from std::pmr::get_default_resource()
+using allocator_t = std::pmr::polymorphic_allocator<>;
+/// @brief dense id of a signal, assigned in declaration order when its identifier code is first seen
+using signal_id_t = std::uint32_t;
+
+static constexpr inline auto invalid_signal_id = std::numeric_limits<signal_id_t>::max();
 
 using namespace std::string_view_literals;
 static constexpr inline auto empty_sv = ""sv;
@@ -73,8 +97,11 @@ static inline constexpr auto $dumpoff        = "$dumpoff"sv;
 static inline constexpr auto $end            = "$end"sv;
 static inline constexpr auto $enddefinitions = "$enddefinitions"sv;
 
-static inline constexpr auto module = "module"sv;
-static inline constexpr auto task   = "task"sv;
-static inline constexpr auto wire   = "wire"sv;
-static inline constexpr auto reg    = "reg"sv;
+static inline constexpr auto module   = "module"sv;
+static inline constexpr auto task     = "task"sv;
+static inline constexpr auto function = "function"sv;
+static inline constexpr auto begin    = "begin"sv;
+static inline constexpr auto fork     = "fork"sv;
+static inline constexpr auto wire     = "wire"sv;
+static inline constexpr auto reg      = "reg"sv;
 } // namespace net::ancillarycat::waver::keywords
@@ -0,0 +1,310 @@
+/**************************************************************************************
+ * @file decompressor.hpp
+ * @brief gzip and zstd decompression on a dedicated thread, overlapped with lexing.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <absl/status/status.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "config.hpp"
+#include "contract.hpp"
+#include "mapped_file.hpp"
+
+#ifdef WAVER_USE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef WAVER_USE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace net::ancillarycat::waver {
+/// @brief the compression of an input, told by its first bytes
+enum class compression : std::uint8_t {
+  kNone = 0,
+  /// @brief gzip, i.e. `.gz`
+  kGzip = 1,
+  kZstd = 2,
+};
+
+/// @brief inflates a compressed buffer on its own thread into a ring of buffers, which read() drains in order
+/// @note gzip support needs zlib (`WAVER_USE_ZLIB`), zstd support libzstd (`WAVER_USE_ZSTD`); see supported().
+///       Concatenated gzip members and zstd frames are decompressed one after the other, like `zcat` does.
+/// @note the producer blocks once every buffer is full, so at most `buffers * buffer_size` decompressed bytes are
+///       held at a time. Destroying the decompressor stops the thread, whether the input was drained or not.
+class decompressor {
+public:
+  using size_type     = std::size_t;
+  using string_t      = std::string;
+  using string_view_t = std::string_view;
+
+  /// @brief default size of one buffer of the ring
+  static inline constexpr size_type default_buffer_size = size_type{1} << 20;
+  /// @brief default number of buffers in the ring
+  static inline constexpr size_type default_buffers = 4;
+
+public:
+  /// @brief start decompressing `input`
+  /// @param input the compressed file, owned until the decompressor is destroyed
+  /// @param format the compression of `input`, see detect()
+  /// @pre supported(format)
+  inline explicit decompressor(mapped_file input, const compression format,
+                               const size_type buffer_size = default_buffer_size,
+                               const size_type buffers     = default_buffers) :
+      input(std::move(input)), format(format), ring(std::max(buffers, size_type{2}), string_t(buffer_size, '\0')),
+      filled(ring.size(), 0) {
+    WAVER_PRECONDITION(supported(format) and buffer_size > 0);
+
+    worker = std::thread{[this] { run(); }};
+  }
+  inline decompressor(const decompressor &)            = delete;
+  inline decompressor &operator=(const decompressor &) = delete;
+  inline ~decompressor() noexcept {
+    {
+      auto lock = std::scoped_lock{mutex};
+      stopping  = true;
+    }
+    changed.notify_all();
+    worker.join();
+  }
+
+public:
+  /// @brief the compression of an input starting with `head`
+  WAVER_NODISCARD inline static constexpr compression detect(const string_view_t head) noexcept {
+    if (head.starts_with("\x1f\x8b"sv))
+      return compression::kGzip;
+    if (head.starts_with("\x28\xb5\x2f\xfd"sv))
+      return compression::kZstd;
+    return compression::kNone;
+  }
+
+  /// @brief whether this build can decompress `format`
+  WAVER_NODISCARD inline static constexpr bool supported(const compression format) noexcept {
+    switch (format) {
+    case compression::kNone:
+      return false;
+    case compression::kGzip:
+#ifdef WAVER_USE_ZLIB
+      return true;
+#else
+      return false;
+#endif
+    case compression::kZstd:
+#ifdef WAVER_USE_ZSTD
+      return true;
+#else
+      return false;
+#endif
+    }
+    return false;
+  }
+
+  /// @brief copy up to `size` decompressed bytes to `buffer`, waiting for the thread if none are ready
+  /// @return the number of bytes copied, 0 once everything has been read or decompression failed, see status()
+  /// @note meant as a lexer::chunk_reader_t; only one thread may read.
+  WAVER_NODISCARD inline size_type read(char *const buffer, const size_type size) {
+    auto copied = size_type{0};
+    while (copied < size) {
+      if (offset == 0) {
+        // wait for the next buffer; the one being read stays ours until it is released below
+        auto lock = std::unique_lock{mutex};
+        changed.wait(lock, [this] { return consumed < produced or done; });
+        if (consumed == produced)
+          break;
+      }
+      const auto  slot  = consumed % ring.size();
+      const auto  count = std::min(size - copied, filled[slot] - offset);
+      std::memcpy(buffer + copied, ring[slot].data() + offset, count);
+      copied += count;
+      offset += count;
+      if (offset == filled[slot]) {
+        offset = 0;
+        {
+          auto lock = std::scoped_lock{mutex};
+          ++consumed;
+        }
+        changed.notify_all();
+      }
+      // hand out what is there rather than waiting to fill `buffer` completely
+      if (copied and offset == 0 and not ready())
+        break;
+    }
+    return copied;
+  }
+
+  /// @brief OkStatus(), or why decompression stopped before the end of the input
+  WAVER_NODISCARD inline Status status() const {
+    auto lock = std::scoped_lock{mutex};
+    return error;
+  }
+
+private:
+  /// @brief whether a decompressed buffer is waiting to be read
+  WAVER_NODISCARD inline bool ready() const {
+    auto lock = std::scoped_lock{mutex};
+    return consumed < produced;
+  }
+
+  /// @brief wait for a free buffer
+  /// @return the buffer, or nullptr if the decompressor is being destroyed
+  WAVER_NODISCARD inline string_t *acquire() {
+    auto lock = std::unique_lock{mutex};
+    changed.wait(lock, [this] { return produced - consumed < ring.size() or stopping; });
+    return stopping ? nullptr : &ring[produced % ring.size()];
+  }
+
+  /// @brief hand the buffer from acquire() to the reader
+  inline void publish(const size_type bytes) {
+    if (bytes == 0)
+      return;
+    {
+      auto lock                      = std::scoped_lock{mutex};
+      filled[produced % ring.size()] = bytes;
+      ++produced;
+    }
+    changed.notify_all();
+  }
+
+  inline void finish(Status status) {
+    {
+      auto lock = std::scoped_lock{mutex};
+      error     = std::move(status);
+      done      = true;
+    }
+    changed.notify_all();
+  }
+
+  inline void run() {
+    switch (format) {
+    case compression::kGzip:
+      return finish(inflate_gzip());
+    case compression::kZstd:
+      return finish(inflate_zstd());
+    default:
+      return finish(absl::UnimplementedError("Not a compressed input"));
+    }
+  }
+
+  inline Status inflate_gzip() {
+#ifdef WAVER_USE_ZLIB
+    auto stream = z_stream{};
+    // 32: detect a gzip or zlib header
+    if (inflateInit2(&stream, 15 + 32) != Z_OK)
+      return absl::ResourceExhaustedError("Unable to initialize zlib");
+    const auto *next          = reinterpret_cast<const Bytef *>(input.data());
+    auto        left          = input.size();
+    auto        status        = OkStatus();
+    auto        end_of_member = false;
+    for (auto more = true; more;) {
+      auto *const buffer = acquire();
+      if (not buffer)
+        break;
+      stream.next_out  = reinterpret_cast<Bytef *>(buffer->data());
+      stream.avail_out = static_cast<uInt>(std::min<size_type>(buffer->size(), std::numeric_limits<uInt>::max()));
+      while (stream.avail_out) {
+        if (stream.avail_in == 0) {
+          if (left == 0) {
+            if (not end_of_member)
+              status = absl::DataLossError("Truncated gzip input");
+            more = false;
+            break;
+          }
+          stream.next_in  = const_cast<Bytef *>(next);
+          stream.avail_in = static_cast<uInt>(std::min<size_type>(left, std::numeric_limits<uInt>::max()));
+          next += stream.avail_in;
+          left -= stream.avail_in;
+        }
+        if (std::exchange(end_of_member, false))
+          // another gzip member follows
+          inflateReset(&stream);
+        if (const auto res = inflate(&stream, Z_NO_FLUSH); res == Z_STREAM_END)
+          end_of_member = true;
+        else if (res != Z_OK) {
+          status = absl::DataLossError(string_t{"Corrupted gzip input: "} +
+                                       (stream.msg ? stream.msg : "error " + std::to_string(res)));
+          more   = false;
+          break;
+        }
+      }
+      publish(buffer->size() - stream.avail_out);
+    }
+    inflateEnd(&stream);
+    return status;
+#else
+    return absl::UnimplementedError("Built without zlib, see WAVER_USE_ZLIB");
+#endif
+  }
+
+  inline Status inflate_zstd() {
+#ifdef WAVER_USE_ZSTD
+    auto *const context = ZSTD_createDCtx();
+    if (not context)
+      return absl::ResourceExhaustedError("Unable to initialize zstd");
+    auto in     = ZSTD_inBuffer{input.data(), input.size(), 0};
+    auto hint   = size_type{1}; // 0 once a frame is complete and flushed
+    auto status = OkStatus();
+    for (auto more = true; more;) {
+      auto *const buffer = acquire();
+      if (not buffer)
+        break;
+      auto out = ZSTD_outBuffer{buffer->data(), buffer->size(), 0};
+      while (out.pos < out.size) {
+        if (in.pos == in.size and hint == 0) {
+          more = false;
+          break;
+        }
+        const auto consumed_before = in.pos, produced_before = out.pos;
+        hint = ZSTD_decompressStream(context, &out, &in);
+        if (ZSTD_isError(hint)) {
+          status = absl::DataLossError(string_t{"Corrupted zstd input: "} + ZSTD_getErrorName(hint));
+          more   = false;
+          break;
+        }
+        if (in.pos == consumed_before and out.pos == produced_before) {
+          // the input ended within a frame
+          status = absl::DataLossError("Truncated zstd input");
+          more   = false;
+          break;
+        }
+      }
+      publish(out.pos);
+    }
+    ZSTD_freeDCtx(context);
+    return status;
+#else
+    return absl::UnimplementedError("Built without libzstd, see WAVER_USE_ZSTD");
+#endif
+  }
+
+private:
+  /// @brief the compressed bytes
+  mapped_file input;
+  compression format;
+  /// @brief decompressed buffers; buffer `i % size` holds the i-th chunk, of `filled` bytes
+  std::vector<string_t>  ring;
+  std::vector<size_type> filled;
+  /// @brief the number of buffers handed to and released by the reader, guarded by `mutex`
+  size_type produced = 0;
+  size_type consumed = 0;
+  /// @brief the reader's position in the buffer it is reading, only touched by the reader
+  size_type offset = 0;
+  /// @brief whether the thread has finished, and how, guarded by `mutex`
+  bool   done     = false;
+  bool   stopping = false;
+  Status error;
+
+  mutable std::mutex      mutex;
+  std::condition_variable changed;
+  std::thread             worker;
+};
+} // namespace net::ancillarycat::waver
@@ -0,0 +1,273 @@
+/**************************************************************************************
+ * @file follower.hpp
+ * @brief incremental parsing of a VCD file that a simulator is still writing.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include "config.hpp"
+#include "decompressor.hpp"
+#include "value_index.hpp"
+#include "vcd.hpp"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace net::ancillarycat::waver {
+/// @brief follows a VCD file while it grows, parsing only the bytes appended since the last update() into one dump
+///        and its value_index
+/// @note only complete timestamps are committed: the block of the last `#time` line read is held back until the
+///       next one starts, since the writer may still be adding to it. Call flush() once the writer is done to commit
+///       the final block.
+/// @note wait() blocks on inotify on Linux and polls the size of the file elsewhere. A file that shrinks is taken
+///       as rewritten, e.g. by a restarted simulation, and is followed again from its beginning.
+/// @note compressed files cannot be followed.
+class follower {
+public:
+  using size_type     = std::size_t;
+  using path_t        = std::filesystem::path;
+  using string_t      = std::string;
+  using string_view_t = std::string_view;
+  using duration_t    = std::chrono::milliseconds;
+  using parser_t      = value_change_dump::parser_t;
+
+  /// @brief how often wait() looks at the size of the file when it cannot be watched
+  static inline constexpr auto poll_interval = duration_t{100};
+
+public:
+  /// @param path the dump to follow; it does not have to exist yet
+  /// @param options see parse_options; `streaming` and `cache` are ignored
+  /// @param index_interval events between two checkpoints of index(), see value_index
+  inline explicit follower(path_t path, parse_options options = {},
+                           const size_type index_interval = value_index::default_interval) :
+      file(std::move(path)), options(std::move(options)), interval(index_interval),
+      vcd(std::make_unique<value_change_dump>(this->options.allocator())) {
+    this->options.cache = nullptr;
+#ifdef __linux__
+    notify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+  }
+  inline follower(const follower &)            = delete;
+  inline follower &operator=(const follower &) = delete;
+  inline follower(follower &&rhs) noexcept :
+      file(std::move(rhs.file)), options(std::move(rhs.options)), interval(rhs.interval), vcd(std::move(rhs.vcd)),
+      parser(std::move(rhs.parser)), values(std::move(rhs.values)), pending(std::move(rhs.pending)),
+      read(std::exchange(rhs.read, 0)), notify(std::exchange(rhs.notify, -1)),
+      watching(std::exchange(rhs.watching, false)) {}
+  inline follower &operator=(follower &&rhs) noexcept {
+    if (this == &rhs)
+      return *this;
+    close();
+    file     = std::move(rhs.file);
+    options  = std::move(rhs.options);
+    interval = rhs.interval;
+    values   = std::move(rhs.values);
+    parser   = std::move(rhs.parser);
+    vcd      = std::move(rhs.vcd);
+    pending  = std::move(rhs.pending);
+    read     = std::exchange(rhs.read, 0);
+    notify   = std::exchange(rhs.notify, -1);
+    watching = std::exchange(rhs.watching, false);
+    return *this;
+  }
+  inline ~follower() noexcept { close(); }
+
+public:
+  /// @brief read what was appended to the file and parse its complete timestamps
+  /// @return the number of value changes added, not counting `$dumpvars`; 0 if the header or the next timestamp is
+  ///         still incomplete
+  WAVER_NODISCARD inline absl::StatusOr<size_type> update() { return advance(false); }
+
+  /// @brief like update(), but also commit the block of the last timestamp, for once the writer has finished
+  WAVER_NODISCARD inline absl::StatusOr<size_type> flush() { return advance(true); }
+
+  /// @brief wait up to `timeout` for the file to change
+  /// @return whether there is something for update() to read
+  inline bool wait(duration_t timeout);
+
+  /// @brief whether the header has been parsed, i.e. whether index() exists
+  WAVER_NODISCARD inline bool ready() const noexcept { return parser != nullptr; }
+  /// @brief the dump parsed so far; its address is stable for the lifetime of the follower
+  WAVER_NODISCARD inline const value_change_dump &dump() const noexcept { return *vcd; }
+  /// @brief value-at-time queries over dump(), extended by every update()
+  /// @pre ready()
+  WAVER_NODISCARD inline const value_index &index() const noexcept {
+    WAVER_PRECONDITION(ready());
+    return *values;
+  }
+  /// @brief the byte offset up to which the file has been committed to the dump
+  WAVER_NODISCARD inline size_type committed() const noexcept { return read - pending.size(); }
+  WAVER_NODISCARD inline const path_t &path() const noexcept { return file; }
+
+private:
+  inline absl::StatusOr<size_type> advance(bool all);
+  /// @brief parse the header once `pending` holds all of it
+  /// @return whether the header has been parsed
+  inline absl::StatusOr<bool> parse_header();
+  /// @brief forget everything read so far
+  inline void restart();
+  inline void close() noexcept {
+#ifdef __linux__
+    if (notify >= 0)
+      ::close(notify);
+#endif
+    notify = -1;
+  }
+
+  /// @brief the offset of the `#` of the last timestamp in `body`, or npos if it has none
+  /// @note as in the parallel parser, only `#` at the beginning of a line is taken as a timestamp; one that is not
+  ///       followed by anything yet counts, the writer has started a new block
+  WAVER_NODISCARD inline static size_type last_timestamp(const string_view_t body) noexcept {
+    for (auto end = body.size(); end > 0;) {
+      const auto line = body.rfind("\n#"sv, end - 1);
+      if (line == string_view_t::npos)
+        break;
+      if (line + 2 == body.size() or std::isdigit(static_cast<unsigned char>(body[line + 2])))
+        return line + 1;
+      end = line;
+    }
+    return body.starts_with('#') ? 0 : string_view_t::npos;
+  }
+
+private:
+  path_t        file;
+  parse_options options;
+  size_type     interval;
+  /// @brief the dump, on the heap since the parser and the index refer to it
+  std::unique_ptr<value_change_dump> vcd;
+  /// @brief the parser of the header, which keeps the signal selection for the value changes; null until then
+  std::unique_ptr<parser_t> parser;
+  std::unique_ptr<value_index> values;
+  /// @brief the bytes read but not committed yet
+  string_t pending;
+  /// @brief the number of bytes read from the file
+  size_type read = 0;
+  /// @brief the inotify instance, and whether it watches the file
+  int  notify   = -1;
+  bool watching = false;
+};
+
+inline absl::StatusOr<follower::size_type> follower::advance(const bool all) {
+  auto       ec   = std::error_code{};
+  const auto size = static_cast<size_type>(std::filesystem::file_size(file, ec));
+  if (ec) {
+    // a file that is not created yet has nothing to parse
+    if (not std::filesystem::exists(file, ec))
+      return size_type{0};
+    return NotFoundError("Unable to stat " + file.string() + ": " + ec.message());
+  }
+  if (size < read)
+    restart();
+  if (size > read) {
+    auto input = std::ifstream{file, std::ios::binary};
+    input.seekg(static_cast<std::streamoff>(read));
+    const auto old = pending.size();
+    pending.resize(old + (size - read));
+    input.read(pending.data() + old, static_cast<std::streamsize>(size - read));
+    const auto count = static_cast<size_type>(std::max<std::streamsize>(input.gcount(), 0));
+    pending.resize(old + count);
+    read += count;
+  }
+
+  if (not ready()) {
+    const auto header = parse_header();
+    if (not header.ok())
+      return header.status();
+    if (not *header)
+      return size_type{0};
+  }
+  const auto end = all ? pending.size() : last_timestamp(pending);
+  if (end == 0 or end == string_view_t::npos)
+    return size_type{0};
+
+  const auto before = vcd->value_changes.event_count();
+  if (parser->parse_body(string_view_t{pending}.substr(0, end), options.concurrency()) !=
+      parser_t::parse_error_t::kSuccess)
+    return InvalidArgumentError("Failed to parse the value changes after byte " + std::to_string(committed()) +
+                                " of " + file.string());
+  pending.erase(0, end);
+  values->extend();
+  return vcd->value_changes.event_count() - before;
+}
+
+inline absl::StatusOr<bool> follower::parse_header() {
+  if (decompressor::detect(pending) != compression::kNone)
+    return absl::UnimplementedError("Unable to follow the compressed file " + file.string());
+  const auto body = parser_t::find_body(pending);
+  if (body == string_view_t::npos)
+    return false;
+
+  auto header = std::make_unique<parser_t>(*vcd, options);
+  if (auto res = header->load(pending.substr(0, body)); not res.ok())
+    return res;
+  if (auto res = header->parse_definitions(string_view_t::npos); not res.ok()) {
+    *vcd = value_change_dump{vcd->get_allocator()};
+    return res;
+  }
+  parser = std::move(header);
+  values = std::make_unique<value_index>(vcd->value_changes, vcd->dumpvars, vcd->header.signals, interval);
+  pending.erase(0, body);
+  return true;
+}
+
+inline void follower::restart() {
+  // the index and the parser refer to the dump
+  values.reset();
+  parser.reset();
+  *vcd = value_change_dump{vcd->get_allocator()};
+  pending.clear();
+  read = 0;
+}
+
+inline bool follower::wait(const duration_t timeout) {
+  const auto changed = [this] {
+    auto ec = std::error_code{};
+    return static_cast<size_type>(std::filesystem::file_size(file, ec)) != read and not ec;
+  };
+  if (changed())
+    return true;
+#ifdef __linux__
+  if (notify >= 0 and not watching)
+    // the file may not have existed before, or may have been replaced
+    watching =
+      ::inotify_add_watch(notify, file.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF) >= 0;
+  if (watching) {
+    auto descriptor = pollfd{notify, POLLIN, 0};
+    if (::poll(&descriptor, 1, static_cast<int>(timeout.count())) > 0) {
+      alignas(inotify_event) char events[4096];
+      for (auto bytes = ::read(notify, events, sizeof events); bytes > 0; bytes = ::read(notify, events, sizeof events))
+        for (auto offset = decltype(bytes){0}; offset < bytes;) {
+          const auto *const event = reinterpret_cast<const inotify_event *>(events + offset);
+          // the watch is gone with the file, watch its successor next time
+          if (event->mask & IN_IGNORED)
+            watching = false;
+          offset += static_cast<decltype(bytes)>(sizeof(inotify_event) + event->len);
+        }
+    }
+    return changed();
+  }
+#endif
+  for (const auto deadline = std::chrono::steady_clock::now() + timeout;
+       not changed() and std::chrono::steady_clock::now() < deadline;)
+    std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+      poll_interval, deadline - std::chrono::steady_clock::now()));
+  return changed();
+}
+} // namespace net::ancillarycat::waver
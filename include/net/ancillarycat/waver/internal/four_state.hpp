@@ -0,0 +1,382 @@
+/**************************************************************************************
+ * @file four_state.hpp
+ * @brief bit-packed four-state (0/1/x/z) values and their VCD decoder.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "config.hpp"
+#include "contract.hpp"
+
+/// @brief helpers working on raw bit-planes; every bit is stored as a pair `(a, b)` like VPI's `s_vpi_vecval`:
+///        0 is (0, 0), 1 is (1, 0), z is (0, 1) and x is (1, 1).
+namespace net::ancillarycat::waver::four_state {
+using word_t    = std::uint64_t;
+using size_type = std::size_t;
+
+inline constexpr size_type word_bits = 64;
+
+/// @brief the number of words per plane needed for `width` bits
+WAVER_NODISCARD WAVER_FORCEINLINE constexpr size_type words_for(const size_type width) noexcept {
+  return (width + word_bits - 1) / word_bits;
+}
+
+/// @brief the VCD character of the bit `(a, b)`
+WAVER_NODISCARD WAVER_FORCEINLINE constexpr char to_char(const bool a, const bool b) noexcept {
+  return b ? (a ? 'x' : 'z') : (a ? '1' : '0');
+}
+
+/// @brief decode 8 binary digits at once; `chunk` holds them in memory order, i.e. most significant first
+/// @return false if any byte is not one of `01xXzZ`
+WAVER_NODISCARD WAVER_FORCEINLINE constexpr bool decode_chunk(const word_t chunk, std::uint8_t &a,
+                                                             std::uint8_t &b) noexcept {
+  constexpr auto ones = word_t{0x0101010101010101};
+  // bit 6 is set for the letters x/X/z/Z and clear for the digits 0/1
+  const auto letter = (chunk >> 6) & ones;
+  // per byte, letters are lower-cased and the bit telling x from z (0x02) or 0 from 1 (0x01) is masked out;
+  // what is left must be exactly 'x' (0x78) for letters and '0' (0x30) for digits
+  const auto normalized = (chunk | (letter * 0x20)) & ~(ones + letter);
+  if (normalized != (ones * 0x30) + letter * 0x48)
+    return false;
+  const auto high  = chunk & ones;              // 1 for '1'
+  const auto not_z = ~(chunk >> 1) & ones;      // 1 for 'x'/'X'
+  const auto a_lsb = (high & ~letter) | (not_z & letter);
+  // gather bit 0 of every byte into one byte, the first byte landing in the most significant bit
+  constexpr auto gather = word_t{0x8040201008040201};
+  a                     = static_cast<std::uint8_t>((a_lsb * gather) >> 56);
+  b                     = static_cast<std::uint8_t>((letter * gather) >> 56);
+  return true;
+}
+
+/// @brief decode the binary digits of a VCD vector value into the planes `a` and `b`
+/// @param digits the digits without the `b` prefix, most significant first
+/// @param width the number of bits to produce; shorter inputs are extended as VCD specifies, i.e. with `x` or `z`
+///        if the leftmost digit is one, with 0 otherwise; longer inputs keep their low `width` bits
+/// @param a,b the planes, each of words_for(width) words; they are fully overwritten
+/// @return false if `digits` is empty or contains anything but `01xXzZ`
+WAVER_NODISCARD inline bool decode_binary(std::string_view digits, const size_type width, word_t *const a,
+                                          word_t *const b) noexcept {
+  if (digits.empty())
+    return false;
+  const auto words = words_for(width);
+  std::fill_n(a, words, word_t{0});
+  std::fill_n(b, words, word_t{0});
+
+  const auto used = std::min(digits.size(), width);
+  auto       bit  = size_type{0};
+  // walk from the least significant end, 8 digits at a time
+  for (; bit + 8 <= used; bit += 8) {
+    auto chunk = word_t{};
+    std::memcpy(&chunk, digits.data() + digits.size() - bit - 8, sizeof chunk);
+    if constexpr (std::endian::native == std::endian::big)
+      chunk = std::byteswap(chunk);
+    auto a_byte = std::uint8_t{}, b_byte = std::uint8_t{};
+    if (not decode_chunk(chunk, a_byte, b_byte))
+      return false;
+    a[bit / word_bits] |= word_t{a_byte} << (bit % word_bits);
+    b[bit / word_bits] |= word_t{b_byte} << (bit % word_bits);
+  }
+  for (; bit < used; ++bit) {
+    const auto c      = digits[digits.size() - bit - 1];
+    const auto lower  = static_cast<char>(c | 0x20);
+    const auto letter = lower == 'x' or lower == 'z';
+    if (not letter and c != '0' and c != '1')
+      return false;
+    a[bit / word_bits] |= word_t{letter ? lower == 'x' : c == '1'} << (bit % word_bits);
+    b[bit / word_bits] |= word_t{letter} << (bit % word_bits);
+  }
+  // the remaining digits, if any, are beyond `width` and only need validating
+  for (auto index = size_type{0}; index + used < digits.size(); ++index)
+    if (not std::string_view{"01xXzZ"}.contains(digits[index]))
+      return false;
+  if (used == width)
+    return true;
+
+  // extend with the leftmost digit if it is x or z
+  const auto leftmost = static_cast<char>(digits.front() | 0x20);
+  if (leftmost != 'x' and leftmost != 'z')
+    return true;
+  for (; bit < width; ++bit) {
+    a[bit / word_bits] |= word_t{leftmost == 'x'} << (bit % word_bits);
+    b[bit / word_bits] |= word_t{1} << (bit % word_bits);
+  }
+  return true;
+}
+
+/// @brief append the `width` bits of the planes to `out` as binary digits, most significant first
+inline void format_binary(const word_t *const a, const word_t *const b, const size_type width, std::string &out) {
+  const auto start = out.size();
+  out.resize(start + width);
+  for (auto bit = size_type{0}; bit < width; ++bit)
+    out[start + width - bit - 1] =
+      to_char((a[bit / word_bits] >> (bit % word_bits)) & 1, (b[bit / word_bits] >> (bit % word_bits)) & 1);
+}
+} // namespace net::ancillarycat::waver::four_state
+
+namespace net::ancillarycat::waver {
+/// @brief a four-state logic value, or a real or string value, as carried by a VCD value change
+/// @note logic values of up to 64 bits are stored inline, wider ones out of line; see the four_state namespace for
+///       the bit encoding. Comparison is word-wide.
+class four_state_value {
+public:
+  using size_type     = std::size_t;
+  using word_t        = four_state::word_t;
+  using string_t      = std::string;
+  using string_view_t = std::string_view;
+  using json_t        = nlohmann::json;
+  using planes_t      = std::span<const word_t>;
+
+  /// @brief what the value holds
+  enum kind : std::uint8_t;
+
+public:
+  inline explicit constexpr four_state_value() noexcept = default;
+  inline four_state_value(const four_state_value &rhs) : type(rhs.type), bits(rhs.bits) {
+    std::ranges::copy(rhs.storage(), allocate().begin());
+  }
+  inline four_state_value(four_state_value &&rhs) noexcept :
+      type(rhs.type), bits(std::exchange(rhs.bits, 0)), local{rhs.local[0], rhs.local[1]},
+      heap(std::move(rhs.heap)) {}
+  inline four_state_value &operator=(const four_state_value &rhs) {
+    if (this == &rhs)
+      return *this;
+    return *this = four_state_value{rhs};
+  }
+  inline four_state_value &operator=(four_state_value &&rhs) noexcept {
+    type     = rhs.type;
+    bits     = std::exchange(rhs.bits, 0);
+    local[0] = rhs.local[0];
+    local[1] = rhs.local[1];
+    heap     = std::move(rhs.heap);
+    return *this;
+  }
+  inline ~four_state_value() noexcept = default;
+
+public:
+  /// @brief a value as written in a VCD file, taken apart but not decoded yet
+  struct vcd_parts {
+    kind type = kLogic;
+    /// @brief the number of bits a logic value decodes to
+    size_type bits = 0;
+    /// @brief the binary digits of a logic value, without the `b` prefix, or the bytes of a string
+    string_view_t text;
+    /// @brief the value of a real
+    double real = 0;
+  };
+
+  /// @brief take a value as written in a VCD file apart: a scalar `0`/`1`/`x`/`z`, a `b...` vector, an `r...` real
+  ///        or an `s...` string
+  /// @param value the value token, without the identifier code
+  /// @param width the declared width of the signal, that logic values are extended to
+  /// @return the parts, or std::nullopt if it is malformed; the digits of a logic value are checked by
+  ///         four_state::decode_binary()
+  WAVER_NODISCARD inline static std::optional<vcd_parts> split_vcd(const string_view_t value,
+                                                                   const size_type     width) noexcept {
+    if (value.empty())
+      return std::nullopt;
+    switch (value.front()) {
+    case 'r':
+    case 'R': {
+      auto real = double{};
+      if (const auto [_, ec] = std::from_chars(value.data() + 1, value.data() + value.size(), real);
+          ec != std::errc())
+        return std::nullopt;
+      return vcd_parts{kReal, four_state::word_bits, {}, real};
+    }
+    case 's':
+    case 'S':
+      return vcd_parts{kString, (value.size() - 1) * 8, value.substr(1)};
+    case 'b':
+    case 'B':
+      return vcd_parts{kLogic, std::max<size_type>(width, 1), value.substr(1)};
+    default:
+      if (value.size() != 1)
+        return std::nullopt;
+      return vcd_parts{kLogic, std::max<size_type>(width, 1), value};
+    }
+  }
+
+  /// @brief decode a value as written in a VCD file, see split_vcd()
+  /// @param value the value token, without the identifier code
+  /// @param width the declared width of the signal, used to extend logic values
+  /// @return the value, or std::nullopt if it is malformed
+  WAVER_NODISCARD inline static std::optional<four_state_value> from_vcd(const string_view_t value,
+                                                                         const size_type     width) {
+    const auto parts = split_vcd(value, width);
+    if (not parts)
+      return std::nullopt;
+    switch (parts->type) {
+    case kReal:
+      return from_real(parts->real);
+    case kString:
+      return from_string(parts->text);
+    default: {
+      auto result  = four_state_value{};
+      result.bits  = parts->bits;
+      auto storage = result.allocate();
+      if (not four_state::decode_binary(parts->text, result.bits, storage.data(), storage.data() + result.words()))
+        return std::nullopt;
+      return result;
+    }
+    }
+  }
+
+  /// @brief build a logic value from its planes, each of four_state::words_for(width) words
+  WAVER_NODISCARD inline static four_state_value from_planes(const size_type width, const word_t *const a,
+                                                             const word_t *const b) {
+    auto result    = four_state_value{};
+    result.bits    = width;
+    auto storage   = result.allocate();
+    const auto n   = result.words();
+    std::copy_n(a, n, storage.data());
+    std::copy_n(b, n, storage.data() + n);
+    return result;
+  }
+
+  /// @brief build a real value
+  WAVER_NODISCARD inline static four_state_value from_real(const double real) {
+    auto result     = four_state_value{};
+    result.type     = kReal;
+    result.bits     = four_state::word_bits;
+    result.local[0] = std::bit_cast<word_t>(real);
+    return result;
+  }
+
+  /// @brief build a string value
+  WAVER_NODISCARD inline static four_state_value from_string(const string_view_t text) {
+    auto result  = four_state_value{};
+    result.type  = kString;
+    result.bits  = text.size() * 8;
+    auto storage = result.allocate();
+    std::ranges::fill(storage, word_t{0});
+    std::memcpy(storage.data(), text.data(), text.size());
+    return result;
+  }
+
+public:
+  WAVER_NODISCARD inline kind      get_kind() const noexcept { return type; }
+  /// @brief the number of bits; 64 for reals, 8 per character for strings
+  WAVER_NODISCARD inline size_type width() const noexcept { return bits; }
+  /// @brief the number of words per plane
+  WAVER_NODISCARD inline size_type words() const noexcept { return four_state::words_for(bits); }
+
+  /// @brief the `a` plane of a logic value, or the raw bits of a real or string value
+  WAVER_NODISCARD inline planes_t a_plane() const noexcept { return storage().first(words()); }
+  /// @brief the `b` plane of a logic value; all zero unless some bit is x or z
+  WAVER_NODISCARD inline planes_t b_plane() const noexcept {
+    WAVER_PRECONDITION(type == kLogic);
+
+    return storage().subspan(words(), words());
+  }
+
+  /// @brief the VCD character of bit `index`
+  /// @pre the value is a logic value and index < width()
+  WAVER_NODISCARD inline char bit(const size_type index) const noexcept {
+    WAVER_PRECONDITION(type == kLogic and index < bits);
+
+    const auto planes = storage();
+    const auto word   = index / four_state::word_bits;
+    const auto shift  = index % four_state::word_bits;
+    return four_state::to_char((planes[word] >> shift) & 1, (planes[words() + word] >> shift) & 1);
+  }
+
+  /// @brief whether no bit is x or z
+  WAVER_NODISCARD inline bool is_known() const noexcept {
+    return type != kLogic or std::ranges::all_of(b_plane(), [](const word_t word) { return word == 0; });
+  }
+
+  /// @brief the value of a real
+  /// @pre the value is a real
+  WAVER_NODISCARD inline double to_real() const noexcept {
+    WAVER_PRECONDITION(type == kReal);
+
+    return std::bit_cast<double>(local[0]);
+  }
+
+  /// @brief convert back to the VCD representation, see format()
+  WAVER_NODISCARD inline string_t to_string() const {
+    auto       out    = string_t{};
+    const auto planes = storage();
+    format(type, bits, planes.data(), type == kLogic ? planes.data() + words() : nullptr, out);
+    return out;
+  }
+
+  /// @brief append the VCD representation of a value to `out`: `r` and the shortest digits that read back the same
+  ///        for a real, `s` and the bytes for a string, the bare character for a 1-bit logic value and `b` and all
+  ///        of its bits for a wider one
+  /// @note the digits are not spelled as in the dump: a 1-bit `b1` is written `1`, and a vector the dump shortened,
+  ///       such as `bx` for 4 bits, is written at its full width as `bxxxx`
+  /// @param width the number of bits, as width()
+  /// @param a the raw word of a real, the bytes of a string, or the `a` plane of a logic value
+  /// @param b the `b` plane of a logic value, unused otherwise
+  inline static void format(const kind type, const size_type width, const word_t *const a, const word_t *const b,
+                            string_t &out) {
+    switch (type) {
+    case kReal: {
+      char       buffer[32];
+      const auto [end, _] = std::to_chars(buffer, buffer + sizeof buffer, std::bit_cast<double>(*a));
+      out.push_back('r');
+      out.append(buffer, end);
+      return;
+    }
+    case kString:
+      out.push_back('s');
+      out.append(reinterpret_cast<const char *>(a), width / 8);
+      return;
+    default:
+      if (width == 1)
+        return out.push_back(four_state::to_char(*a & 1, *b & 1));
+      out.reserve(out.size() + width + 1);
+      out.push_back('b');
+      four_state::format_binary(a, b, width, out);
+    }
+  }
+
+  /// @brief word-wide comparison
+  WAVER_NODISCARD friend inline bool operator==(const four_state_value &lhs, const four_state_value &rhs) noexcept {
+    return lhs.type == rhs.type and lhs.bits == rhs.bits and std::ranges::equal(lhs.storage(), rhs.storage());
+  }
+
+  friend inline void to_json(json_t &j, const four_state_value &value) { j = value.to_string(); }
+
+public:
+  enum kind : std::uint8_t {
+    kLogic  = 0,
+    kReal   = 1,
+    kString = 2,
+  };
+
+private:
+  /// @brief the number of words in use: both planes of a logic value, the raw words of reals and strings
+  WAVER_NODISCARD inline size_type storage_words() const noexcept { return type == kLogic ? 2 * words() : words(); }
+  WAVER_NODISCARD inline std::span<const word_t> storage() const noexcept {
+    return {heap ? heap.get() : local, storage_words()};
+  }
+  /// @brief make room for storage_words() words, out of line if they do not fit inline
+  inline std::span<word_t> allocate() {
+    if (storage_words() > std::size(local))
+      heap = std::make_unique_for_overwrite<word_t[]>(storage_words());
+    return {heap ? heap.get() : local, storage_words()};
+  }
+
+private:
+  kind      type = kLogic;
+  size_type bits = 0;
+  /// @brief inline storage: the two planes of a logic value up to 64 bits, or a real
+  word_t local[2] = {};
+  /// @brief out-of-line storage for anything wider
+  std::unique_ptr<word_t[]> heap;
+};
+} // namespace net::ancillarycat::waver
@@ -0,0 +1,128 @@
+/**************************************************************************************
+ * @file generator.hpp
+ * @brief std::generator where the standard library has it, and a minimal stand-in where it does not.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <version>
+#if defined(__cpp_lib_generator) and __cpp_lib_generator >= 202207L
+#include <generator>
+#else
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#endif
+#include "config.hpp"
+
+namespace net::ancillarycat::waver {
+#if defined(__cpp_lib_generator) and __cpp_lib_generator >= 202207L
+template <typename Value>
+using generator = std::generator<Value>;
+#else
+/// @brief a lazily evaluated input range of the values a coroutine `co_yield`s, for standard libraries without
+///        std::generator
+/// @note only what waver needs: no `co_await`, no allocator, no `std::ranges::elements_of`; dereferencing yields an
+///       lvalue that lives until the iterator is incremented. An exception escaping the coroutine is rethrown from
+///       begin() or operator++.
+template <typename Value>
+class generator {
+public:
+  using value_type = std::remove_cvref_t<Value>;
+  using reference  = value_type &;
+
+  class promise_type {
+    friend class generator;
+
+  public:
+    WAVER_NODISCARD inline generator get_return_object() noexcept {
+      return generator{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    WAVER_NODISCARD inline std::suspend_always initial_suspend() const noexcept { return {}; }
+    WAVER_NODISCARD inline std::suspend_always final_suspend() const noexcept { return {}; }
+    // the operand of `co_yield` lives until the coroutine is resumed, so pointing at it is enough
+    inline std::suspend_always yield_value(value_type &value) noexcept {
+      current = std::addressof(value);
+      return {};
+    }
+    inline std::suspend_always yield_value(value_type &&value) noexcept {
+      current = std::addressof(value);
+      return {};
+    }
+    inline void return_void() const noexcept {}
+    inline void unhandled_exception() noexcept { error = std::current_exception(); }
+
+  private:
+    value_type        *current = nullptr;
+    std::exception_ptr error;
+  };
+
+  class iterator {
+  public:
+    using value_type      = generator::value_type;
+    using difference_type = std::ptrdiff_t;
+
+  public:
+    inline explicit iterator() = default;
+    inline explicit iterator(const std::coroutine_handle<promise_type> coroutine) noexcept : coroutine(coroutine) {}
+
+  public:
+    WAVER_NODISCARD inline reference operator*() const noexcept { return *coroutine.promise().current; }
+    inline iterator                 &operator++() {
+      resume(coroutine);
+      return *this;
+    }
+    inline void operator++(int) { ++*this; }
+    WAVER_NODISCARD inline friend bool operator==(const iterator &it, std::default_sentinel_t) noexcept {
+      return not it.coroutine or it.coroutine.done();
+    }
+
+  private:
+    std::coroutine_handle<promise_type> coroutine;
+  };
+
+public:
+  inline generator(const generator &)            = delete;
+  inline generator &operator=(const generator &) = delete;
+  inline generator(generator &&rhs) noexcept : coroutine(std::exchange(rhs.coroutine, {})) {}
+  inline generator &operator=(generator &&rhs) noexcept {
+    if (this == &rhs)
+      return *this;
+    if (coroutine)
+      coroutine.destroy();
+    coroutine = std::exchange(rhs.coroutine, {});
+    return *this;
+  }
+  inline ~generator() noexcept {
+    if (coroutine)
+      coroutine.destroy();
+  }
+
+public:
+  /// @brief run the coroutine up to its first value
+  /// @pre begin() has not been called before
+  WAVER_NODISCARD inline iterator begin() {
+    resume(coroutine);
+    return iterator{coroutine};
+  }
+  WAVER_NODISCARD inline std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+  inline explicit generator(const std::coroutine_handle<promise_type> coroutine) noexcept : coroutine(coroutine) {}
+
+  inline static void resume(const std::coroutine_handle<promise_type> coroutine) {
+    if (not coroutine or coroutine.done())
+      return;
+    coroutine.resume();
+    if (auto &error = coroutine.promise().error)
+      std::rethrow_exception(std::exchange(error, nullptr));
+  }
+
+private:
+  std::coroutine_handle<promise_type> coroutine;
+};
+#endif
+} // namespace net::ancillarycat::waver
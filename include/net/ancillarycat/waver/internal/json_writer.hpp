@@ -0,0 +1,182 @@
+/**************************************************************************************
+ * @file json_writer.hpp
+ * @brief a buffered, streaming JSON emitter that never builds a DOM.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "config.hpp"
+#include "contract.hpp"
+
+namespace net::ancillarycat::waver {
+/// @brief writes JSON token by token into a fixed-size buffer that is flushed to an output stream
+/// @note the layout of pretty-printed output matches `nlohmann::json::dump(indent)`; member order is the order of
+///       the calls, not sorted.
+class json_writer {
+public:
+  using size_type     = std::size_t;
+  using string_view_t = std::string_view;
+  using ostream_t     = std::ostream;
+
+  /// @brief bytes buffered before they are handed to the stream
+  static inline constexpr size_type default_buffer_size = size_type{1} << 20;
+
+public:
+  /// @param output the stream to write to
+  /// @param indent spaces per nesting level; negative for compact output
+  /// @param buffer_size bytes buffered before they are handed to the stream
+  inline explicit json_writer(ostream_t &output, const int indent = -1,
+                              const size_type buffer_size = default_buffer_size) :
+      output(output), indent(indent), capacity(buffer_size) {
+    buffer.reserve(capacity + 64);
+  }
+
+  inline json_writer(const json_writer &)            = delete;
+  inline json_writer &operator=(const json_writer &) = delete;
+  inline ~json_writer() noexcept { flush(); }
+
+public:
+  inline json_writer &begin_object() { return open('{'); }
+  inline json_writer &end_object() { return close('}'); }
+  inline json_writer &begin_array() { return open('['); }
+  inline json_writer &end_array() { return close(']'); }
+
+  /// @brief write the key of the next object member
+  inline json_writer &key(const string_view_t name) {
+    WAVER_PRECONDITION(not frames.empty());
+
+    separate();
+    write_string(name);
+    buffer.append(indent < 0 ? ":" : ": ");
+    after_key = true;
+    return *this;
+  }
+
+  inline json_writer &value(const string_view_t text) {
+    separate();
+    write_string(text);
+    return maybe_flush();
+  }
+  inline json_writer &value(const char *const text) { return value(string_view_t{text}); }
+  inline json_writer &value(const std::integral auto number) {
+    separate();
+    char       digits[24];
+    const auto [end, _] = std::to_chars(digits, digits + sizeof digits, number);
+    buffer.append(digits, end);
+    return maybe_flush();
+  }
+  inline json_writer &null() {
+    separate();
+    buffer.append("null");
+    return maybe_flush();
+  }
+
+  /// @brief hand everything buffered so far to the stream
+  inline json_writer &flush() {
+    if (not buffer.empty()) {
+      output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+      buffer.clear();
+    }
+    return *this;
+  }
+
+private:
+  inline json_writer &open(const char bracket) {
+    separate();
+    buffer.push_back(bracket);
+    frames.emplace_back(true);
+    return *this;
+  }
+  inline json_writer &close(const char bracket) {
+    WAVER_PRECONDITION(not frames.empty());
+
+    const auto empty = frames.back();
+    frames.pop_back();
+    if (not empty)
+      newline();
+    buffer.push_back(bracket);
+    return maybe_flush();
+  }
+
+  /// @brief emit the comma and line break that precede a value or key, unless it directly follows its key
+  inline void separate() {
+    if (std::exchange(after_key, false) or frames.empty())
+      return;
+    if (not frames.back())
+      buffer.push_back(',');
+    frames.back() = false;
+    newline();
+  }
+  inline void newline() {
+    if (indent < 0)
+      return;
+    buffer.push_back('\n');
+    buffer.append(frames.size() * static_cast<size_type>(indent), ' ');
+  }
+
+  inline void write_string(const string_view_t text) {
+    static constexpr char hex[] = "0123456789abcdef";
+    buffer.push_back('"');
+    for (const auto c : text) {
+      switch (c) {
+      case '"':
+        buffer.append("\\\"");
+        break;
+      case '\\':
+        buffer.append("\\\\");
+        break;
+      case '\b':
+        buffer.append("\\b");
+        break;
+      case '\f':
+        buffer.append("\\f");
+        break;
+      case '\n':
+        buffer.append("\\n");
+        break;
+      case '\r':
+        buffer.append("\\r");
+        break;
+      case '\t':
+        buffer.append("\\t");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          buffer.append("\\u00");
+          buffer.push_back(hex[(c >> 4) & 0xf]);
+          buffer.push_back(hex[c & 0xf]);
+        } else
+          buffer.push_back(c);
+      }
+    }
+    buffer.push_back('"');
+  }
+
+  inline json_writer &maybe_flush() {
+    if (buffer.size() >= capacity)
+      flush();
+    return *this;
+  }
+
+private:
+  ostream_t &output;
+  /// @brief spaces per nesting level, negative for compact output
+  const int indent;
+  /// @brief flush threshold
+  const size_type capacity;
+  /// @brief pending output
+  std::string buffer;
+  /// @brief one entry per open object or array, true while it has no element yet
+  std::vector<bool> frames;
+  /// @brief whether a key was just written, i.e. the next value needs no separator
+  bool after_key = false;
+};
+} // namespace net::ancillarycat::waver
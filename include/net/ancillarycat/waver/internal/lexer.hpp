@@ -1,6 +1,7 @@
 #pragma once
 #include <absl/status/status.h>
 #include <algorithm>
+#include <array>
 #include "contract.hpp"
 #ifdef WAVER_USE_BOOST_CONTRACT
 #include <boost/contract.hpp>
@@ -13,6 +14,7 @@
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <limits>
 #include <memory>
@@ -26,6 +28,10 @@
 #include <utility>
 #include <vector>
 #include "config.hpp"
+#include "decompressor.hpp"
+#include "mapped_file.hpp"
+#include "token.hpp"
+#include "tokenizer.hpp"
 #include "vcd_fwd.hpp"
 
 namespace net::ancillarycat::waver {
@@ -34,7 +40,8 @@ namespace net::ancillarycat::waver {
 /// @tparam StringType the string type
 /// @tparam InputStreamType the input stream type
 /// @tparam OutputStringStreamType the output string stream type
-/// @note the file reader is not thread-safe, and will consume a lot of memory if the file is too big. @todo here.
+/// @note the file reader is not thread-safe; get_contents() copies the whole file into memory, prefer map() for big
+///       files.
 template <typename PathType = std::filesystem::path, typename StringType = std::string,
           typename InputStreamType = std::ifstream, typename OutputStringStreamType = std::ostringstream>
 class file_reader {
@@ -50,9 +57,24 @@ public:
   inline constexpr ~file_reader() noexcept = default;
 
 public:
-  /// @brief get the contents of the file
-  /// @return the contents of the file
+  /// @brief get the contents of the file, decompressed if it is a gzip or zstd file (see decompressor)
+  /// @return the contents of the file, empty if it cannot be read or decompressed
   WAVER_NODISCARD inline string_t get_contents() const {
+    auto mapping = map();
+    if (const auto format = decompressor::detect(mapping.view()); format != compression::kNone) {
+      if (not decompressor::supported(format))
+        return string_t{};
+      auto inflater = decompressor{std::move(mapping), format};
+      auto contents = string_t{};
+      for (auto size = contents.size();; size = contents.size()) {
+        contents.resize(size + decompressor::default_buffer_size);
+        const auto read = inflater.read(contents.data() + size, decompressor::default_buffer_size);
+        contents.resize(size + read);
+        if (read == 0)
+          break;
+      }
+      return inflater.status().ok() ? contents : string_t{};
+    }
     ifstream_t file(filepath);
     if (not file)
       return std::string{};
@@ -61,6 +83,14 @@ public:
     return ss.str();
   }
 
+  /// @brief map the file read-only into memory, hinting a sequential scan
+  /// @return the mapping, which is empty if the file could not be opened or has no contents
+  WAVER_NODISCARD inline mapped_file map() const noexcept {
+    auto mapping = mapped_file{filepath};
+    mapping.advise(mapped_file::kSequential);
+    return mapping;
+  }
+
   /// @brief get the path to the file
   /// @return the path to the file
   WAVER_NODISCARD inline path_t path() const noexcept { return filepath; }
@@ -71,8 +101,15 @@ private:
 };
 
 /// @brief a simple lexer that reads a file and tokenizes it
-/// @note the lexer is not thread-safe, and will consume a lot of memory if the file is too big. 
-/// @todo here.
+/// @note the lexer is not thread-safe. Files are memory-mapped and never copied, so the text of every token points
+///       directly into the mapping (or into the owned string when loaded from memory).
+/// @note every token is classified as it is lexed, see token_kind, so that the parser switches on its kind rather
+///       than comparing its text against every keyword in turn.
+/// @note in streaming mode (see load_stream()) only a bounded window of the input is tokenized at a time; the
+///       current()/consume() contract is unchanged, but a token view only stays valid until the lexer has moved
+///       past the window that follows it.
+/// @note a gzip or zstd file is always streamed, see decompressor: it is inflated on a separate thread while the
+///       windows already inflated are tokenized, and never written out uncompressed.
 template <typename StringType = std::string, typename StringViewType = std::string_view,
           typename PathType = std::filesystem::path, typename BooleanType = bool, typename StatusType = absl::Status>
 class lexer {
@@ -83,7 +120,21 @@ public:
   using path_t        = PathType;
   using boolean_t     = BooleanType;
   using status_t      = StatusType;
-  using token_views_t = std::vector<string_view_t>;
+  using token_t       = token;
+  using tokens_t      = std::vector<token_t>;
+  /// @brief reads up to `size` bytes into the buffer and returns the number of bytes read, 0 means end of input
+  using chunk_reader_t = std::function<size_type(char *, size_type)>;
+
+  /// @brief the buffers a lexer grows while lexing, handed from one lexer to the next by release() and reuse()
+  struct buffers_t {
+    tokens_t                tokens;
+    std::array<string_t, 2> windows;
+  };
+
+  /// @brief default number of bytes read per window in streaming mode
+  static inline constexpr size_type default_window_size = size_type{1} << 20;
+  /// @brief the characters separating two tokens
+  static inline constexpr auto separators = " \n\r\t\v\f"sv;
 
 public:
   inline explicit constexpr lexer() = default;
@@ -100,13 +151,17 @@ public:
   /// @brief load the contents of the file
   /// @param filepath the path to the file
   /// @return OkStatus() if successful, NotFoundError() otherwise
+  /// @note a compressed file is streamed instead, see load_stream()
   inline status_t load(const path_t &filepath) {
-    if (not contents.empty())
+    if (not source.empty())
       return AlreadyExistsError("File already loaded");
     file_reader reader(filepath);
-    contents = reader.get_contents();
-    if (contents.empty())
+    mapping = reader.map();
+    if (mapping.empty())
       return NotFoundError("Unable to open file: " + filepath.string());
+    if (const auto format = decompressor::detect(mapping.view()); format != compression::kNone)
+      return load_compressed(std::exchange(mapping, mapped_file{}), format, default_window_size);
+    source = mapping.view();
     return OkStatus();
   }
 
@@ -114,86 +169,254 @@ public:
   /// @param content the contents of the file
   /// @return OkStatus() if successful, AlreadyExistsError() otherwise
   inline status_t load(string_t &&content) {
-    if (not contents.empty())
+    if (not source.empty())
       return AlreadyExistsError("Content already loaded");
     contents = std::move(content);
+    source   = contents;
+    return OkStatus();
+  }
+
+  /// @brief lex a view of bytes owned by someone else, which has to outlive the lexer
+  /// @param content the bytes to lex
+  /// @return OkStatus() if successful, AlreadyExistsError() otherwise
+  inline status_t borrow(const string_view_t content) {
+    if (not source.empty() or reader)
+      return AlreadyExistsError("Content already loaded");
+    source = content;
+    return OkStatus();
+  }
+
+  /// @brief stream the contents of the file through a bounded window instead of mapping it whole
+  /// @param filepath the path to the file
+  /// @param window_size the number of bytes read per window
+  /// @return OkStatus() if successful, NotFoundError() otherwise
+  inline status_t load_stream(const path_t &filepath, const size_type window_size = default_window_size) {
+    auto stream = std::make_shared<std::ifstream>(filepath, std::ios::binary);
+    if (not *stream)
+      return NotFoundError("Unable to open file: " + filepath.string());
+    char magic[4] = {};
+    stream->read(magic, sizeof magic);
+    if (const auto format = decompressor::detect({magic, static_cast<size_type>(stream->gcount())});
+        format != compression::kNone)
+      return load_compressed(file_reader{filepath}.map(), format, window_size);
+    stream->clear();
+    stream->seekg(0);
+    return load_stream(
+      [stream = std::move(stream)](char *buffer, const size_type size) -> size_type {
+        stream->read(buffer, static_cast<std::streamsize>(size));
+        return static_cast<size_type>(stream->gcount());
+      },
+      window_size);
+  }
+
+  /// @brief stream the contents produced by `chunk_reader` through a bounded window
+  /// @param chunk_reader the byte source, see chunk_reader_t
+  /// @param window_size the number of bytes read per window
+  /// @return OkStatus() if successful, AlreadyExistsError() otherwise
+  inline status_t load_stream(chunk_reader_t &&chunk_reader, const size_type window_size = default_window_size) {
+    WAVER_PRECONDITION(window_size > 0);
+
+    if (not source.empty() or reader)
+      return AlreadyExistsError("Content already loaded");
+    reader       = std::move(chunk_reader);
+    window_bytes = window_size;
     return OkStatus();
   }
 
   /// @brief lex the contents of the file
+  /// @param length only tokenize the first `length` bytes, the rest is left to the caller
   /// @return OkStatus() if successful, NotFoundError() otherwise
-  inline status_t lex() {
-    if (contents.empty())
+  /// @note the source is never modified; spaces, tabs and line breaks are all treated as separators.
+  /// @note in streaming mode only the first window is tokenized here, the rest follows as the cursor advances;
+  ///       `length` is ignored.
+  inline status_t lex(const size_type length = string_view_t::npos) {
+    if (reader) {
+      next_window();
+      if (tokens.size() == 1)
+        return NotFoundError("No content to lex");
+      return OkStatus();
+    }
+    if (source.empty())
       return NotFoundError("No content to lex");
-    std::ranges::replace_if(contents, [](auto &&c) { return (c == '\r') || (c == '\n'); }, ' ');
-    // clang-format off
-		token_views = contents
-			| std::ranges::views::split(' ')
-			| std::ranges::views::filter([](auto &&token_view) { return not token_view.empty(); })
-			| std::ranges::views::transform([](auto &&token_view) { return string_view_t(token_view.begin(), token_view.end()); }) // NOLINT(bugprone-dangling-handle)
-			| std::ranges::to<token_views_t>();
-    // clang-format on
-    token_views.emplace_back(empty_sv);
+    tokenize(source.substr(0, length));
+    tokens.emplace_back();
     return OkStatus();
   }
 
   /// @brief get the first element
   /// @pre the container is not empty
-  WAVER_NODISCARD inline string_view_t front() const noexcept {
-    WAVER_PRECONDITION(not token_views.empty());
+  WAVER_NODISCARD inline token_t front() const noexcept {
+    WAVER_PRECONDITION(not tokens.empty());
 
-    return token_views.front();
+    return tokens.front();
   }
 
   /// @brief get the current element
-  /// @note if the cursor is out of bounds, return the last element, which is an empty string_view_t
-  WAVER_NODISCARD inline string_view_t current() const /*noexcept*/ {
-    return cursor < token_views.size() ? token_views[cursor] : token_views.back();
+  /// @note if the cursor is out of bounds, return the last element, which is a token_kind::kEof
+  WAVER_NODISCARD inline token_t current() const /*noexcept*/ {
+    return cursor < tokens.size() ? tokens[cursor] : tokens.back();
   }
 
   /// @brief get the element at the back of the container
   /// @pre the container is not empty
-  /// @note will always be an empty string_view_t
-  WAVER_NODISCARD inline string_view_t back() const noexcept {
+  /// @note will always be a token_kind::kEof
+  WAVER_NODISCARD inline token_t back() const noexcept {
 
-    WAVER_PRECONDITION(not token_views.empty());
+    WAVER_PRECONDITION(not tokens.empty());
 
-    return token_views.back();
+    return tokens.back();
   }
 
+  /// @brief the whole input, empty in streaming mode
+  WAVER_NODISCARD inline string_view_t view() const noexcept { return source; }
+
+  /// @brief OkStatus(), or why a compressed input could not be inflated completely
+  /// @note the tokens lexed so far are still valid, but end where decompression stopped
+  WAVER_NODISCARD inline status_t stream_status() const { return inflater ? inflater->status() : OkStatus(); }
+
+  /// @brief the number of tokens produced so far, across all windows
+  WAVER_NODISCARD inline size_type tokens_produced() const noexcept { return produced_tokens; }
+  /// @brief the number of bytes tokenized so far, across all windows
+  WAVER_NODISCARD inline size_type bytes_tokenized() const noexcept { return tokenized_bytes; }
+  /// @brief the number of bytes the chunk reader produced so far in streaming mode, 0 otherwise
+  WAVER_NODISCARD inline size_type bytes_read() const noexcept { return read_bytes; }
+
   /// @brief check whether the content is empty
-  WAVER_NODISCARD inline boolean_t is_empty() const noexcept { return token_views.empty(); }
+  WAVER_NODISCARD inline boolean_t is_empty() const noexcept { return tokens.empty(); }
 
   ///	@brief consume the current token
   ///	@param [in] step the number of tokens to skip
-  /// @pre cursor < token_views.size()
+  /// @pre cursor < tokens.size()
   ///	@return the current token
   /// @todo I admit this is a poor api design, but I've already used it in the parser, so I'm keeping it now.
   ///	@note get the next token and ADVANCE the cursor;
   ///				consume() will ALWAYS return the current token, no matter how big the step is;
   ///				the step is the short hand for discarding the current token;
   ///				if the return value was intended to be used, DONT use the step parameter
-  inline string_view_t consume(size_type step = 1) {
-    WAVER_PRECONDITION(cursor < token_views.size());
+  inline token_t consume(size_type step = 1) {
+    WAVER_PRECONDITION(cursor < tokens.size());
 
-    auto token = token_views[cursor];
+    auto token = tokens[cursor];
     cursor += step;
+    // the last element is always the kEof sentinel; refill the window once the cursor reaches it
+    while (cursor + 1 >= tokens.size() and reader and not exhausted) {
+      cursor -= std::min(cursor, tokens.size() - 1);
+      next_window();
+    }
     return token;
   }
+  /// @brief give up the token and window buffers, emptied but keeping their capacity, see reuse()
+  /// @note the tokens are gone afterwards, the lexer can only be destroyed
+  WAVER_NODISCARD inline buffers_t release() noexcept {
+    tokens.clear();
+    cursor = 0;
+    return {std::move(tokens), std::move(windows)};
+  }
+  /// @brief lex into the buffers an earlier lexer released, rather than growing new ones from scratch
+  /// @pre nothing has been lexed yet
+  inline void reuse(buffers_t &&buffers) noexcept {
+    WAVER_PRECONDITION(tokens.empty());
+
+    tokens = std::move(buffers.tokens);
+    tokens.clear();
+    windows = std::move(buffers.windows);
+  }
   /// @brief print all tokens, mainly for debugging purposes
   inline lexer &print_tokens() {
-    for (auto &&token : token_views)
-      std::println("token: {}", token); // cannot use `token.data()` since string_view_t
+    for (auto &&token : tokens)
+      std::println("token: {}", token.text()); // cannot use `token.text().data()` since string_view_t
     // is not null-terminated
     return *this;
   }
 
+private:
+  /// @brief stream the decompressed contents of `compressed`
+  inline status_t load_compressed(mapped_file &&compressed, const compression format, const size_type window_size) {
+    if (not decompressor::supported(format))
+      return absl::UnimplementedError(format == compression::kGzip ? "Built without gzip support, see WAVER_USE_ZLIB"
+                                                                   : "Built without zstd support, see WAVER_USE_ZSTD");
+    // the window is filled from the ring of the decompressor, so both overlap
+    inflater = std::make_shared<decompressor>(std::move(compressed), format);
+    return load_stream(
+      [inflater = inflater](char *buffer, const size_type size) { return inflater->read(buffer, size); }, window_size);
+  }
+
+  /// @brief split `text` at separators and append the tokens, classified, to `tokens`
+  inline void tokenize(const string_view_t text) {
+    const auto before = tokens.size();
+    tokenizer::split(text, [this](const std::string_view text) { tokens.emplace_back(text); });
+    produced_tokens += tokens.size() - before;
+    tokenized_bytes += text.size();
+  }
+
+  /// @brief read and tokenize the next window, carrying over the token that straddled the previous one
+  /// @note the windows are double-buffered: the window being replaced stays untouched until the next call, so
+  ///       views handed out just before a refill are still valid after it.
+  inline void next_window() {
+    auto      &buffer = windows[active_window ^ 1];
+    const auto carry  = pending;
+    if (buffer.size() < carry.size() + window_bytes)
+      buffer.resize(carry.size() + window_bytes);
+    std::ranges::copy(carry, buffer.data());
+    auto filled   = carry.size();
+    auto complete = size_type{0};
+
+    tokens.clear();
+    while (tokens.empty() and not exhausted) {
+      if (filled == buffer.size())
+        // a single token is larger than the window, grow it
+        buffer.resize(buffer.size() * 2);
+      const auto read = reader(buffer.data() + filled, buffer.size() - filled);
+      exhausted       = read == 0;
+      filled += read;
+      read_bytes += read;
+
+      // only tokenize up to the last separator, the remainder may continue in the next window;
+      // `npos + 1` wraps around to 0 when there is no separator at all
+      complete = exhausted ? filled : string_view_t{buffer.data(), filled}.find_last_of(separators) + 1;
+      tokenize({buffer.data(), complete});
+      if (tokens.empty()) {
+        // whitespace-only, drop it in place rather than handing an empty window to the parser
+        std::ranges::copy(string_view_t{buffer.data() + complete, filled - complete}, buffer.data());
+        filled -= complete;
+        complete = 0;
+      }
+    }
+    pending       = {buffer.data() + complete, filled - complete};
+    active_window ^= 1;
+    tokens.emplace_back();
+  }
+
 private:
   /// @brief current cursor position
   size_type cursor = 0;
-  /// @brief the contents of the file
+  /// @brief the contents, only used when loaded from memory
   string_t contents;
-  /// @brief non-owning views
-  token_views_t token_views;
+  /// @brief the read-only mapping of the file, only used when loaded from a path
+  mapped_file mapping;
+  /// @brief the bytes being lexed, either `contents` or `mapping`
+  string_view_t source;
+  /// @brief the byte source in streaming mode, empty otherwise
+  chunk_reader_t reader;
+  /// @brief the decompressor feeding `reader`, if the input is compressed
+  std::shared_ptr<decompressor> inflater;
+  /// @brief double-buffered windows of the stream
+  std::array<string_t, 2> windows;
+  /// @brief index of the window the tokens currently point into
+  size_type active_window = 0;
+  /// @brief number of bytes read per window
+  size_type window_bytes = default_window_size;
+  /// @brief the incomplete trailing token of the active window
+  string_view_t pending;
+  /// @brief whether the byte source has been drained
+  boolean_t exhausted = false;
+  /// @brief the tokens of the input, or of the active window, then a kEof
+  tokens_t tokens;
+  /// @brief see tokens_produced()
+  size_type produced_tokens = 0;
+  /// @brief see bytes_tokenized()
+  size_type tokenized_bytes = 0;
+  /// @brief see bytes_read()
+  size_type read_bytes = 0;
 };
 } // namespace net::ancillarycat::waver
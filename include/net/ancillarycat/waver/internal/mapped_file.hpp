@@ -0,0 +1,151 @@
+/**************************************************************************************
+ * @file mapped_file.hpp
+ * @brief read-only memory mapping of a file, used as the zero-copy input of the lexer.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <utility>
+#include "config.hpp"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace net::ancillarycat::waver {
+/// @brief a read-only, private mapping of a whole file
+/// @note the mapping is move-only; an empty mapping (failed to open, or zero-sized file) has a null data()
+class mapped_file {
+public:
+  using size_type     = std::size_t;
+  using path_t        = std::filesystem::path;
+  using string_view_t = std::string_view;
+
+  /// @brief the expected access pattern, forwarded to the kernel as a hint
+  enum access_pattern : std::uint8_t;
+
+public:
+  inline explicit constexpr mapped_file() noexcept = default;
+  inline explicit mapped_file(const path_t &filepath) noexcept { map(filepath); }
+
+  inline mapped_file(const mapped_file &)            = delete;
+  inline mapped_file &operator=(const mapped_file &) = delete;
+
+  inline mapped_file(mapped_file &&rhs) noexcept :
+      address(std::exchange(rhs.address, nullptr)), length(std::exchange(rhs.length, 0)) {}
+  inline mapped_file &operator=(mapped_file &&rhs) noexcept {
+    if (this == &rhs)
+      return *this;
+    unmap();
+    address = std::exchange(rhs.address, nullptr);
+    length  = std::exchange(rhs.length, 0);
+    return *this;
+  }
+
+  inline ~mapped_file() noexcept { unmap(); }
+
+public:
+  WAVER_NODISCARD inline const char   *data() const noexcept { return address; }
+  WAVER_NODISCARD inline size_type     size() const noexcept { return length; }
+  WAVER_NODISCARD inline bool          empty() const noexcept { return length == 0; }
+  WAVER_NODISCARD inline string_view_t view() const noexcept { return {address, length}; }
+
+  /// @brief hint the kernel about how the mapping is going to be read
+  /// @note a no-op where the platform has no such facility
+  inline const mapped_file &advise(const access_pattern pattern) const noexcept {
+    if (empty())
+      return *this;
+#ifndef _WIN32
+    auto advice = MADV_NORMAL;
+    if (pattern == kSequential)
+      advice = MADV_SEQUENTIAL;
+    else if (pattern == kWillNeed)
+      advice = MADV_WILLNEED;
+    else if (pattern == kDontNeed)
+      advice = MADV_DONTNEED;
+    ::madvise(const_cast<char *>(address), length, advice);
+#else
+    if (pattern == kWillNeed or pattern == kSequential) {
+      auto range = WIN32_MEMORY_RANGE_ENTRY{const_cast<char *>(address), length};
+      ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+    }
+#endif
+    return *this;
+  }
+
+public:
+  enum access_pattern : std::uint8_t {
+    kNormal     = 0,
+    kSequential = 1,
+    kWillNeed   = 2,
+    kDontNeed   = 3,
+  };
+
+private:
+  inline void map(const path_t &filepath) noexcept {
+#ifndef _WIN32
+    const auto fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return;
+    struct stat st{};
+    if (::fstat(fd, &st) == 0 and st.st_size > 0) {
+      auto *ptr = ::mmap(nullptr, static_cast<size_type>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (ptr != MAP_FAILED) {
+        address = static_cast<const char *>(ptr);
+        length  = static_cast<size_type>(st.st_size);
+      }
+    }
+    // the mapping holds its own reference to the file
+    ::close(fd);
+#else
+    const auto file = ::CreateFileW(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                    OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return;
+    auto file_size = LARGE_INTEGER{};
+    if (::GetFileSizeEx(file, &file_size) and file_size.QuadPart > 0) {
+      if (const auto mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) {
+        if (auto *ptr = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) {
+          address = static_cast<const char *>(ptr);
+          length  = static_cast<size_type>(file_size.QuadPart);
+        }
+        ::CloseHandle(mapping);
+      }
+    }
+    ::CloseHandle(file);
+#endif
+  }
+
+  inline void unmap() noexcept {
+    if (address == nullptr)
+      return;
+#ifndef _WIN32
+    ::munmap(const_cast<char *>(address), length);
+#else
+    ::UnmapViewOfFile(address);
+#endif
+    address = nullptr;
+    length  = 0;
+  }
+
+private:
+  /// @brief start of the mapping, nullptr if nothing is mapped
+  const char *address = nullptr;
+  /// @brief size of the mapping in bytes
+  size_type length = 0;
+};
+} // namespace net::ancillarycat::waver
@@ -1,13 +1,22 @@
 #pragma once
+#include <algorithm>
 #ifdef WAVER_USE_BOOST_CONTRACT
 #include <boost/contract/check.hpp>
 #include <boost/contract/function.hpp>
 #endif
+#include <bit>
+#include <charconv>
 #include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <memory_resource>
 #include <nlohmann/json.hpp>
 #include <nlohmann/json_fwd.hpp>
 #include <print>
+#include <ranges>
+#include <span>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -15,51 +24,72 @@
 #include <vector>
 #include "config.hpp"
 #include "contract.hpp"
+#include "four_state.hpp"
+#include "signal_filter.hpp"
+#include "signal_table.hpp"
 #include "variadic.h"
 #include "vcd_fwd.hpp"
 
 
 namespace net::ancillarycat::waver {
-/// @brief Represents the identifier of a port
-/// @note the identifier is a 1 or 2 character string
+/// @brief Represents a port (a `$var` declaration) of a module
+/// @note the identifier code is interned into a dense signal id, see signal_table
+/// @note the name and the reference are allocated from the allocator of the port, which a scope_table passes on to
+///       its ports, see allocator_t
 class port {
   friend class value_change_dump;
-  friend class module;
-  friend inline void to_json(json_t &j, const module &module);
+  friend class waveform_db;
+  friend class scope_table;
 
 public:
-  using json_t        = nlohmann::json;
-  using string_t      = std::string;
-  using string_view_t = std::string_view;
-  using size_t        = std::size_t;
+  using json_t         = nlohmann::json;
+  using string_t       = std::pmr::string;
+  using string_view_t  = std::string_view;
+  using size_t         = std::size_t;
+  using allocator_type = allocator_t;
 
 public:
   /// @brief Represents the type of the port
   enum type : std::uint8_t;
 
 public:
-  inline explicit constexpr port(const type type, const size_t width, identifier_t identifier, std::string name,
-                                 std::string reference) noexcept :
-      type(type), width(width), identifier(std::move(identifier)), name(std::move(name)),
-      reference(std::move(reference)) {}
-  inline constexpr port(const port &) noexcept = default;
-  inline constexpr port(port &&rhs) noexcept :
-      type(rhs.type), width(rhs.width), identifier(std::move(rhs.identifier)), name(std::move(rhs.name)),
+  inline explicit port(const type type, const size_t width, const signal_id_t signal, const string_view_t name,
+                       const string_view_t reference, const allocator_type &allocator = {}) :
+      type(type), width(width), signal(signal), name(name, allocator), reference(reference, allocator) {}
+  inline port(const port &rhs, const allocator_type &allocator = {}) :
+      type(rhs.type), width(rhs.width), signal(rhs.signal), name(rhs.name, allocator),
+      reference(rhs.reference, allocator) {}
+  inline port(port &&rhs) noexcept :
+      type(rhs.type), width(rhs.width), signal(rhs.signal), name(std::move(rhs.name)),
       reference(std::move(rhs.reference)) {}
-  inline constexpr virtual ~port() noexcept = default;
+  inline port(port &&rhs, const allocator_type &allocator) :
+      type(rhs.type), width(rhs.width), signal(rhs.signal), name(std::move(rhs.name), allocator),
+      reference(std::move(rhs.reference), allocator) {}
+  inline port &operator=(const port &) = default;
+  inline port &operator=(port &&)      = default;
+  inline ~port() noexcept              = default;
+
+public:
+  WAVER_NODISCARD inline enum type      get_type() const noexcept { return type; }
+  WAVER_NODISCARD inline size_t         get_width() const noexcept { return width; }
+  WAVER_NODISCARD inline signal_id_t    get_signal() const noexcept { return signal; }
+  WAVER_NODISCARD inline string_view_t  get_name() const noexcept { return name; }
+  WAVER_NODISCARD inline string_view_t  get_reference() const noexcept { return reference; }
+  WAVER_NODISCARD inline allocator_type get_allocator() const noexcept { return name.get_allocator(); }
 
   /// @brief friend function to convert the port to json, i.e., serialize it
   /// @param j the json object
   /// @param port the port to serialize
+  /// @param signals the table the port's signal id was interned in
   /// @note the json object will be an object with the port name as the key
-  friend inline void to_json(port::json_t &j, const port &port) {
+  friend inline void to_json(port::json_t &j, const port &port, const signal_table &signals) {
     // clang-format off
-		j = port::json_t{{port.name, // <- key, value vvv
+		j = port::json_t{{string_view_t{port.name}, // <- key, value vvv
 			{
 					 {"type", port.type},
 					 {"width", port.width},
-					 {"identifier", port.identifier},
-					 {"reference", port.reference}
+					 {"identifier", signals.code(port.signal)},
+					 {"reference", string_view_t{port.reference}}
 			}
 		}};
     // clang-format on
@@ -77,216 +107,341 @@ public:
   };
 
 private:
-  type         type = kUnknown;
-  size_t       width;
-  identifier_t identifier; // 1 or 2 characters
-  string_t     name;
-  string_t     reference; // [4:0], a[0], a[4:0]
+  type        type = kUnknown;
+  size_t      width;
+  signal_id_t signal = invalid_signal_id;
+  string_t    name;
+  string_t    reference; // [4:0], a[0], a[4:0]
 };
 
-/*!
- * 	@brief Represents the base class for all scope values
- * 	@interface scope_value_base
- */
-class scope_value_base {
-  friend class value_change_dump;
-  friend class scope;
+/// @brief the kind of a `$scope`
+enum class scope_kind : std::uint8_t {
+  kUnknown  = 0,
+  kModule   = 1,
+  kTask     = 2,
+  kFunction = 3,
+  kBegin    = 4,
+  kFork     = 5,
+};
 
-public:
-  using json_t        = nlohmann::json;
-  using string_t      = std::string;
-  using string_view_t = std::string_view;
-  /// @brief Represents the type of the scope.
-  enum scope_type : std::uint8_t;
+/// @brief the scope hierarchy of a dump, flattened into arrays in pre-order
+/// @note the subtree of scope `i` is the range of indices `[i, end(i))`: its first child is `i + 1` if that is below
+///       `end(i)`, and the next sibling of `i` is `end(i)`. Walking the hierarchy, or visiting everything below a
+///       scope, is thus a linear scan, without pointers, reference counts or virtual calls.
+/// @note ports are grouped by their scope in the same order, so the ports declared in a scope are one contiguous
+///       range, see ports(), and so are all the ports below it, see subtree_ports().
+/// @note built by open(), add_port() and close() while parsing; the ports of a top-level scope are only grouped once
+///       it is closed.
+class scope_table {
+  friend class waveform_db;
 
 public:
-  inline explicit constexpr scope_value_base() = default;
-  virtual inline constexpr ~scope_value_base() = default;
-  inline constexpr scope_value_base(const scope_value_base &) {} // NOLINT(*-use-equals-default)
-  inline constexpr scope_value_base(scope_value_base &&) noexcept {}
-  WAVER_NODISCARD WAVER_FORCEINLINE constexpr scope_type get_type() const noexcept { return get_type_impl(); }
-
-private:
-  WAVER_NODISCARD WAVER_FORCEINLINE virtual constexpr scope_type get_type_impl() const noexcept = 0;
-
-public:
-  enum scope_type : std::uint8_t {
-    kUnknown = 0,
-    kModule  = 1,
-    kTask    = 2,
+  using size_type      = std::size_t;
+  using index_t        = std::uint32_t;
+  using string_t       = std::pmr::string;
+  using string_view_t  = std::string_view;
+  using ports_t        = std::pmr::vector<port>;
+  using allocator_type = allocator_t;
+  using json_t         = nlohmann::json;
+
+  /// @brief the parent of a top-level scope, and the scope after the last sibling
+  static inline constexpr auto npos = std::numeric_limits<index_t>::max();
+
+  /// @brief a scope, at its pre-order index
+  struct entry {
+    /// @brief the name, in the name pool
+    size_type name_offset = 0;
+    index_t   name_size   = 0;
+    index_t   parent      = npos;
+    /// @brief one past the last scope of the subtree
+    index_t end = 0;
+    /// @brief the ports declared in the scope are `[first_port, first_port + ports)`, the ports of the whole subtree
+    ///        `[first_port, last_port)`
+    index_t    first_port = 0;
+    index_t    ports      = 0;
+    index_t    last_port  = 0;
+    scope_kind kind       = scope_kind::kUnknown;
   };
-};
-
-/// @brief Represents a module in a VCD file
-class module : public scope_value_base {
-  friend class value_change_dump;
-  friend class scope;
 
 public:
-  using ports_t = std::vector<port>;
+  inline explicit scope_table(const allocator_type &allocator = {}) :
+      entries(allocator), names(allocator), all_ports(allocator), owners(allocator), open_scopes(allocator) {}
+  inline scope_table(const scope_table &rhs, const allocator_type &allocator = {}) :
+      entries(rhs.entries, allocator), names(rhs.names, allocator), all_ports(rhs.all_ports, allocator),
+      owners(rhs.owners, allocator), open_scopes(rhs.open_scopes, allocator) {}
+  inline scope_table(scope_table &&) noexcept = default;
+  inline scope_table(scope_table &&rhs, const allocator_type &allocator) :
+      entries(std::move(rhs.entries), allocator), names(std::move(rhs.names), allocator),
+      all_ports(std::move(rhs.all_ports), allocator), owners(std::move(rhs.owners), allocator),
+      open_scopes(std::move(rhs.open_scopes), allocator) {}
+  inline scope_table &operator=(const scope_table &) = default;
+  inline scope_table &operator=(scope_table &&)      = default;
+  inline ~scope_table() noexcept                     = default;
 
 public:
-  inline explicit constexpr module() : scope_value_base() {}
-  inline constexpr module(const module &rhs) noexcept : scope_value_base(), ports(rhs.ports) {}
-  inline constexpr module(module &&rhs) noexcept : scope_value_base(), ports(std::move(rhs.ports)) {}
-  inline virtual constexpr ~module() noexcept override = default;
+  /// @brief the kind of a `$scope` keyword such as `module`, kUnknown if it is none
+  WAVER_NODISCARD inline static constexpr scope_kind kind_of(const string_view_t keyword) noexcept {
+    if (keyword == keywords::module)
+      return scope_kind::kModule;
+    if (keyword == keywords::task)
+      return scope_kind::kTask;
+    if (keyword == keywords::function)
+      return scope_kind::kFunction;
+    if (keyword == keywords::begin)
+      return scope_kind::kBegin;
+    if (keyword == keywords::fork)
+      return scope_kind::kFork;
+    return scope_kind::kUnknown;
+  }
+  /// @brief the keyword of a kind, `unknown` for kUnknown
+  WAVER_NODISCARD inline static constexpr string_view_t name_of(const scope_kind kind) noexcept {
+    switch (kind) {
+    case scope_kind::kModule:
+      return keywords::module;
+    case scope_kind::kTask:
+      return keywords::task;
+    case scope_kind::kFunction:
+      return keywords::function;
+    case scope_kind::kBegin:
+      return keywords::begin;
+    case scope_kind::kFork:
+      return keywords::fork;
+    default:
+      return "unknown"sv;
+    }
+  }
 
-private:
-  ports_t ports;
+public:
+  /// @brief start a scope within the innermost open one, or a top-level scope if none is open
+  /// @return its index
+  inline index_t open(const scope_kind kind, const string_view_t name) {
+    const auto index = static_cast<index_t>(entries.size());
+    entries.push_back({.name_offset = names.size(),
+                       .name_size   = static_cast<index_t>(name.size()),
+                       .parent      = open_scopes.empty() ? npos : open_scopes.back(),
+                       .first_port  = static_cast<index_t>(all_ports.size()),
+                       .kind        = kind});
+    names.append(name);
+    open_scopes.emplace_back(index);
+    return index;
+  }
 
-private:
-  WAVER_FORCEINLINE WAVER_NODISCARD virtual constexpr scope_type get_type_impl() const noexcept override { return scope_type::kModule; }
+  /// @brief declare a port in the innermost open scope
+  /// @pre a scope is open
+  inline void add_port(const enum port::type type, const size_type width, const signal_id_t signal,
+                       const string_view_t name, const string_view_t reference) {
+    WAVER_PRECONDITION(not open_scopes.empty());
 
-private:
-  friend inline void to_json(json_t &j, const module &module) {
-    std::ranges::for_each(module.ports, [&](auto &&port) {
-      auto port_json = json_t{};
-      to_json(port_json, port);
-      WAVER_RUNTIME_ASSERT(port_json.is_object());
-      WAVER_RUNTIME_ASSERT(port_json.front() == port_json.back());
-      j["ports"].merge_patch(port_json);
-    });
-  WAVER_POSTCONDITION(j.is_object());
+    all_ports.emplace_back(type, width, signal, name, reference);
+    owners.emplace_back(open_scopes.back());
+    ++entries[open_scopes.back()].ports;
   }
 
-};
-class task : public scope_value_base {
-  friend class value_change_dump;
-  friend class scope;
+  /// @brief end the innermost open scope
+  /// @pre a scope is open
+  inline void close() {
+    WAVER_PRECONDITION(not open_scopes.empty());
+
+    const auto index = open_scopes.back();
+    open_scopes.pop_back();
+    entries[index].end       = static_cast<index_t>(entries.size());
+    entries[index].last_port = static_cast<index_t>(all_ports.size());
+    if (open_scopes.empty())
+      group_ports(index);
+  }
 
 public:
-  inline explicit constexpr task() : scope_value_base() {}
-  inline constexpr task(const task &) noexcept : scope_value_base() {}
-  inline constexpr task(task &&) noexcept : scope_value_base() {}
-  inline virtual constexpr ~task() noexcept override = default;
-private:
-  WAVER_FORCEINLINE WAVER_NODISCARD virtual scope_type get_type_impl() const noexcept override { return scope_type::kTask; }
-  // todo: implement task
+  /// @brief the number of scopes
+  WAVER_NODISCARD inline size_type size() const noexcept { return entries.size(); }
+  WAVER_NODISCARD inline bool      empty() const noexcept { return entries.empty(); }
 
-private:
-  friend inline void to_json(json_t &j, const task &task) {
-    WAVER_POSTCONDITION(j.is_object());
+  /// @pre index < size()
+  WAVER_NODISCARD inline const entry &operator[](const index_t index) const noexcept {
+    WAVER_PRECONDITION(index < size());
 
-    j.emplace_back("task");
+    return entries[index];
+  }
+  WAVER_NODISCARD inline scope_kind    kind(const index_t index) const noexcept { return (*this)[index].kind; }
+  WAVER_NODISCARD inline string_view_t name(const index_t index) const noexcept {
+    const auto &scope = (*this)[index];
+    return string_view_t{names}.substr(scope.name_offset, scope.name_size);
+  }
+  WAVER_NODISCARD inline index_t parent(const index_t index) const noexcept { return (*this)[index].parent; }
+  WAVER_NODISCARD inline index_t end(const index_t index) const noexcept { return (*this)[index].end; }
+
+  /// @brief the first top-level scope, npos if there is none
+  WAVER_NODISCARD inline index_t first_root() const noexcept { return entries.empty() ? npos : 0; }
+  /// @brief the first child of a scope, npos if it has none
+  WAVER_NODISCARD inline index_t first_child(const index_t index) const noexcept {
+    return index + 1 < end(index) ? index + 1 : npos;
+  }
+  /// @brief the scope after `index` with the same parent, npos if it is the last one
+  WAVER_NODISCARD inline index_t next_sibling(const index_t index) const noexcept {
+    const auto next  = end(index);
+    const auto limit = parent(index) == npos ? size() : end(parent(index));
+    return next < limit ? next : npos;
   }
-};
-
-class scope {
-  friend class value_change_dump;
-
-public:
-  using json_t        = nlohmann::json;
-  using string_t      = std::string;
-  using string_view_t = std::string_view;
-  using scopes_t      = std::vector<std::shared_ptr<scope>>;
-  using data_ptr_t    = std::shared_ptr<scope_value_base>;
-  using module_t      = module;
-  using task_t        = task;
 
-public:
-  inline explicit constexpr scope() = default;
-  inline scope(const scope &rhs) noexcept : // NOLINT(*-use-equals-default)
-      name(rhs.name), subscopes(rhs.subscopes), data(rhs.data) {}
-
-  inline constexpr scope &operator=(const scope &other) noexcept {
-    if (this == &other)
-      return *this;
-    name      = other.name;
-    subscopes = other.subscopes;
-    data      = other.data;
-    return *this;
+  /// @brief the ports declared directly in a scope
+  WAVER_NODISCARD inline std::span<const port> ports(const index_t index) const noexcept {
+    const auto &scope = (*this)[index];
+    return std::span{all_ports}.subspan(scope.first_port, scope.ports);
+  }
+  /// @brief the ports declared in a scope and in every scope below it
+  WAVER_NODISCARD inline std::span<const port> subtree_ports(const index_t index) const noexcept {
+    const auto &scope = (*this)[index];
+    return std::span{all_ports}.subspan(scope.first_port, scope.last_port - scope.first_port);
+  }
+  /// @brief every port, grouped by scope in pre-order
+  WAVER_NODISCARD inline std::span<const port> ports() const noexcept { return all_ports; }
+  /// @brief the scope a port was declared in
+  /// @pre position < ports().size()
+  WAVER_NODISCARD inline index_t owner(const size_type position) const noexcept {
+    WAVER_PRECONDITION(position < owners.size());
+
+    return owners[position];
   }
 
-  inline scope(scope &&rhs) noexcept :
-      name(std::move(rhs.name)), subscopes(std::move(rhs.subscopes)), data(std::move(rhs.data)) {}
-  inline constexpr scope &operator=(scope &&other) noexcept {
-    if (this == &other)
-      return *this;
-    name      = std::move(other.name);
-    subscopes = std::move(other.subscopes);
-    data      = std::move(other.data);
-    return *this;
+  /// @brief look up a port by its hierarchical name, e.g. `TOP.ALU4.out`
+  /// @return the port, or nullptr if no port has that name
+  WAVER_NODISCARD inline const port *find_port(string_view_t path) const noexcept {
+    for (auto scope = first_root(); scope != npos;) {
+      const auto separator = path.find(signal_filter::separator);
+      if (separator == string_view_t::npos)
+        return nullptr;
+      if (name(scope) != path.substr(0, separator)) {
+        scope = next_sibling(scope);
+        continue;
+      }
+      path                = path.substr(separator + 1);
+      const auto declared = ports(scope);
+      if (const auto found = std::ranges::find(declared, path, &port::name); found != declared.end())
+        return std::to_address(found);
+      scope = first_child(scope);
+    }
+    return nullptr;
   }
-  inline constexpr ~scope() noexcept = default;
+
+  WAVER_NODISCARD inline allocator_type get_allocator() const noexcept { return entries.get_allocator(); }
 
 private:
-  /// @remark because it holds a shared_ptr, the to_json dinstincts with others.
-  friend inline void to_json(json_t &j, const scope &scope) {
-
-    auto subscopes_json = json_t{};
-    std::ranges::for_each(scope.subscopes, [&](auto &&subscope) { to_json(subscopes_json, *subscope); });
-    auto data_json = json_t{};
-    switch (scope.data->get_type()) {
-    case scope_value_base::scope_type::kModule: {
-      j["type"]   = "module";
-      auto module = std::dynamic_pointer_cast<module_t>(scope.data);
-      to_json(data_json, *module);
-      break;
-    }
-    case scope_value_base::scope_type::kTask: {
-      j["type"] = "task";
-      auto task = std::dynamic_pointer_cast<task_t>(scope.data);
-      to_json(data_json, *task);
-      break;
-    }
-    default: {
-      j["type"] = "unknown";
-      break;
+  /// @brief sort the ports of the subtree of the top-level scope `root` by scope, keeping their declaration order
+  ///        within a scope; a port declared after a nested scope has ended comes after that scope's ports until then
+  inline void group_ports(const index_t root) {
+    const auto base = entries[root].first_port;
+    if (std::ranges::is_sorted(std::span{owners}.subspan(base)))
+      return;
+    // the new first port of every scope, and the ports that go there
+    auto first = base;
+    for (auto index = root; index < entries.size(); ++index) {
+      auto &scope = entries[index];
+      scope.last_port -= scope.first_port;
+      scope.first_port = first;
+      first += scope.ports;
     }
+    auto next  = std::vector<index_t>(entries.size() - root);
+    auto order = std::vector<size_type>(all_ports.size() - base);
+    for (auto index = root; index < entries.size(); ++index)
+      next[index - root] = entries[index].first_port;
+    for (auto position = size_type{base}; position < all_ports.size(); ++position)
+      order[next[owners[position] - root]++ - base] = position;
+    auto grouped = ports_t{all_ports.get_allocator()};
+    grouped.reserve(order.size());
+    for (const auto position : order)
+      grouped.emplace_back(std::move(all_ports[position]));
+    all_ports.erase(all_ports.begin() + base, all_ports.end());
+    std::ranges::move(grouped, std::back_inserter(all_ports));
+    for (auto index = root; index < entries.size(); ++index) {
+      auto &scope = entries[index];
+      scope.last_port += scope.first_port;
+      std::ranges::fill_n(owners.begin() + scope.first_port, scope.ports, index);
     }
-    j["name"]      = scope.name;
-    j["data"]      = data_json; //! <- data json shall be an array
-    j["subscopes"] = subscopes_json;
+  }
 
-    WAVER_POSTCONDITION(j.is_object());
+  /// @brief the scopes as json objects, with the ports of each in `data`
+  friend inline void to_json(json_t &j, const scope_table &scopes, const signal_table &signals) {
+    j = json_t::array();
+    // the scopes whose subtree is still being visited, with the index their subtree ends at
+    auto open = std::vector<std::pair<index_t, json_t>>{};
+    const auto pop = [&] {
+      auto scope = std::move(open.back().second);
+      open.pop_back();
+      (open.empty() ? j : open.back().second["subscopes"]).emplace_back(std::move(scope));
+    };
+    for (index_t index = 0; index < scopes.size(); ++index) {
+      while (not open.empty() and open.back().first == index)
+        pop();
+      auto scope = json_t{{"type", name_of(scopes.kind(index))},
+                          {"name", scopes.name(index)},
+                          {"data", nullptr},
+                          {"subscopes", json_t::array()}};
+      if (scopes.kind(index) != scope_kind::kUnknown) {
+        auto &ports_json = scope["data"]["ports"] = json_t::object();
+        for (const auto &port : scopes.ports(index)) {
+          auto port_json = json_t{};
+          to_json(port_json, port, signals);
+          ports_json.update(port_json);
+        }
+      }
+      open.emplace_back(scopes.end(index), std::move(scope));
+    }
+    while (not open.empty())
+      pop();
   }
 
 private:
-  string_t   name;
-  scopes_t   subscopes;
-  data_ptr_t data;
+  /// @brief the scopes in pre-order
+  std::pmr::vector<entry> entries;
+  /// @brief the names of all scopes, back to back
+  string_t names;
+  /// @brief the ports, grouped by scope
+  ports_t all_ports;
+  /// @brief port -> the scope it was declared in
+  std::pmr::vector<index_t> owners;
+  /// @brief the scopes opened but not closed yet, outermost first
+  std::pmr::vector<index_t> open_scopes;
 };
 
-class timestamp {
-  friend class value_change_dump;
+/// @brief a single entry of the event log in value_changes
+/// @note logic values of up to inline_bits bits and reals are stored in `value` itself; anything else lives in the
+///       word pool of the owning value_changes and `value` is its offset there.
+struct change_event {
+  using kind_t = four_state_value::kind;
+
+  /// @brief the top two bits of `descriptor` hold the kind, the rest the width (or the length of a string)
+  static inline constexpr auto kind_shift = 30u;
+  static inline constexpr auto width_mask = (std::uint32_t{1} << kind_shift) - 1;
+  /// @brief the widest logic value packed into `value` as `a | b << 32`
+  static inline constexpr auto inline_bits = 32u;
+
+  /// @brief the signal that changed
+  signal_id_t signal = invalid_signal_id;
+  /// @brief the kind and width of the value
+  std::uint32_t descriptor = 0;
+  /// @brief the value itself, or its offset in the word pool
+  std::uint64_t value = 0;
+
+  WAVER_NODISCARD inline constexpr kind_t        kind() const noexcept { return kind_t(descriptor >> kind_shift); }
+  WAVER_NODISCARD inline constexpr std::uint32_t width() const noexcept { return descriptor & width_mask; }
+  WAVER_NODISCARD inline constexpr bool          is_inline() const noexcept {
+    return kind() == kind_t::kReal or (kind() == kind_t::kLogic and width() <= inline_bits);
+  }
+};
 
-public:
-  using changes_t = std::unordered_map<identifier_t, ports_value_t>;
+/// @brief a non-owning view of all changes at one simulation time
+struct timestamp {
   using time_t    = size_t;
-  using json_t    = nlohmann::json;
-
+  using changes_t = std::span<const change_event>;
 
-public:
-  inline explicit constexpr timestamp() = default;
-  inline timestamp(const time_t time, changes_t changes) noexcept : time(time), changes(std::move(changes)) {}
-  inline constexpr timestamp(const timestamp &rhs) = default;
-  inline timestamp(timestamp &&rhs) noexcept {
-    time    = rhs.time;
-    changes = std::move(rhs.changes);
-  }
-  inline constexpr timestamp &operator=(const timestamp &rhs) = default;
-  inline timestamp           &operator=(timestamp &&rhs) noexcept {
-    time    = rhs.time;
-    changes = std::move(rhs.changes);
-    return *this;
-  }
-  inline constexpr virtual ~timestamp() noexcept = default;
-
-private:
-  time_t    time = 0;
+  /// @brief the simulation time
+  time_t time = 0;
+  /// @brief the changes at that time, in file order
   changes_t changes;
-
-private:
-  /// @note strengthened
-  friend void to_json(json_t &j, const timestamp &timestamp) {
-    j[std::to_string(timestamp.time)].merge_patch(timestamp.changes);
-
-    WAVER_POSTCONDITION(j.is_object());
-  }
 };
 
 class version {
   friend class value_change_dump;
+  friend class waveform_db;
   using json_t   = nlohmann::json;
   using string_t = std::string;
 
@@ -311,6 +466,7 @@ private:
 
 class date {
   friend class value_change_dump;
+  friend class waveform_db;
   using json_t   = nlohmann::json;
   using string_t = std::string;
 
@@ -339,6 +495,7 @@ private:
 };
 class timescale {
   friend class value_change_dump;
+  friend class waveform_db;
   using json_t   = nlohmann::json;
   using string_t = std::string;
 
@@ -368,26 +525,35 @@ private:
 
 /// @brief Represents the header part of a VCD file, which contains the module
 /// definitions, timescale, and date
+/// @note the top-level scopes and the signal table come from the allocator of the header; the version, date and
+///       timescale are short enough to stay on the default resource
 class header {
   friend class value_change_dump;
+  friend class waveform_db;
+  friend class follower;
+  friend void to_json(json_t &j, const value_change_dump &vcd);
   using json_t   = nlohmann::json;
   using string_t = std::string;
 
 public:
-  using scopes_t = std::vector<std::shared_ptr<scope>>;
+  using scopes_t       = scope_table;
+  using allocator_type = allocator_t;
 
 public:
-  inline explicit constexpr header()      = default;
-  inline constexpr header(const header &) = default;
-  inline header(header &&rhs) noexcept {
-    scopes    = std::move(rhs.scopes);
-    version   = rhs.version;
-    date      = rhs.date;
-    timescale = rhs.timescale;
-  }
+  inline explicit header(const allocator_type &allocator = {}) : scopes(allocator), signals(allocator) {}
+  inline header(const header &rhs, const allocator_type &allocator = {}) :
+      scopes(rhs.scopes, allocator), signals(rhs.signals, allocator), version(rhs.version), date(rhs.date),
+      timescale(rhs.timescale) {}
+  inline header(header &&rhs) noexcept :
+      scopes(std::move(rhs.scopes)), signals(std::move(rhs.signals)), version(rhs.version), date(rhs.date),
+      timescale(rhs.timescale) {}
+  inline header(header &&rhs, const allocator_type &allocator) :
+      scopes(std::move(rhs.scopes), allocator), signals(std::move(rhs.signals), allocator), version(rhs.version),
+      date(rhs.date), timescale(rhs.timescale) {}
   inline constexpr header &operator=(const header &) = default;
   inline header           &operator=(header &&rhs) noexcept {
     scopes    = std::move(rhs.scopes);
+    signals   = std::move(rhs.signals);
     version   = rhs.version;
     date      = rhs.date;
     timescale = rhs.timescale;
@@ -395,75 +561,320 @@ public:
   }
   inline constexpr virtual ~header() noexcept = default;
 
+public:
+  /// @brief the interned identifier codes of all declared signals
+  WAVER_NODISCARD inline const signal_table &signal_codes() const noexcept { return signals; }
+  /// @brief the scope hierarchy and the ports declared in it
+  WAVER_NODISCARD inline const scope_table &hierarchy() const noexcept { return scopes; }
+
+  WAVER_NODISCARD inline allocator_type get_allocator() const noexcept { return scopes.get_allocator(); }
+
 private:
   friend void to_json(json_t &j, const header &header) {
-    auto scopes_json = json_t{};
-    std::ranges::for_each(header.scopes, [&](auto &&scope) { to_json(scopes_json, *scope); });
-    j["scopes"] = scopes_json;
+    to_json(j["scopes"], header.scopes, header.signals);
     to_json(j, header.version);
     to_json(j, header.date);
     to_json(j, header.timescale);
   }
 
 private:
-  scopes_t  scopes;
-  version   version;
-  date      date;
-  timescale timescale;
+  scopes_t     scopes;
+  signal_table signals;
+  version      version;
+  date         date;
+  timescale    timescale;
 };
 /// @brief Represents the value change part of a VCD file
+/// @note the changes are stored as a flat, time-major event log: `times[i]` owns the events from `offsets[i]` up to
+///       `offsets[i + 1]`. Values are bit-packed (see four_state_value); narrow ones sit in the event itself, wide
+///       ones in one contiguous word pool. Nothing is allocated per timestamp or per change besides the amortized
+///       growth of those arrays.
+/// @note the arrays come from the allocator of the log, see allocator_t; a timestamp is a view into them and
+///       allocates nothing
 class value_changes {
   friend class value_change_dump;
+  friend class value_index;
+  friend class waveform_db;
 
 public:
-  using timestamps_t = std::vector<timestamp>;
-  using json_t       = nlohmann::json;
-  using string_t     = std::string;
+  using size_type      = std::size_t;
+  using time_t         = timestamp::time_t;
+  using times_t        = std::pmr::vector<time_t>;
+  using offsets_t      = std::pmr::vector<size_type>;
+  using events_t       = std::pmr::vector<change_event>;
+  using word_t         = four_state::word_t;
+  using words_t        = std::pmr::vector<word_t>;
+  using json_t         = nlohmann::json;
+  using string_t       = std::string;
+  using allocator_type = allocator_t;
 
 public:
-  inline explicit constexpr value_changes()             = default;
-  inline constexpr value_changes(const value_changes &) = default;
-  inline constexpr value_changes(value_changes &&rhs) noexcept { timestamps = std::move(rhs.timestamps); }
+  inline explicit value_changes(const allocator_type &allocator = {}) :
+      times(allocator), offsets(allocator), events(allocator), words(allocator), dumpall(allocator) {}
+  inline value_changes(const value_changes &rhs, const allocator_type &allocator = {}) :
+      times(rhs.times, allocator), offsets(rhs.offsets, allocator), events(rhs.events, allocator),
+      words(rhs.words, allocator), dumpall(rhs.dumpall, allocator) {}
+  inline value_changes(value_changes &&rhs) noexcept :
+      times(std::move(rhs.times)), offsets(std::move(rhs.offsets)), events(std::move(rhs.events)),
+      words(std::move(rhs.words)), dumpall(std::move(rhs.dumpall)) {}
+  inline value_changes(value_changes &&rhs, const allocator_type &allocator) :
+      times(std::move(rhs.times), allocator), offsets(std::move(rhs.offsets), allocator),
+      events(std::move(rhs.events), allocator), words(std::move(rhs.words), allocator),
+      dumpall(std::move(rhs.dumpall), allocator) {}
   inline constexpr value_changes &operator=(const value_changes &) = default;
   inline constexpr value_changes &operator=(value_changes &&rhs) noexcept {
-    timestamps = std::move(rhs.timestamps);
+    times   = std::move(rhs.times);
+    offsets = std::move(rhs.offsets);
+    events  = std::move(rhs.events);
+    words   = std::move(rhs.words);
+    dumpall = std::move(rhs.dumpall);
     return *this;
   }
   inline constexpr virtual ~value_changes() noexcept = default;
 
+public:
+  /// @brief start a new timestamp; the following append()s belong to it
+  inline void begin_timestamp(const time_t time) {
+    times.emplace_back(time);
+    offsets.emplace_back(events.size());
+  }
+
+  /// @brief note that a `$dumpall` block ends here, i.e. the events so far describe the value of every signal
+  inline void mark_dumpall() {
+    if (dumpall.empty() or dumpall.back() != events.size())
+      dumpall.emplace_back(events.size());
+  }
+
+  /// @brief move all timestamps of `later` behind ours, as if its changes had been appended here
+  /// @param later a log that was filled independently and continues where this one ends
+  /// @note pool offsets of out-of-line values are rebased onto this log's pool, which keeps its allocator.
+  inline void splice(value_changes &&later) {
+    // on another allocator the arrays could not be taken over anyway, they are copied below
+    if (times.empty() and get_allocator() == later.get_allocator()) {
+      *this = std::move(later);
+      return;
+    }
+    const auto event_base = events.size();
+    const auto word_base  = words.size();
+    times.insert(times.end(), later.times.begin(), later.times.end());
+    std::ranges::transform(later.offsets, std::back_inserter(offsets),
+                           [&](const size_type offset) { return offset + event_base; });
+    std::ranges::transform(later.events, std::back_inserter(events), [&](change_event event) {
+      if (not event.is_inline())
+        event.value += word_base;
+      return event;
+    });
+    words.insert(words.end(), later.words.begin(), later.words.end());
+    std::ranges::transform(later.dumpall, std::back_inserter(dumpall),
+                           [&](const size_type offset) { return offset + event_base; });
+    later = value_changes{later.get_allocator()};
+  }
+
+  /// @brief decode a change as written in the VCD file and append it to the current timestamp
+  /// @param signal the signal that changed
+  /// @param value the value token, see four_state_value::from_vcd
+  /// @param width the declared width of the signal
+  /// @return false if the value is malformed, in which case nothing is appended
+  /// @pre begin_timestamp() has been called
+  inline bool append(const signal_id_t signal, const std::string_view value, const size_type width) {
+    WAVER_PRECONDITION(not times.empty());
+    WAVER_PRECONDITION(not value.empty());
+
+    const auto parts = four_state_value::split_vcd(value, width);
+    if (not parts)
+      return false;
+    auto event = change_event{signal};
+    switch (parts->type) {
+    case change_event::kind_t::kReal:
+      event.descriptor = describe(change_event::kind_t::kReal, four_state::word_bits);
+      event.value      = std::bit_cast<word_t>(parts->real);
+      break;
+    case change_event::kind_t::kString:
+      event.descriptor = describe(change_event::kind_t::kString, parts->text.size());
+      event.value      = words.size();
+      words.resize(words.size() + four_state::words_for(parts->bits));
+      std::memcpy(words.data() + event.value, parts->text.data(), parts->text.size());
+      break;
+    default:
+      event.descriptor = describe(change_event::kind_t::kLogic, parts->bits);
+      if (parts->bits <= change_event::inline_bits) {
+        auto a = word_t{}, b = word_t{};
+        if (not four_state::decode_binary(parts->text, parts->bits, &a, &b))
+          return false;
+        event.value = a | (b << change_event::inline_bits);
+      } else {
+        const auto n = four_state::words_for(parts->bits);
+        event.value  = words.size();
+        words.resize(words.size() + 2 * n);
+        if (not four_state::decode_binary(parts->text, parts->bits, words.data() + event.value,
+                                          words.data() + event.value + n)) {
+          words.resize(event.value);
+          return false;
+        }
+      }
+    }
+    events.emplace_back(event);
+    return true;
+  }
+
+  /// @brief the number of timestamps
+  WAVER_NODISCARD inline size_type size() const noexcept { return times.size(); }
+  WAVER_NODISCARD inline bool      empty() const noexcept { return times.empty(); }
+
+  /// @brief the total number of changes over all timestamps
+  WAVER_NODISCARD inline size_type event_count() const noexcept { return events.size(); }
+
+  /// @brief the `index`-th timestamp
+  /// @pre index < size()
+  WAVER_NODISCARD inline timestamp operator[](const size_type index) const noexcept {
+    WAVER_PRECONDITION(index < size());
+
+    const auto last = index + 1 < offsets.size() ? offsets[index + 1] : events.size();
+    return {times[index], {events.data() + offsets[index], last - offsets[index]}};
+  }
+
+  /// @brief the value of a change
+  WAVER_NODISCARD inline four_state_value value(const change_event &event) const {
+    const auto width = event.width();
+    switch (event.kind()) {
+    case change_event::kind_t::kReal:
+      return four_state_value::from_real(std::bit_cast<double>(event.value));
+    case change_event::kind_t::kString:
+      return four_state_value::from_string({reinterpret_cast<const char *>(words.data() + event.value), width});
+    default:
+      if (event.is_inline()) {
+        const auto a = event.value & ((word_t{1} << change_event::inline_bits) - 1);
+        const auto b = event.value >> change_event::inline_bits;
+        return four_state_value::from_planes(width, &a, &b);
+      }
+      const auto n = four_state::words_for(width);
+      return four_state_value::from_planes(width, words.data() + event.value, words.data() + event.value + n);
+    }
+  }
+
+  /// @brief append the VCD representation of a change's value to `out`, without materializing it
+  /// @see four_state_value::format
+  inline void format(const change_event &event, std::string &out) const {
+    const auto width = event.width();
+    switch (event.kind()) {
+    case change_event::kind_t::kReal:
+      return four_state_value::format(event.kind(), width, &event.value, nullptr, out);
+    case change_event::kind_t::kString:
+      return four_state_value::format(event.kind(), width * 8, words.data() + event.value, nullptr, out);
+    default:
+      if (event.is_inline()) {
+        const auto a = event.value & ((word_t{1} << change_event::inline_bits) - 1);
+        const auto b = event.value >> change_event::inline_bits;
+        return four_state_value::format(event.kind(), width, &a, &b, out);
+      }
+      const auto n = four_state::words_for(width);
+      four_state_value::format(event.kind(), width, words.data() + event.value, words.data() + event.value + n, out);
+    }
+  }
+
+  /// @brief the number of words in the pool, i.e. the out-of-line value storage
+  WAVER_NODISCARD inline size_type pool_size() const noexcept { return words.size(); }
+
+  WAVER_NODISCARD inline allocator_type get_allocator() const noexcept { return events.get_allocator(); }
+
+  /// @brief all timestamps in time order
+  WAVER_NODISCARD inline auto timestamps() const noexcept {
+    return std::views::iota(size_type{0}, size()) |
+      std::views::transform([this](auto index) { return (*this)[index]; });
+  }
+
+  /// @brief the timestamps whose time lies within [first, last]
+  WAVER_NODISCARD inline auto timestamps(const time_t first, const time_t last) const noexcept {
+    const auto begin = std::ranges::lower_bound(times, first) - times.begin();
+    const auto end   = std::ranges::upper_bound(times, last) - times.begin();
+    return std::views::iota(static_cast<size_type>(begin), static_cast<size_type>(std::max(begin, end))) |
+      std::views::transform([this](auto index) { return (*this)[index]; });
+  }
+
+  /// @brief a copy of the timestamps whose time lies within [first, last], on the same allocator
+  WAVER_NODISCARD inline value_changes window(const time_t first, const time_t last) const {
+    auto result = value_changes{get_allocator()};
+    for (const auto timestamp : timestamps(first, last)) {
+      result.begin_timestamp(timestamp.time);
+      for (auto event : timestamp.changes) {
+        if (not event.is_inline()) {
+          const auto pooled = words.begin() + static_cast<std::ptrdiff_t>(event.value);
+          event.value       = result.words.size();
+          result.words.insert(result.words.end(), pooled, pooled + static_cast<std::ptrdiff_t>(pooled_words(event)));
+        }
+        result.events.emplace_back(event);
+      }
+    }
+    if (not result.times.empty()) {
+      const auto begin = offsets[static_cast<size_type>(std::ranges::lower_bound(times, first) - times.begin())];
+      for (const auto offset : dumpall)
+        if (offset > begin and offset - begin <= result.events.size())
+          result.dumpall.emplace_back(offset - begin);
+    }
+    return result;
+  }
+
 private:
-  friend void to_json(json_t &j, const value_changes &value_changes) {
+  friend void to_json(json_t &j, const value_changes &value_changes, const signal_table &signals) {
     WAVER_POSTCONDITION(j.is_object());
 
-    std::ranges::for_each(value_changes.timestamps, [&](auto &&timestamp) {
-      auto timestamp_json = json_t{};
-      to_json(timestamp_json, timestamp);
-      WAVER_PRECONDITION(timestamp_json.is_object());
-      WAVER_PRECONDITION(timestamp_json.front() == timestamp_json.back());
-      j[WAVER_TO_STRING(value_changes)].merge_patch(timestamp_json);
-    });
+    auto &timestamps_json = j[WAVER_TO_STRING(value_changes)];
+    for (const auto timestamp : value_changes.timestamps()) {
+      auto &changes_json = timestamps_json[std::to_string(timestamp.time)];
+      if (changes_json.is_null())
+        changes_json = json_t::object();
+      for (const auto &event : timestamp.changes)
+        changes_json[signals.code(event.signal)] = value_changes.value(event).to_string();
+    }
+  }
+
+  /// @brief the number of pool words an out-of-line event occupies
+  WAVER_NODISCARD inline static constexpr size_type pooled_words(const change_event &event) noexcept {
+    return event.kind() == change_event::kind_t::kString ? four_state::words_for(event.width() * 8)
+                                                         : 2 * four_state::words_for(event.width());
+  }
+
+  WAVER_NODISCARD WAVER_FORCEINLINE static constexpr std::uint32_t describe(const change_event::kind_t kind,
+                                                                            const size_type            width) noexcept {
+    return (static_cast<std::uint32_t>(kind) << change_event::kind_shift) |
+      (static_cast<std::uint32_t>(width) & change_event::width_mask);
   }
 
 private:
-  timestamps_t timestamps;
+  /// @brief the time of each timestamp
+  times_t times;
+  /// @brief the index of the first event of each timestamp
+  offsets_t offsets;
+  /// @brief all changes, in time order
+  events_t events;
+  /// @brief out-of-line values: both planes of wide logic values, and the bytes of strings
+  words_t words;
+  /// @brief the event offsets at which a `$dumpall` block ends, ascending
+  offsets_t dumpall;
 };
 
 /// @brief initial value of ports
 class dumpvars {
   friend value_change_dump;
+  friend class value_index;
+  friend class waveform_db;
 
 public:
-  using changes_t = std::vector<change_t>;
-  using json_t    = nlohmann::json;
-  using string_t  = std::string;
+  using changes_t      = std::pmr::vector<change_t>;
+  using json_t         = nlohmann::json;
+  using string_t       = std::string;
+  using allocator_type = allocator_t;
 
 private:
+  /// @note the vector comes from the allocator of the dumpvars, a value wider than 64 bits keeps its planes on the
+  ///       heap, see four_state_value
   changes_t changes;
 
 public:
-  inline explicit constexpr dumpvars()        = default;
-  inline constexpr dumpvars(const dumpvars &) = default;
-  inline constexpr dumpvars(dumpvars &&rhs) noexcept { changes = std::move(rhs.changes); }
+  inline explicit dumpvars(const allocator_type &allocator = {}) : changes(allocator) {}
+  inline dumpvars(const dumpvars &rhs, const allocator_type &allocator = {}) : changes(rhs.changes, allocator) {}
+  inline dumpvars(dumpvars &&rhs) noexcept : changes(std::move(rhs.changes)) {}
+  inline dumpvars(dumpvars &&rhs, const allocator_type &allocator) : changes(std::move(rhs.changes), allocator) {}
   inline constexpr dumpvars &operator=(const dumpvars &) = default;
   inline constexpr dumpvars &operator=(dumpvars &&rhs) noexcept {
     changes = std::move(rhs.changes);
@@ -471,11 +882,17 @@ public:
   }
   inline constexpr virtual ~dumpvars() noexcept = default;
 
+public:
+  WAVER_NODISCARD inline allocator_type get_allocator() const noexcept { return changes.get_allocator(); }
+
 private:
-  friend void to_json(json_t &j, const dumpvars &dumpvars) {
+  friend void to_json(json_t &j, const dumpvars &dumpvars, const signal_table &signals) {
     WAVER_POSTCONDITION(j.is_object());
 
-    j[WAVER_TO_STRING(dumpvars)].emplace_back(dumpvars.changes);
+    auto changes_json = json_t::array();
+    for (const auto &[signal, value] : dumpvars.changes)
+      changes_json.emplace_back(json_t::array({signals.code(signal), value}));
+    j[WAVER_TO_STRING(dumpvars)].emplace_back(std::move(changes_json));
   }
 };
 } // namespace net::ancillarycat::waver
@@ -0,0 +1,291 @@
+/**************************************************************************************
+ * @file name_index.hpp
+ * @brief lookup of signals by hierarchical name: exact, by prefix, or by glob pattern.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "config.hpp"
+#include "meta_elements.hpp"
+#include "signal_filter.hpp"
+
+namespace net::ancillarycat::waver {
+/// @brief maps the dotted paths of all declarations in a scope_table, e.g. `TOP.ALU4.out`, to their signals
+/// @note exact lookups go through an open-addressing hash table of the full paths, so they take time linear in the
+///       length of the path, however many declarations there are. Prefix and glob searches descend a trie of the path
+///       components, whose children are sorted by name; the declarations below a trie node are one contiguous, sorted
+///       range, so a prefix search returns them without visiting them.
+/// @note a code declared in several scopes is one signal of the signal_table, whose changes are stored once; every
+///       one of its paths resolves to that signal, see aliases(). A path declared twice keeps its first declaration.
+/// @note the index copies the paths it needs, and does not refer to the scope_table once built.
+class name_index {
+public:
+  using size_type      = std::size_t;
+  using index_t        = std::uint32_t;
+  using string_t       = std::pmr::string;
+  using string_view_t  = std::string_view;
+  using allocator_type = allocator_t;
+
+  /// @brief no declaration, no node
+  static inline constexpr auto npos = std::numeric_limits<index_t>::max();
+
+  /// @brief a declared path and its signal
+  struct declaration {
+    /// @brief the path, in the path pool
+    size_type   offset = 0;
+    index_t     size   = 0;
+    signal_id_t signal = invalid_signal_id;
+  };
+
+public:
+  /// @param scopes the hierarchy to index
+  inline explicit name_index(const scope_table &scopes, const allocator_type &allocator = {});
+
+public:
+  /// @brief the signal declared as `path`
+  /// @return the signal, or invalid_signal_id if no declaration has that path
+  WAVER_NODISCARD inline signal_id_t find(const string_view_t path) const noexcept {
+    if (slots.empty())
+      return invalid_signal_id;
+    const auto mask = slots.size() - 1;
+    for (auto slot = std::hash<string_view_t>{}(path) & mask;; slot = (slot + 1) & mask) {
+      if (slots[slot] == npos)
+        return invalid_signal_id;
+      if (const auto &candidate = declarations[slots[slot]]; this->path(candidate) == path)
+        return candidate.signal;
+    }
+  }
+
+  /// @brief the declarations whose path starts with `prefix`, sorted by path component by component
+  /// @note `TOP.AL` finds everything in `TOP.ALU4` as well as `TOP.ALU4` itself, and `TOP.` everything in `TOP`.
+  WAVER_NODISCARD inline std::span<const declaration> prefix(string_view_t prefix) const noexcept {
+    auto node = index_t{0};
+    for (auto separator = prefix.find(signal_filter::separator); separator != string_view_t::npos;
+         separator      = prefix.find(signal_filter::separator)) {
+      if (node = child(node, prefix.substr(0, separator)); node == npos)
+        return {};
+      prefix = prefix.substr(separator + 1);
+    }
+    if (prefix.empty()) {
+      // everything below `node`, but not `node` itself, which sorts first
+      const auto first = nodes[node].first + (nodes[node].signal != invalid_signal_id and node != 0);
+      return std::span{declarations}.subspan(first, nodes[node].last - first);
+    }
+    // the children whose name starts with the last, partial component are adjacent
+    const auto children = this->children(node);
+    const auto lower    = std::ranges::lower_bound(children, prefix, {}, [&](const index_t c) { return name(c); });
+    const auto upper    = std::ranges::find_if_not(lower, children.end(), [&](const index_t c) {
+      return name(c).starts_with(prefix);
+    });
+    if (lower == upper)
+      return {};
+    return std::span{declarations}.subspan(nodes[*lower].first, nodes[*std::prev(upper)].last - nodes[*lower].first);
+  }
+
+  /// @brief the distinct signals with a path matching `pattern`, see signal_filter::glob(), in ascending order
+  /// @note only the declarations below the part of the pattern before its first wildcard are matched.
+  WAVER_NODISCARD inline std::vector<signal_id_t> glob(const string_view_t pattern) const {
+    auto signals = std::vector<signal_id_t>{};
+    for (const auto &declaration : prefix(pattern.substr(0, pattern.find_first_of("*?"))))
+      if (signal_filter::glob(pattern, path(declaration)))
+        signals.emplace_back(declaration.signal);
+    std::ranges::sort(signals);
+    signals.erase(std::ranges::unique(signals).begin(), signals.end());
+    return signals;
+  }
+
+  /// @brief every path `signal` is declared as, sorted
+  WAVER_NODISCARD inline std::vector<string_view_t> aliases(const signal_id_t signal) const {
+    auto paths = std::vector<string_view_t>{};
+    if (signal + size_type{1} >= alias_offsets.size())
+      return paths;
+    for (auto position = alias_offsets[signal]; position < alias_offsets[signal + 1]; ++position)
+      paths.emplace_back(path(declarations[alias_list[position]]));
+    return paths;
+  }
+
+  WAVER_NODISCARD inline string_view_t path(const declaration &declaration) const noexcept {
+    return string_view_t{pool}.substr(declaration.offset, declaration.size);
+  }
+
+  /// @brief every declaration, sorted by path component by component
+  WAVER_NODISCARD inline std::span<const declaration> all() const noexcept { return declarations; }
+  /// @brief the number of distinct paths
+  WAVER_NODISCARD inline size_type size() const noexcept { return declarations.size(); }
+  WAVER_NODISCARD inline bool      empty() const noexcept { return declarations.empty(); }
+
+  WAVER_NODISCARD inline allocator_type get_allocator() const noexcept { return pool.get_allocator(); }
+
+private:
+  /// @brief a path component; the root is node 0, with an empty name
+  struct node {
+    /// @brief the name, in the path pool
+    size_type name_offset = 0;
+    index_t   name_size   = 0;
+    /// @brief the children are `edges[first_edge, first_edge + children)`, sorted by name
+    index_t first_edge = 0;
+    index_t children   = 0;
+    /// @brief the declarations at or below the node are `[first, last)`
+    index_t first = 0;
+    index_t last  = 0;
+    /// @brief the signal declared as the path of the node, if any
+    signal_id_t signal = invalid_signal_id;
+  };
+
+  WAVER_NODISCARD inline string_view_t name(const index_t node) const noexcept {
+    return string_view_t{pool}.substr(nodes[node].name_offset, nodes[node].name_size);
+  }
+  WAVER_NODISCARD inline std::span<const index_t> children(const index_t node) const noexcept {
+    return std::span{edges}.subspan(nodes[node].first_edge, nodes[node].children);
+  }
+  /// @brief the child of `node` named `name`, npos if there is none
+  WAVER_NODISCARD inline index_t child(const index_t node, const string_view_t name) const noexcept {
+    const auto children = this->children(node);
+    const auto found    = std::ranges::lower_bound(children, name, {}, [&](const index_t c) { return this->name(c); });
+    return found != children.end() and this->name(*found) == name ? *found : npos;
+  }
+
+  /// @brief whether `lhs` comes before `rhs` when compared component by component, i.e. with the separator sorting
+  ///        before any other character
+  WAVER_NODISCARD inline static bool before(const string_view_t lhs, const string_view_t rhs) noexcept {
+    const auto rank = [](const char c) { return c == signal_filter::separator ? -1 : static_cast<unsigned char>(c); };
+    return std::ranges::lexicographical_compare(lhs, rhs, {}, rank, rank);
+  }
+
+private:
+  /// @brief the paths of all declarations, back to back
+  string_t pool;
+  std::pmr::vector<declaration> declarations;
+  /// @brief the hash table: declaration indices, npos for an empty slot; its size is a power of two
+  std::pmr::vector<index_t> slots;
+  /// @brief the trie in pre-order
+  std::pmr::vector<node>    nodes;
+  std::pmr::vector<index_t> edges;
+  /// @brief signal -> its declarations are `alias_list[alias_offsets[signal], alias_offsets[signal + 1])`
+  std::pmr::vector<index_t> alias_offsets;
+  std::pmr::vector<index_t> alias_list;
+};
+
+inline name_index::name_index(const scope_table &scopes, const allocator_type &allocator) :
+    pool(allocator), declarations(allocator), slots(allocator), nodes(allocator), edges(allocator),
+    alias_offsets(allocator), alias_list(allocator) {
+  // the path of every scope, each once, so that the path of a port is one append
+  auto scope_paths = std::vector<declaration>(scopes.size());
+  auto prefixes    = std::string{};
+  for (index_t scope = 0; scope < scopes.size(); ++scope) {
+    auto &path  = scope_paths[scope];
+    path.offset = prefixes.size();
+    if (const auto parent = scopes.parent(scope); parent != scope_table::npos)
+      prefixes.append(prefixes, scope_paths[parent].offset, scope_paths[parent].size);
+    prefixes.append(scopes.name(scope)).push_back(signal_filter::separator);
+    path.size = static_cast<index_t>(prefixes.size() - path.offset);
+  }
+  const auto ports = scopes.ports();
+  declarations.reserve(ports.size());
+  for (size_type position = 0; position < ports.size(); ++position) {
+    const auto &scope  = scope_paths[scopes.owner(position)];
+    const auto  offset = pool.size();
+    pool.append(prefixes, scope.offset, scope.size).append(ports[position].get_name());
+    declarations.push_back({offset, static_cast<index_t>(pool.size() - offset), ports[position].get_signal()});
+  }
+
+  // sorted, without repeated paths
+  std::ranges::stable_sort(declarations, [&](const declaration &lhs, const declaration &rhs) {
+    return before(path(lhs), path(rhs));
+  });
+  declarations.erase(std::ranges::unique(declarations, {}, [&](const declaration &d) { return path(d); }).begin(),
+                     declarations.end());
+  // and the pool in the same order, so that the paths below a trie node are adjacent in memory too
+  auto sorted = string_t{allocator};
+  sorted.reserve(pool.size());
+  for (auto &declaration : declarations) {
+    const auto offset = sorted.size();
+    sorted.append(path(declaration));
+    declaration.offset = offset;
+  }
+  pool = std::move(sorted);
+
+  // the trie, in one pass over the sorted paths: a path shares its first components with the one before it, then
+  // opens a node for each of its remaining components
+  nodes.push_back({});
+  // the root, then the nodes of the components of the previous path
+  auto open       = std::vector<index_t>{0};
+  auto parents    = std::vector<index_t>{npos};
+  auto components = std::vector<string_view_t>{};
+  for (index_t index = 0; index < declarations.size(); ++index) {
+    const auto path = this->path(declarations[index]);
+    components.clear();
+    for (auto rest = path;;) {
+      const auto separator = rest.find(signal_filter::separator);
+      components.emplace_back(rest.substr(0, separator));
+      if (separator == string_view_t::npos)
+        break;
+      rest = rest.substr(separator + 1);
+    }
+    auto depth = size_type{1};
+    while (depth < open.size() and depth <= components.size() and name(open[depth]) == components[depth - 1])
+      ++depth;
+    for (; open.size() > depth; open.pop_back())
+      nodes[open.back()].last = index;
+    for (; depth <= components.size(); ++depth) {
+      const auto component = components[depth - 1];
+      const auto offset    = static_cast<size_type>(component.data() - path.data());
+      nodes.push_back({.name_offset = declarations[index].offset + offset,
+                       .name_size   = static_cast<index_t>(component.size()),
+                       .first       = index});
+      parents.emplace_back(open.back());
+      open.emplace_back(static_cast<index_t>(nodes.size() - 1));
+    }
+    nodes[open.back()].signal = declarations[index].signal;
+  }
+  for (; not open.empty(); open.pop_back())
+    nodes[open.back()].last = static_cast<index_t>(declarations.size());
+
+  // the children of every node, grouped by parent; pre-order keeps them sorted
+  edges.resize(nodes.size() - 1);
+  for (index_t node = 1; node < nodes.size(); ++node)
+    ++nodes[parents[node]].children;
+  for (index_t node = 0, first = 0; node < nodes.size(); first += nodes[node++].children)
+    nodes[node].first_edge = first;
+  auto filled = std::vector<index_t>(nodes.size(), 0);
+  for (index_t node = 1; node < nodes.size(); ++node)
+    edges[nodes[parents[node]].first_edge + filled[parents[node]]++] = node;
+
+  // the hash table, at most half full
+  if (not declarations.empty()) {
+    slots.assign(std::bit_ceil(declarations.size() * 2), npos);
+    const auto mask = slots.size() - 1;
+    for (index_t index = 0; index < declarations.size(); ++index) {
+      auto slot = std::hash<string_view_t>{}(path(declarations[index])) & mask;
+      while (slots[slot] != npos)
+        slot = (slot + 1) & mask;
+      slots[slot] = index;
+    }
+  }
+
+  // the declarations of every signal
+  auto signals = size_type{0};
+  for (const auto &declaration : declarations)
+    signals = std::max(signals, size_type{declaration.signal} + 1);
+  alias_offsets.assign(signals + 1, 0);
+  for (const auto &declaration : declarations)
+    ++alias_offsets[declaration.signal + 1];
+  for (size_type signal = 0; signal < signals; ++signal)
+    alias_offsets[signal + 1] += alias_offsets[signal];
+  alias_list.resize(declarations.size());
+  auto next = std::vector<index_t>(alias_offsets.begin(), alias_offsets.end() - 1);
+  for (index_t index = 0; index < declarations.size(); ++index)
+    alias_list[next[declarations[index].signal]++] = index;
+}
+} // namespace net::ancillarycat::waver
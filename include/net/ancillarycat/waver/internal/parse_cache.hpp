@@ -0,0 +1,184 @@
+/**************************************************************************************
+ * @file parse_cache.hpp
+ * @brief a persistent cache of parsed dumps, keyed by the identity of the source file.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "config.hpp"
+#include "mapped_file.hpp"
+#include "parse_stats.hpp"
+#include "vcd.hpp"
+#include "waveform_db.hpp"
+
+namespace net::ancillarycat::waver {
+/// @brief a directory of waveform databases, one per parsed dump, that value_change_dump::parse() consults
+///        instead of parsing a file again, see parse_options::cache
+/// @note an entry is keyed on the canonical path, size and modification time of the dump and a hash of its
+///       header, i.e. everything up to `$enddefinitions`; editing a dump in place within the resolution of the
+///       modification time and without touching its header is not detected.
+/// @note entries are written to a temporary file and renamed into place, so concurrent processes sharing a
+///       directory at worst parse the same dump twice. A hit refreshes the modification time of the entry, and
+///       store() evicts the entries used least recently until the directory fits `capacity` bytes.
+class parse_cache {
+public:
+  using size_type     = std::size_t;
+  using path_t        = std::filesystem::path;
+  using string_t      = std::string;
+  using string_view_t = std::string_view;
+  using key_t         = std::string;
+
+  /// @brief default size bound of the directory
+  static inline constexpr size_type default_capacity = size_type{4} << 30;
+  /// @brief the longest prefix of a dump that is hashed if it has no `$enddefinitions`
+  static inline constexpr size_type max_header_bytes = size_type{1} << 20;
+  /// @brief the extension of an entry
+  static inline constexpr auto extension = ".wdb"sv;
+
+public:
+  /// @param directory where the entries live; created on the first store()
+  /// @param capacity the size bound of the directory, in bytes
+  inline explicit parse_cache(path_t directory, const size_type capacity = default_capacity) :
+      root(std::move(directory)), limit(capacity) {}
+
+public:
+  /// @brief the key of the dump at `dump` as it is now
+  WAVER_NODISCARD inline static absl::StatusOr<key_t> key(const path_t &dump);
+
+  /// @brief the cached model of `dump`
+  /// @param allocator where the model is allocated
+  /// @return the model, or NotFoundError if there is no entry for the dump as it is now
+  WAVER_NODISCARD inline absl::StatusOr<value_change_dump> load(const path_t      &dump,
+                                                                const allocator_t &allocator = {}) const;
+
+  /// @brief cache the model `vcd` parsed from `dump`, then evict down to the capacity
+  inline Status store(const path_t &dump, const value_change_dump &vcd) const;
+
+  /// @brief remove the entries used least recently until the directory holds at most `capacity` bytes
+  inline void evict(size_type capacity) const;
+
+  WAVER_NODISCARD inline const path_t &directory() const noexcept { return root; }
+  WAVER_NODISCARD inline size_type     capacity() const noexcept { return limit; }
+  /// @brief where the entry of `key` lives
+  WAVER_NODISCARD inline path_t entry(const key_t &key) const { return root / (key + string_t{extension}); }
+
+private:
+  /// @brief 64-bit FNV-1a
+  WAVER_NODISCARD inline static constexpr std::uint64_t hash(const string_view_t bytes,
+                                                             std::uint64_t       seed = 0xcbf29ce484222325) noexcept {
+    for (const auto c : bytes)
+      seed = (seed ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+    return seed;
+  }
+
+private:
+  path_t    root;
+  size_type limit;
+};
+
+inline absl::StatusOr<parse_cache::key_t> parse_cache::key(const path_t &dump) {
+  auto       ec        = std::error_code{};
+  const auto canonical = std::filesystem::canonical(dump, ec);
+  const auto size      = std::filesystem::file_size(dump, ec);
+  const auto mtime     = std::filesystem::last_write_time(dump, ec);
+  if (ec)
+    return NotFoundError("Unable to stat " + dump.string() + ": " + ec.message());
+  const auto file = mapped_file{dump};
+  if (file.empty())
+    return NotFoundError("Unable to map " + dump.string());
+
+  auto header = file.view().substr(0, max_header_bytes);
+  if (const auto end = header.find(keywords::$enddefinitions); end != string_view_t::npos)
+    header = header.substr(0, end);
+  const auto stamp = std::to_string(size) + ':' + std::to_string(mtime.time_since_epoch().count()) + ':' +
+    std::to_string(waveform_db::version);
+  // the path and the header are hashed separately, so that a dump does not collide with its copies
+  auto key = std::to_string(hash(header, hash(stamp, hash(canonical.string()))));
+  key += '-';
+  key += std::to_string(hash(header));
+  return key;
+}
+
+inline absl::StatusOr<value_change_dump> parse_cache::load(const path_t &dump, const allocator_t &allocator) const {
+  const auto key = parse_cache::key(dump);
+  if (not key.ok())
+    return key.status();
+  const auto path = entry(*key);
+  auto       ec   = std::error_code{};
+  if (not std::filesystem::exists(path, ec))
+    return NotFoundError("No cache entry for " + dump.string());
+  auto vcd = waveform_db::open(path);
+  if (not vcd.ok()) {
+    // a corrupted or outdated entry is dropped and parsed again
+    std::filesystem::remove(path, ec);
+    return NotFoundError("Dropped the cache entry of " + dump.string() + ": " + string_t{vcd.status().message()});
+  }
+  std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+  return vcd->to_dump(allocator);
+}
+
+inline Status parse_cache::store(const path_t &dump, const value_change_dump &vcd) const {
+  const auto key = parse_cache::key(dump);
+  if (not key.ok())
+    return key.status();
+  auto ec = std::error_code{};
+  std::filesystem::create_directories(root, ec);
+  if (ec)
+    return absl::PermissionDeniedError("Unable to create " + root.string() + ": " + ec.message());
+  if (auto res = waveform_db::write(vcd, entry(*key)); not res.ok())
+    return res;
+  evict(limit);
+  return OkStatus();
+}
+
+inline void parse_cache::evict(const size_type capacity) const {
+  struct entry_t {
+    path_t                          path;
+    std::filesystem::file_time_type used;
+    size_type                       size;
+  };
+  auto entries = std::vector<entry_t>{};
+  auto total   = size_type{0};
+  auto ec      = std::error_code{};
+  for (const auto &file : std::filesystem::directory_iterator{root, ec}) {
+    if (file.path().extension() != extension or not file.is_regular_file(ec))
+      continue;
+    auto &entry = entries.emplace_back(file.path(), file.last_write_time(ec), file.file_size(ec));
+    total += entry.size;
+  }
+  std::ranges::sort(entries, {}, &entry_t::used);
+  for (const auto &entry : entries) {
+    if (total <= capacity)
+      break;
+    if (std::filesystem::remove(entry.path, ec))
+      total -= entry.size;
+  }
+}
+
+inline value_change_dump::expected_t value_change_dump::parse_cached(const path_t &path, parse_options options) {
+  const auto &cache = *std::exchange(options.cache, nullptr);
+  {
+    WAVER_STATS(auto timer = parse_stats::timer{options.stats, parse_stats::kLoad};)
+    if (auto vcd = cache.load(path, options.allocator()); vcd.ok()) {
+      WAVER_STATS(if (options.stats) (*options.stats)[parse_stats::kLoad].changes += vcd->value_changes.event_count();)
+      return vcd;
+    }
+  }
+  auto vcd = parse(path, options);
+  // failing to populate the cache does not fail the parse
+  if (vcd.ok())
+    (void)cache.store(path, *vcd);
+  return vcd;
+}
+} // namespace net::ancillarycat::waver
@@ -0,0 +1,151 @@
+/**************************************************************************************
+ * @file parse_stats.hpp
+ * @brief per-phase timing and throughput counters of a parse.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <string_view>
+#include "config.hpp"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace net::ancillarycat::waver {
+/// @brief wall time, bytes, tokens, changes and peak memory of every phase of a parse
+/// @note the parser only fills it in if `WAVER_ENABLE_STATS` is defined, see WAVER_STATS; otherwise it stays zeroed
+///       and the instrumentation is compiled out entirely.
+/// @note counters are recorded where the work happens: with several workers, or in streaming mode, most tokens
+///       are produced while parsing the body rather than in the lex phase.
+class parse_stats {
+public:
+  using size_type     = std::size_t;
+  using clock_t       = std::chrono::steady_clock;
+  using duration_t    = std::chrono::nanoseconds;
+  using string_view_t = std::string_view;
+  using json_t        = nlohmann::json;
+
+  enum phase : std::uint8_t {
+    /// @brief opening, mapping or reading the input
+    kLoad = 0,
+    /// @brief tokenizing, up front
+    kLex = 1,
+    /// @brief declarations up to `$enddefinitions`
+    kHeader = 2,
+    /// @brief `$dumpvars` and value changes, including any tokenizing done on the way
+    kBody = 3,
+    /// @brief writing the result, recorded by the caller
+    kSerialize = 4,
+  };
+  struct counters {
+    duration_t wall{};
+    size_type  bytes   = 0;
+    size_type  tokens  = 0;
+    size_type  changes = 0;
+    /// @brief the peak resident set size of the process at the end of the phase
+    size_type peak_bytes = 0;
+  };
+  class timer;
+
+  /// @brief whether this build records anything
+#ifdef WAVER_ENABLE_STATS
+  static inline constexpr bool enabled = true;
+#else
+  static inline constexpr bool enabled = false;
+#endif
+
+public:
+  WAVER_NODISCARD inline counters       &operator[](phase which) noexcept;
+  WAVER_NODISCARD inline const counters &operator[](phase which) const noexcept;
+
+  /// @brief the printable name of a phase
+  WAVER_NODISCARD inline static constexpr string_view_t name(phase which) noexcept;
+
+  /// @brief the peak resident set size of the process so far, 0 where it cannot be queried
+  WAVER_NODISCARD inline static size_type peak_resident_bytes() noexcept {
+#ifdef _WIN32
+    auto info = PROCESS_MEMORY_COUNTERS{};
+    return GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof info) ? info.PeakWorkingSetSize : 0;
+#else
+    auto usage = rusage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+      return 0;
+#ifdef __APPLE__
+    return static_cast<size_type>(usage.ru_maxrss); // bytes
+#else
+    return static_cast<size_type>(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+#endif
+  }
+
+private:
+  friend inline void to_json(json_t &j, const parse_stats &stats);
+
+private:
+  std::array<counters, kSerialize + 1> phases{};
+};
+
+/// @brief adds the wall time from its construction to its destruction (or stop()) to a phase; a no-op if the
+///        stats are null
+class parse_stats::timer {
+public:
+  inline explicit timer(parse_stats *stats, const phase which) noexcept :
+      stats(stats), which(which), start(stats ? clock_t::now() : clock_t::time_point{}) {}
+  inline timer(const timer &)            = delete;
+  inline timer &operator=(const timer &) = delete;
+  inline ~timer() noexcept { stop(); }
+
+public:
+  inline void stop() noexcept {
+    if (not stats)
+      return;
+    auto &counters = (*stats)[which];
+    counters.wall += clock_t::now() - start;
+    counters.peak_bytes = peak_resident_bytes();
+    stats               = nullptr;
+  }
+
+private:
+  parse_stats        *stats;
+  phase               which;
+  clock_t::time_point start;
+};
+
+inline parse_stats::counters &parse_stats::operator[](const phase which) noexcept { return phases[which]; }
+inline const parse_stats::counters &parse_stats::operator[](const phase which) const noexcept {
+  return phases[which];
+}
+
+inline constexpr parse_stats::string_view_t parse_stats::name(const phase which) noexcept {
+  constexpr auto names = std::array{"load"sv, "lex"sv, "header"sv, "body"sv, "serialize"sv};
+  return names[which];
+}
+
+/// @brief `{"<phase>": {"wall_ns", "bytes", "tokens", "changes", "peak_bytes"}, ...}`
+inline void to_json(parse_stats::json_t &j, const parse_stats &stats) {
+  for (auto which = std::uint8_t{0}; which < stats.phases.size(); ++which) {
+    const auto &counters = stats.phases[which];
+    j[parse_stats::name(static_cast<parse_stats::phase>(which))] = {
+      {"wall_ns", counters.wall.count()},
+      {"bytes", counters.bytes},
+      {"tokens", counters.tokens},
+      {"changes", counters.changes},
+      {"peak_bytes", counters.peak_bytes},
+    };
+  }
+}
+} // namespace net::ancillarycat::waver
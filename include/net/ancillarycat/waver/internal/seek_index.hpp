@@ -0,0 +1,245 @@
+/**************************************************************************************
+ * @file seek_index.hpp
+ * @brief a sidecar index of timestamp byte offsets, for parsing a time window of a raw VCD file.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "config.hpp"
+#include "contract.hpp"
+#include "meta_elements.hpp"
+
+namespace net::ancillarycat::waver {
+/// @brief the closed time interval [first, last]
+struct time_range {
+  timestamp::time_t first = 0;
+  timestamp::time_t last  = std::numeric_limits<timestamp::time_t>::max();
+};
+
+/// @brief the byte offset of every N-th `#time` line of a VCD file, with the offset from which a parse has to
+///        start to reconstruct the full state at that point
+/// @note the full-state pointer is the timestamp enclosing the latest `$dumpall` (or `$dumpvars`) at or before the
+///       entry, or the start of the value change section if there is none; seeking is therefore cheapest in dumps
+///       written with periodic `$dumpall`s.
+/// @note only `#` at the beginning of a line followed by a digit is taken as a timestamp, as in the parallel parser.
+/// @note the sidecar is stored in native byte order next to the dump, see sidecar_path(); it records the size and
+///       modification time of the dump and is rebuilt when either changes.
+class seek_index {
+public:
+  using size_type     = std::size_t;
+  using time_t        = timestamp::time_t;
+  using path_t        = std::filesystem::path;
+  using string_view_t = std::string_view;
+
+  struct entry {
+    /// @brief the time of the timestamp
+    time_t time = 0;
+    /// @brief the byte offset of its `#`
+    std::uint64_t offset = 0;
+    /// @brief the byte offset to parse from to know the full state at `time`
+    std::uint64_t full_state = 0;
+  };
+
+  /// @brief default number of timestamps between two entries
+  static inline constexpr size_type default_interval = 1024;
+  /// @brief the first bytes of a sidecar
+  static inline constexpr auto magic = "WAVERIDX"sv;
+  /// @brief bumped whenever the layout of the sidecar changes
+  static inline constexpr std::uint32_t version = 2;
+
+public:
+  inline explicit seek_index() = default;
+
+public:
+  /// @brief scan the value change section of `source` for timestamps
+  /// @param source the whole dump
+  /// @param body_offset the offset just past `$enddefinitions $end`
+  /// @param interval the number of timestamps between two entries
+  WAVER_NODISCARD inline static seek_index scan(string_view_t source, size_type body_offset,
+                                                size_type interval = default_interval);
+
+  /// @brief load the sidecar at `sidecar`, which has to describe `dump` as it is now
+  /// @param interval the interval the sidecar has to have been built with
+  WAVER_NODISCARD inline static absl::StatusOr<seek_index> load(const path_t &sidecar, const path_t &dump,
+                                                                size_type interval = default_interval);
+
+  /// @brief write the sidecar, describing `dump`, atomically
+  inline Status save(const path_t &sidecar, const path_t &dump) const;
+
+  /// @brief where the sidecar of `dump` lives
+  WAVER_NODISCARD inline static path_t sidecar_path(const path_t &dump) { return path_t{dump} += ".waveridx"; }
+
+  /// @brief the byte range [begin, end) of the value change section that has to be parsed for `range`
+  /// @note the range starts at a full-state pointer, so it usually includes changes before `range.first`
+  WAVER_NODISCARD inline std::pair<size_type, size_type> locate(const time_range &range) const noexcept;
+
+  WAVER_NODISCARD inline size_type                 body_offset() const noexcept { return body; }
+  WAVER_NODISCARD inline size_type                 interval() const noexcept { return step; }
+  WAVER_NODISCARD inline const std::vector<entry> &entries() const noexcept { return index; }
+
+private:
+  /// @brief the size and modification time of `dump`
+  WAVER_NODISCARD inline static std::pair<std::uint64_t, std::int64_t> stamp(const path_t &dump) noexcept {
+    auto       ec    = std::error_code{};
+    const auto size  = std::filesystem::file_size(dump, ec);
+    const auto mtime = std::filesystem::last_write_time(dump, ec);
+    if (ec)
+      return {0, 0};
+    return {size, static_cast<std::int64_t>(mtime.time_since_epoch().count())};
+  }
+
+private:
+  /// @brief the offset just past `$enddefinitions $end`
+  std::uint64_t body = 0;
+  /// @brief the size of the dump
+  std::uint64_t size = 0;
+  /// @brief the number of timestamps between two entries
+  std::uint64_t step = default_interval;
+  /// @brief entries in time order
+  std::vector<entry> index;
+};
+
+inline seek_index seek_index::scan(const string_view_t source, const size_type body_offset,
+                                   const size_type interval) {
+  WAVER_PRECONDITION(body_offset <= source.size());
+
+  auto result      = seek_index{};
+  result.body      = body_offset;
+  result.size      = source.size();
+  result.step      = std::max(interval, size_type{1});
+  auto full_state  = static_cast<std::uint64_t>(body_offset);
+  auto latest      = static_cast<std::uint64_t>(body_offset); // the `#` line last seen
+  auto seen        = false;
+  auto count       = size_type{0};
+  const auto *data = source.data();
+  // every line start after the header; only the first bytes of a line are looked at
+  for (auto line = body_offset; line < source.size();) {
+    const auto c = data[line];
+    if (c == '#' and line + 1 < source.size() and data[line + 1] >= '0' and data[line + 1] <= '9') {
+      auto time = time_t{};
+      std::from_chars(data + line + 1, data + source.size(), time);
+      latest = line;
+      seen   = true;
+      if (count++ % result.step == 0)
+        result.index.push_back({time, line, full_state});
+    } else if (c == '$') {
+      const auto rest = source.substr(line);
+      if (rest.starts_with(keywords::$dumpall) or rest.starts_with(keywords::$dumpvars))
+        full_state = seen ? latest : body_offset;
+    }
+    const auto *const newline = static_cast<const char *>(std::memchr(data + line, '\n', source.size() - line));
+    if (not newline)
+      break;
+    line = static_cast<size_type>(newline - data) + 1;
+  }
+  return result;
+}
+
+inline absl::StatusOr<seek_index> seek_index::load(const path_t &sidecar, const path_t &dump,
+                                                   const size_type interval) {
+  auto file = std::ifstream{sidecar, std::ios::binary};
+  if (not file)
+    return NotFoundError("No seek index at " + sidecar.string());
+
+  auto header = std::string(magic.size(), '\0');
+  auto tag    = std::uint32_t{};
+  auto result = seek_index{};
+  auto count  = std::uint64_t{};
+  auto mtime  = std::int64_t{};
+  file.read(header.data(), static_cast<std::streamsize>(header.size()));
+  file.read(reinterpret_cast<char *>(&tag), sizeof tag);
+  file.read(reinterpret_cast<char *>(&result.size), sizeof result.size);
+  file.read(reinterpret_cast<char *>(&mtime), sizeof mtime);
+  file.read(reinterpret_cast<char *>(&result.body), sizeof result.body);
+  file.read(reinterpret_cast<char *>(&result.step), sizeof result.step);
+  file.read(reinterpret_cast<char *>(&count), sizeof count);
+  if (not file or header != magic or tag != version)
+    return InvalidArgumentError("Not a seek index: " + sidecar.string());
+  if (std::pair{result.size, mtime} != stamp(dump))
+    return absl::FailedPreconditionError("Stale seek index: " + sidecar.string());
+  if (result.step != std::max(interval, size_type{1}))
+    return absl::FailedPreconditionError("Seek index built with another interval: " + sidecar.string());
+
+  // the entries are the rest of the file, checked before anything is allocated for them
+  auto       ec   = std::error_code{};
+  const auto read = static_cast<std::uint64_t>(file.tellg());
+  const auto rest = std::filesystem::file_size(sidecar, ec) - read;
+  if (ec or rest % sizeof(entry) != 0 or count != rest / sizeof(entry))
+    return InvalidArgumentError("Truncated seek index: " + sidecar.string());
+  result.index.resize(count);
+  file.read(reinterpret_cast<char *>(result.index.data()), static_cast<std::streamsize>(count * sizeof(entry)));
+  if (not file)
+    return InvalidArgumentError("Truncated seek index: " + sidecar.string());
+
+  // every offset lies in the value change section, and the entries are in file and time order
+  auto valid = result.body <= result.size;
+  for (size_type i = 0; i < result.index.size(); ++i) {
+    const auto &current = result.index[i];
+    valid = valid and current.offset >= result.body and current.offset <= result.size and
+            current.full_state >= result.body and current.full_state <= current.offset and
+            (i == 0 or (current.offset > result.index[i - 1].offset and current.time >= result.index[i - 1].time));
+  }
+  if (not valid)
+    return InvalidArgumentError("Corrupt seek index: " + sidecar.string());
+  return result;
+}
+
+inline Status seek_index::save(const path_t &sidecar, const path_t &dump) const {
+  // write next to the destination, then rename over it, so a reader never sees half a sidecar; unique so that
+  // writers of the same sidecar do not interleave
+  auto temporary = path_t{sidecar} += "." + std::to_string(std::random_device{}()) + ".tmp";
+  auto ec        = std::error_code{};
+  {
+    auto file = std::ofstream{temporary, std::ios::binary | std::ios::trunc};
+    if (not file)
+      return absl::PermissionDeniedError("Unable to write " + temporary.string());
+    const auto [dump_size, mtime] = stamp(dump);
+    const auto count              = static_cast<std::uint64_t>(index.size());
+    file.write(magic.data(), static_cast<std::streamsize>(magic.size()));
+    file.write(reinterpret_cast<const char *>(&version), sizeof version);
+    file.write(reinterpret_cast<const char *>(&dump_size), sizeof dump_size);
+    file.write(reinterpret_cast<const char *>(&mtime), sizeof mtime);
+    file.write(reinterpret_cast<const char *>(&body), sizeof body);
+    file.write(reinterpret_cast<const char *>(&step), sizeof step);
+    file.write(reinterpret_cast<const char *>(&count), sizeof count);
+    file.write(reinterpret_cast<const char *>(index.data()), static_cast<std::streamsize>(count * sizeof(entry)));
+    if (not file.flush()) {
+      file.close();
+      std::filesystem::remove(temporary, ec);
+      return absl::DataLossError("Unable to write " + temporary.string());
+    }
+  }
+  std::filesystem::rename(temporary, sidecar, ec);
+  if (ec) {
+    const auto message = ec.message();
+    std::filesystem::remove(temporary, ec);
+    return absl::PermissionDeniedError("Unable to rename " + temporary.string() + ": " + message);
+  }
+  return OkStatus();
+}
+
+inline std::pair<seek_index::size_type, seek_index::size_type>
+seek_index::locate(const time_range &range) const noexcept {
+  // the last entry at or before the first time, and the first one after the last time
+  const auto by_time = [](const entry &e) { return e.time; };
+  const auto first   = std::ranges::upper_bound(index, range.first, {}, by_time);
+  const auto last    = std::ranges::upper_bound(index, range.last, {}, by_time);
+  const auto begin   = first == index.begin() ? body : std::prev(first)->full_state;
+  const auto end     = last == index.end() ? size : last->offset;
+  return {static_cast<size_type>(begin), static_cast<size_type>(std::max(begin, end))};
+}
+} // namespace net::ancillarycat::waver
@@ -0,0 +1,87 @@
+/**************************************************************************************
+ * @file signal_filter.hpp
+ * @brief selection of signals by hierarchical scope prefix or glob pattern.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "config.hpp"
+
+namespace net::ancillarycat::waver {
+/// @brief a set of patterns matched against dot-separated hierarchical names such as `top.alu.carry`
+/// @note a pattern selects a signal if it matches the signal's full name or the name of any scope enclosing it,
+///       so `top.alu` selects everything below `top.alu`. Patterns may use `*` (any run of characters, dots
+///       included) and `?` (any single character). An empty filter selects every signal.
+class signal_filter {
+public:
+  using size_type     = std::size_t;
+  using string_t      = std::string;
+  using string_view_t = std::string_view;
+  using patterns_t    = std::vector<string_t>;
+
+  /// @brief separates scope names in a hierarchical name
+  static inline constexpr char separator = '.';
+
+public:
+  inline signal_filter() = default;
+  inline signal_filter(std::initializer_list<string_t> patterns) : patterns(patterns) {}
+  inline explicit signal_filter(patterns_t patterns) : patterns(std::move(patterns)) {}
+
+public:
+  /// @brief add a pattern; the filter selects the union of its patterns
+  inline signal_filter &add(string_t pattern) {
+    patterns.emplace_back(std::move(pattern));
+    return *this;
+  }
+
+  /// @brief whether the filter selects everything, i.e. has no pattern
+  WAVER_NODISCARD inline bool empty() const noexcept { return patterns.empty(); }
+
+  /// @brief whether the signal with the hierarchical name `path` is selected
+  WAVER_NODISCARD inline bool matches(const string_view_t path) const noexcept {
+    if (patterns.empty())
+      return true;
+    return std::ranges::any_of(patterns, [path](const string_view_t pattern) {
+      // the name itself, then every enclosing scope
+      for (auto prefix = path; not prefix.empty(); prefix = prefix.substr(0, prefix.find_last_of(separator))) {
+        if (glob(pattern, prefix))
+          return true;
+        if (prefix.find(separator) == string_view_t::npos)
+          break;
+      }
+      return false;
+    });
+  }
+
+  /// @brief match `text` against a pattern of literal characters, `*` and `?`
+  WAVER_NODISCARD inline static constexpr bool glob(const string_view_t pattern, const string_view_t text) noexcept {
+    auto p = size_type{0}, t = size_type{0};
+    // where to resume after the last `*`, which then swallows one more character
+    auto star = string_view_t::npos, resume = size_type{0};
+    while (t < text.size()) {
+      if (p < pattern.size() and (pattern[p] == '?' or pattern[p] == text[t])) {
+        ++p, ++t;
+      } else if (p < pattern.size() and pattern[p] == '*') {
+        star   = p++;
+        resume = t;
+      } else if (star != string_view_t::npos) {
+        p = star + 1;
+        t = ++resume;
+      } else
+        return false;
+    }
+    while (p < pattern.size() and pattern[p] == '*')
+      ++p;
+    return p == pattern.size();
+  }
+
+private:
+  patterns_t patterns;
+};
+} // namespace net::ancillarycat::waver
@@ -0,0 +1,149 @@
+/**************************************************************************************
+ * @file signal_table.hpp
+ * @brief interning of VCD identifier codes into dense signal ids.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "config.hpp"
+#include "contract.hpp"
+
+namespace net::ancillarycat::waver {
+/// @brief maps VCD identifier codes (`!`, `#`, `a}`, ...) to dense signal ids and back, and records the declared
+///        width of every signal
+/// @note codes are interned once while parsing the header; looking one up on the value change path is a
+///       base-94 decode plus an array index, no hashing and no allocation.
+/// @note all storage comes from the allocator the table was constructed with, see allocator_t
+class signal_table {
+public:
+  using size_type      = std::size_t;
+  using string_t       = std::pmr::string;
+  using string_view_t  = std::string_view;
+  using code_t         = std::uint64_t;
+  using codes_t        = std::pmr::vector<string_t>;
+  using allocator_type = allocator_t;
+
+  /// @brief the longest code decode() handles; 8 bijective base-94 digits still fit in 64 bits
+  static inline constexpr size_type max_decoded_length = 8;
+  /// @brief decoded codes below this are looked up in a flat array, the rest in a hash map
+  static inline constexpr code_t direct_limit = code_t{1} << 22;
+
+public:
+  inline explicit signal_table(const allocator_type &allocator = {}) :
+      codes(allocator), widths(allocator), direct(allocator), sparse(allocator), long_codes(allocator) {}
+  inline signal_table(const signal_table &rhs, const allocator_type &allocator = {}) :
+      codes(rhs.codes, allocator), widths(rhs.widths, allocator), direct(rhs.direct, allocator),
+      sparse(rhs.sparse, allocator), long_codes(rhs.long_codes, allocator) {}
+  inline signal_table(signal_table &&) noexcept = default;
+  inline signal_table(signal_table &&rhs, const allocator_type &allocator) :
+      codes(std::move(rhs.codes), allocator), widths(std::move(rhs.widths), allocator),
+      direct(std::move(rhs.direct), allocator), sparse(std::move(rhs.sparse), allocator),
+      long_codes(std::move(rhs.long_codes), allocator) {}
+  inline signal_table &operator=(const signal_table &) = default;
+  inline signal_table &operator=(signal_table &&)      = default;
+  inline ~signal_table() noexcept                      = default;
+
+public:
+  /// @brief decode an identifier code as a bijective base-94 number, the first character being the least
+  ///        significant digit; `!` is 1, `~` is 94, `!!` is 95, so sequentially generated codes stay dense
+  /// @return the decoded value, or std::nullopt if the code is empty, too long, or not printable ASCII
+  WAVER_NODISCARD WAVER_FORCEINLINE static constexpr std::optional<code_t> decode(const string_view_t code) noexcept {
+    if (code.empty() or code.size() > max_decoded_length)
+      return std::nullopt;
+    auto value  = code_t{0};
+    auto weight = code_t{1};
+    for (const auto c : code) {
+      const auto digit = static_cast<unsigned char>(c);
+      if (digit < '!' or digit > '~')
+        return std::nullopt;
+      value += (digit - '!' + 1) * weight;
+      weight *= 94;
+    }
+    return value;
+  }
+
+  /// @brief return the id of `code`, assigning the next free id if it has not been seen before
+  /// @param code the identifier code
+  /// @param width the declared width; an alias keeps the widest declaration
+  inline signal_id_t intern(const string_view_t code, const size_type width = 1) {
+    if (const auto id = find(code); id != invalid_signal_id) {
+      widths[id] = std::max(widths[id], width);
+      return id;
+    }
+    const auto id = static_cast<signal_id_t>(codes.size());
+    codes.emplace_back(code);
+    widths.emplace_back(width);
+    if (const auto value = decode(code); not value)
+      long_codes.emplace(codes.back(), id);
+    else if (*value < direct_limit) {
+      if (direct.size() <= *value)
+        direct.resize(static_cast<size_type>(*value) + 1, invalid_signal_id);
+      direct[static_cast<size_type>(*value)] = id;
+    } else
+      sparse.emplace(*value, id);
+    return id;
+  }
+
+  /// @brief look up the id of `code`
+  /// @return the id, or invalid_signal_id if the code was never interned
+  WAVER_NODISCARD WAVER_FORCEINLINE signal_id_t find(const string_view_t code) const {
+    if (const auto value = decode(code); value) [[likely]]
+      return find_decoded(*value);
+    if (const auto it = long_codes.find(string_t{code}); it != long_codes.end())
+      return it->second;
+    return invalid_signal_id;
+  }
+
+  /// @brief look up the id of the code decode() turns into `value`, for a caller that decoded it itself
+  /// @return the id, or invalid_signal_id if the code was never interned
+  WAVER_NODISCARD WAVER_FORCEINLINE signal_id_t find_decoded(const code_t value) const {
+    if (value < direct.size()) [[likely]]
+      return direct[static_cast<size_type>(value)];
+    if (const auto it = sparse.find(value); it != sparse.end())
+      return it->second;
+    return invalid_signal_id;
+  }
+
+  /// @brief the identifier code of a signal
+  /// @pre id < size()
+  WAVER_NODISCARD inline string_view_t code(const signal_id_t id) const noexcept {
+    WAVER_PRECONDITION(id < codes.size());
+
+    return codes[id];
+  }
+
+  /// @brief the declared width of a signal
+  /// @pre id < size()
+  WAVER_NODISCARD inline size_type width(const signal_id_t id) const noexcept {
+    WAVER_PRECONDITION(id < widths.size());
+
+    return widths[id];
+  }
+
+  /// @brief the number of distinct signals
+  WAVER_NODISCARD inline size_type size() const noexcept { return codes.size(); }
+  WAVER_NODISCARD inline bool      empty() const noexcept { return codes.empty(); }
+
+  WAVER_NODISCARD inline allocator_type get_allocator() const noexcept { return codes.get_allocator(); }
+
+private:
+  /// @brief id -> code
+  codes_t codes;
+  /// @brief id -> declared width
+  std::pmr::vector<size_type> widths;
+  /// @brief decoded code -> id, for decoded codes below direct_limit
+  std::pmr::vector<signal_id_t> direct;
+  /// @brief decoded code -> id, for decoded codes at or above direct_limit
+  std::pmr::unordered_map<code_t, signal_id_t> sparse;
+  /// @brief code -> id, for codes decode() rejects
+  std::pmr::unordered_map<string_t, signal_id_t> long_codes;
+};
+} // namespace net::ancillarycat::waver
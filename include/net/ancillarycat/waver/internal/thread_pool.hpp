@@ -0,0 +1,102 @@
+/**************************************************************************************
+ * @file thread_pool.hpp
+ * @brief a fixed-size thread pool for independent tasks.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "config.hpp"
+
+namespace net::ancillarycat::waver {
+/// @brief runs tasks on a fixed set of threads, from one queue
+/// @note tasks start in the order they were submitted, each on whichever thread is free first, so long tasks do not
+///       hold back the ones behind them on other threads. Tasks are meant to be coarse, e.g. a whole file, so that the
+///       single lock the threads claim them under is never contended for long.
+/// @note a task must not throw. Destroying the pool runs the tasks still queued before joining the threads.
+class thread_pool {
+public:
+  using size_type = std::size_t;
+  /// @brief a task, given the index of the thread running it, in `[0, size())`
+  using task_t = std::function<void(size_type)>;
+
+public:
+  /// @param threads the number of threads, 0 for one per hardware thread
+  inline explicit thread_pool(const size_type threads = 0) {
+    const auto count = threads ? threads : std::max(size_type{std::thread::hardware_concurrency()}, size_type{1});
+    workers.reserve(count);
+    for (size_type i = 0; i < count; ++i)
+      workers.emplace_back([this, i] { run(i); });
+  }
+  inline thread_pool(const thread_pool &)            = delete;
+  inline thread_pool &operator=(const thread_pool &) = delete;
+  inline ~thread_pool() noexcept {
+    wait();
+    {
+      auto lock = std::scoped_lock{mutex};
+      stopping  = true;
+    }
+    available.notify_all();
+    workers.clear();
+  }
+
+public:
+  /// @brief queue `task` to run on one of the threads
+  inline void submit(task_t task) {
+    {
+      auto lock = std::scoped_lock{mutex};
+      tasks.emplace_back(std::move(task));
+      ++unfinished;
+    }
+    available.notify_one();
+  }
+
+  /// @brief block until every task submitted so far has finished
+  inline void wait() {
+    auto lock = std::unique_lock{mutex};
+    finished.wait(lock, [this] { return unfinished == 0; });
+  }
+
+  WAVER_NODISCARD inline size_type size() const noexcept { return workers.size(); }
+
+private:
+  inline void run(const size_type self) {
+    for (;;) {
+      auto task = task_t{};
+      {
+        auto lock = std::unique_lock{mutex};
+        available.wait(lock, [this] { return not tasks.empty() or stopping; });
+        if (tasks.empty())
+          return;
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task(self);
+      {
+        auto lock = std::scoped_lock{mutex};
+        if (--unfinished)
+          continue;
+      }
+      finished.notify_all();
+    }
+  }
+
+private:
+  std::vector<std::jthread> workers;
+  /// @brief the tasks not claimed by a thread yet, oldest first, and the tasks not finished yet, guarded by `mutex`
+  std::deque<task_t> tasks;
+  size_type          unfinished = 0;
+  bool               stopping   = false;
+
+  std::mutex              mutex;
+  std::condition_variable available;
+  std::condition_variable finished;
+};
+} // namespace net::ancillarycat::waver
@@ -0,0 +1,185 @@
+/**************************************************************************************
+ * @file token.hpp
+ * @brief typed tokens, classified once by the lexer so that the parser dispatches on an integer.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include "config.hpp"
+#include "contract.hpp"
+
+namespace net::ancillarycat::waver {
+/// @brief what a token is, judged from its text alone
+/// @note the classification knows no context: the identifier code `#` of a `$var` is a kTime and the width `1` a
+///       kScalarChange. The parser only relies on a kind where the grammar allows it, and reads the text otherwise.
+enum class token_kind : std::uint8_t {
+  /// @brief the empty token after the last one
+  kEof = 0,
+  /// @brief anything else: a name, a width, an identifier code, a reference, a scope kind, ...
+  kWord,
+  /// @brief `#` and a time
+  kTime,
+  /// @brief `0`, `1`, `x`, `X`, `z` or `Z`, and an identifier code
+  kScalarChange,
+  /// @brief `b`, `B`, `r`, `R`, `s` or `S` and a value; the identifier code is the next token
+  kVectorChange,
+  /// @brief a `$` word that is no keyword of the format
+  kUnknownKeyword,
+  kVersion,
+  kDate,
+  kTimescale,
+  kScope,
+  kUpscope,
+  kVar,
+  kComment,
+  kDumpvars,
+  kDumpall,
+  kDumpon,
+  kDumpoff,
+  kEnd,
+  kEnddefinitions,
+};
+
+/// @brief the `$` keywords of the format, looked up through a perfect hash computed at compile time
+/// @note the hash of a keyword is its length and its second and last characters, multiplied by a seed that is
+///       searched for at compile time until no two keywords share a slot. Classifying a `$` word is then one
+///       multiplication and one comparison with the only keyword it could be, however many keywords there are.
+class keyword_table {
+public:
+  using size_type     = std::size_t;
+  using string_view_t = std::string_view;
+
+  static inline constexpr auto entries = std::array{
+    std::pair{keywords::$version, token_kind::kVersion},
+    std::pair{keywords::$date, token_kind::kDate},
+    std::pair{keywords::$timescale, token_kind::kTimescale},
+    std::pair{keywords::$scope, token_kind::kScope},
+    std::pair{keywords::$upscope, token_kind::kUpscope},
+    std::pair{keywords::$var, token_kind::kVar},
+    std::pair{keywords::$comment, token_kind::kComment},
+    std::pair{keywords::$dumpvars, token_kind::kDumpvars},
+    std::pair{keywords::$dumpall, token_kind::kDumpall},
+    std::pair{keywords::$dumpon, token_kind::kDumpon},
+    std::pair{keywords::$dumpoff, token_kind::kDumpoff},
+    std::pair{keywords::$end, token_kind::kEnd},
+    std::pair{keywords::$enddefinitions, token_kind::kEnddefinitions},
+  };
+  /// @brief log2 of the number of slots
+  static inline constexpr auto bits = 5u;
+  using slots_t = std::array<std::pair<string_view_t, token_kind>, size_type{1} << bits>;
+
+public:
+  /// @brief the kind of a word starting with `$`, kUnknownKeyword if it is no keyword
+  WAVER_NODISCARD WAVER_FORCEINLINE static constexpr token_kind find(const string_view_t word) noexcept {
+    if (word.size() < 2)
+      return token_kind::kUnknownKeyword;
+    const auto &[keyword, kind] = slots[slot(word, seed)];
+    return keyword == word ? kind : token_kind::kUnknownKeyword;
+  }
+
+  /// @brief the text of a keyword kind
+  /// @pre kind is a keyword, i.e. after kUnknownKeyword
+  WAVER_NODISCARD inline static constexpr string_view_t text(const token_kind kind) noexcept {
+    return entries[std::to_underlying(kind) - std::to_underlying(token_kind::kVersion)].first;
+  }
+
+private:
+  WAVER_NODISCARD WAVER_FORCEINLINE static constexpr std::uint32_t slot(const string_view_t word,
+                                                                        const std::uint32_t seed) noexcept {
+    const auto key = static_cast<std::uint32_t>(word.size()) << 16 |
+                     static_cast<std::uint32_t>(static_cast<unsigned char>(word[1])) << 8 |
+                     static_cast<unsigned char>(word.back());
+    return (key * seed) >> (32 - bits);
+  }
+
+  /// @brief the first seed that gives every keyword a slot of its own; the candidates are odd multiples of the
+  ///        golden ratio, which spread the keys over the high bits within a few dozen tries
+  WAVER_NODISCARD inline static consteval std::uint32_t find_seed() noexcept {
+    for (auto i = std::uint32_t{1};; ++i) {
+      const auto seed  = (i * std::uint32_t{0x9e3779b1}) | 1u;
+      auto       taken = std::array<bool, size_type{1} << bits>{};
+      auto clash = false;
+      for (const auto &[keyword, _] : entries)
+        clash = std::exchange(taken[slot(keyword, seed)], true) or clash;
+      if (not clash)
+        return seed;
+    }
+  }
+
+  WAVER_NODISCARD inline static consteval slots_t make_slots(const std::uint32_t seed) noexcept {
+    auto table = slots_t{};
+    for (const auto &entry : entries)
+      table[slot(entry.first, seed)] = entry;
+    return table;
+  }
+
+private:
+  /// @brief defined below, once the functions computing them are
+  static const std::uint32_t seed;
+  static const slots_t       slots;
+};
+inline constexpr std::uint32_t           keyword_table::seed  = find_seed();
+inline constexpr keyword_table::slots_t keyword_table::slots = make_slots(seed);
+
+/// @brief a token and its kind, 16 bytes
+/// @note the text points into the input, or a window of it, like the views the lexer hands out.
+class token {
+public:
+  using size_type     = std::uint32_t;
+  using string_view_t = std::string_view;
+
+public:
+  /// @brief the end of the input
+  inline constexpr token() noexcept = default;
+  /// @pre text.size() fits in size_type
+  inline constexpr explicit token(const string_view_t text, const token_kind kind) noexcept :
+      first(text.data()), length(static_cast<size_type>(text.size())), tag(kind) {}
+  /// @brief a token of the kind classify() gives `text`
+  inline constexpr explicit token(const string_view_t text) noexcept : token(text, classify(text)) {}
+
+public:
+  WAVER_NODISCARD WAVER_FORCEINLINE constexpr string_view_t text() const noexcept { return {first, length}; }
+  WAVER_NODISCARD WAVER_FORCEINLINE constexpr token_kind    kind() const noexcept { return tag; }
+  WAVER_NODISCARD WAVER_FORCEINLINE constexpr bool          is(const token_kind kind) const noexcept {
+    return tag == kind;
+  }
+
+  /// @brief the kind of `text`, from its first character and, for a `$` word, the keyword_table
+  WAVER_NODISCARD WAVER_FORCEINLINE static constexpr token_kind classify(const string_view_t text) noexcept {
+    if (text.empty())
+      return token_kind::kEof;
+    switch (text.front()) {
+    case '#':
+      return token_kind::kTime;
+    case '0':
+    case '1':
+    case 'x':
+    case 'X':
+    case 'z':
+    case 'Z':
+      return token_kind::kScalarChange;
+    case 'b':
+    case 'B':
+    case 'r':
+    case 'R':
+    case 's':
+    case 'S':
+      return token_kind::kVectorChange;
+    case '$':
+      return keyword_table::find(text);
+    default:
+      return token_kind::kWord;
+    }
+  }
+
+private:
+  const char *first  = nullptr;
+  size_type   length = 0;
+  token_kind  tag    = token_kind::kEof;
+};
+static_assert(sizeof(token) <= 16);
+} // namespace net::ancillarycat::waver
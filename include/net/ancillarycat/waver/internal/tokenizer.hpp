@@ -0,0 +1,152 @@
+/**************************************************************************************
+ * @file tokenizer.hpp
+ * @brief vectorized whitespace tokenizer used by the lexer.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "config.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define WAVER_TOKENIZER_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(WAVER_TOKENIZER_X86) && (defined(__clang__) || defined(__GNUC__))
+#define WAVER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define WAVER_TARGET_AVX2
+#endif
+
+/// @brief classifies the input 64 bytes at a time against the separator set and emits tokens from the resulting
+///        bitmasks. The kernel (AVX2, SSE2 or scalar) is selected once at runtime.
+namespace net::ancillarycat::waver::tokenizer {
+/// @brief number of bytes classified per step
+inline constexpr std::size_t block_size = 64;
+
+/// @brief returns a mask with bit `i` set iff `block[i]` is a separator (space, `\t`, `\n`, `\v`, `\f` or `\r`)
+using separator_mask_t = std::uint64_t (*)(const char *) noexcept;
+
+WAVER_NODISCARD inline std::uint64_t separator_mask_scalar(const char *const block) noexcept {
+  auto mask = std::uint64_t{0};
+  for (auto i = std::size_t{0}; i < block_size; ++i) {
+    const auto c = static_cast<unsigned char>(block[i]);
+    mask |= static_cast<std::uint64_t>(c == ' ' || (c >= '\t' && c <= '\r')) << i;
+  }
+  return mask;
+}
+
+#ifdef WAVER_TOKENIZER_X86
+WAVER_NODISCARD inline std::uint64_t separator_mask_sse2(const char *const block) noexcept {
+  const auto space = _mm_set1_epi8(' ');
+  // `\t`..`\r` is 0x09..0x0d; bytes >= 0x80 compare as negative and fall outside the range
+  const auto low  = _mm_set1_epi8('\t' - 1);
+  const auto high = _mm_set1_epi8('\r' + 1);
+  auto       mask = std::uint64_t{0};
+  for (auto i = std::size_t{0}; i < block_size; i += 16) {
+    const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i));
+    const auto range = _mm_and_si128(_mm_cmpgt_epi8(bytes, low), _mm_cmplt_epi8(bytes, high));
+    const auto hits  = _mm_or_si128(_mm_cmpeq_epi8(bytes, space), range);
+    mask |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(hits))) << i;
+  }
+  return mask;
+}
+
+WAVER_TARGET_AVX2 WAVER_NODISCARD inline std::uint64_t separator_mask_avx2(const char *const block) noexcept {
+  const auto space = _mm256_set1_epi8(' ');
+  const auto low   = _mm256_set1_epi8('\t' - 1);
+  const auto high  = _mm256_set1_epi8('\r' + 1);
+  auto       mask  = std::uint64_t{0};
+  for (auto i = std::size_t{0}; i < block_size; i += 32) {
+    const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i));
+    const auto range = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, low), _mm256_cmpgt_epi8(high, bytes));
+    const auto hits  = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, space), range);
+    mask |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(hits))) << i;
+  }
+  return mask;
+}
+
+/// @brief whether the cpu and the os both support AVX2
+WAVER_NODISCARD inline bool has_avx2() noexcept {
+#if defined(__clang__) || defined(__GNUC__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+  int info[4] = {};
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+  __cpuid(info, 1);
+  // OSXSAVE, and the os saves the ymm registers
+  if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 0x6) != 0x6)
+    return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return false;
+#endif
+}
+#endif
+
+/// @brief pick the widest kernel the running machine supports
+WAVER_NODISCARD inline separator_mask_t select_separator_mask() noexcept {
+#ifdef WAVER_TOKENIZER_X86
+  if (has_avx2())
+    return &separator_mask_avx2;
+  return &separator_mask_sse2;
+#else
+  return &separator_mask_scalar;
+#endif
+}
+
+/// @brief the kernel used by split(), resolved on first use
+WAVER_NODISCARD inline separator_mask_t separator_mask() noexcept {
+  static const auto selected = select_separator_mask();
+  return selected;
+}
+
+/// @brief split `text` at separators, calling `emit(token)` for every non-empty token in order
+/// @param text the text to split; the views passed to `emit` point into it
+/// @param emit the callback receiving each token as a std::string_view
+/// @param kernel the separator classifier, defaults to the one selected for this machine
+template <typename Emit>
+inline void split(const std::string_view text, Emit &&emit, const separator_mask_t kernel = separator_mask()) {
+  const auto *const first = text.data();
+  const auto        size  = text.size();
+  // bit 63 of the previous block's token mask, i.e. whether a token runs into the current block
+  auto carry       = std::uint64_t{0};
+  auto token_begin = std::size_t{0};
+  for (auto offset = std::size_t{0}; offset < size; offset += block_size) {
+    auto separators = std::uint64_t{0};
+    if (size - offset >= block_size) {
+      separators = kernel(first + offset);
+    } else {
+      // pad the tail with spaces, which also terminates a token ending at the last byte
+      char tail[block_size];
+      std::ranges::fill(tail, ' ');
+      std::ranges::copy(text.substr(offset), tail);
+      separators = kernel(tail);
+    }
+    const auto tokens = ~separators;
+    // a bit flips at every token start and at every separator right after a token; they alternate
+    const auto edges = tokens ^ ((tokens << 1) | carry);
+    carry            = tokens >> (block_size - 1);
+    for (auto bits = edges; bits != 0; bits &= bits - 1) {
+      const auto position = offset + static_cast<std::size_t>(std::countr_zero(bits));
+      if (tokens & (bits & -bits))
+        token_begin = position;
+      else
+        emit(std::string_view{first + token_begin, position - token_begin});
+    }
+  }
+  if (carry != 0)
+    emit(std::string_view{first + token_begin, size - token_begin});
+}
+} // namespace net::ancillarycat::waver::tokenizer
@@ -0,0 +1,160 @@
+/**************************************************************************************
+ * @file value_index.hpp
+ * @brief value-at-time queries over a parsed dump, backed by full-state checkpoints.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <vector>
+#include "config.hpp"
+#include "contract.hpp"
+#include "four_state.hpp"
+#include "meta_elements.hpp"
+#include "signal_table.hpp"
+
+namespace net::ancillarycat::waver {
+/// @brief answers "what is the value of a signal at time t" in O(log T + K)
+/// @note a checkpoint snapshots, for every signal, the position of its latest event; one is taken every `interval`
+///       events and at the end of every `$dumpall` block. A query binary-searches the timestamp and the
+///       checkpoint before it, then replays at most K = `interval` events.
+/// @note the index refers to the value_changes, dumpvars and signal_table it was built from, which must outlive
+///       it. They may only be appended to, after which extend() indexes what was added. Queries are const and may
+///       run concurrently, but not with extend().
+class value_index {
+public:
+  using size_type = std::size_t;
+  using time_t    = timestamp::time_t;
+  using value_t   = four_state_value;
+  using values_t  = std::vector<value_t>;
+
+  /// @brief default number of events between two checkpoints
+  static inline constexpr size_type default_interval = size_type{1} << 12;
+  /// @brief a signal with no event before a checkpoint
+  static inline constexpr size_type no_event = std::numeric_limits<size_type>::max();
+
+public:
+  /// @param changes the value changes to index
+  /// @param initial the initial state, i.e. the `$dumpvars` values
+  /// @param signals the signals the changes refer to
+  /// @param interval events between two checkpoints; raised to the signal count, so that the checkpoints never
+  ///        take more memory than the events themselves
+  inline explicit value_index(const value_changes &changes, const dumpvars &initial, const signal_table &signals,
+                              const size_type interval = default_interval) :
+      changes(changes), dumps(initial), signals(signals), step(std::max({interval, signals.size(), size_type{1}})),
+      next_checkpoint(step), latest(signals.size(), no_event) {
+    extend();
+  }
+
+public:
+  /// @brief index the events, `$dumpall`s and `$dumpvars` appended since the index was built or last extended
+  inline void extend() {
+    initial.assign(signals.size(), nullptr);
+    for (const auto &[signal, value] : dumps.changes)
+      initial[signal] = &value;
+
+    const auto &events = changes.events;
+    for (;; next_checkpoint += step) {
+      // checkpoints at the `$dumpall`s before the next regular one, then the regular one itself
+      const auto until = std::min(next_checkpoint, events.size());
+      for (; dumpall < changes.dumpall.size() and changes.dumpall[dumpall] <= until; ++dumpall)
+        checkpoint(changes.dumpall[dumpall]);
+      if (next_checkpoint >= events.size())
+        break;
+      checkpoint(next_checkpoint);
+    }
+  }
+
+  /// @brief the value of `signal` at `time`, i.e. after all changes at or before `time`
+  /// @return the latest value, the `$dumpvars` value if it has not changed yet, or all x if it has neither
+  WAVER_NODISCARD inline value_t value_at(const signal_id_t signal, const time_t time) const {
+    WAVER_PRECONDITION(signal < signals.size());
+
+    const auto end   = events_until(time);
+    const auto index = checkpoint_before(end);
+    const auto begin = index == no_event ? 0 : positions[index];
+    // the latest change since the checkpoint wins, so scan backwards
+    for (auto position = end; position > begin; --position)
+      if (changes.events[position - 1].signal == signal)
+        return changes.value(changes.events[position - 1]);
+    return value_of(signal, index == no_event ? no_event : states[index * signals.size() + signal]);
+  }
+
+  /// @brief the value of every signal at `time`, indexed by signal id
+  WAVER_NODISCARD inline values_t state_at(const time_t time) const {
+    const auto end   = events_until(time);
+    const auto index = checkpoint_before(end);
+    auto       state = std::vector<size_type>(signals.size(), no_event);
+    auto       begin = size_type{0};
+    if (index != no_event) {
+      const auto snapshot = std::span{states}.subspan(index * signals.size(), signals.size());
+      std::ranges::copy(snapshot, state.begin());
+      begin = positions[index];
+    }
+    for (auto position = begin; position < end; ++position)
+      state[changes.events[position].signal] = position;
+
+    auto values = values_t{};
+    values.reserve(signals.size());
+    for (signal_id_t signal = 0; signal < signals.size(); ++signal)
+      values.emplace_back(value_of(signal, state[signal]));
+    return values;
+  }
+
+  /// @brief the number of checkpoints taken
+  WAVER_NODISCARD inline size_type checkpoints() const noexcept { return positions.size(); }
+
+private:
+  /// @brief replay the events up to `position` into `latest` and snapshot it
+  inline void checkpoint(const size_type position) {
+    if (position == 0 or (not positions.empty() and positions.back() == position))
+      return;
+    for (; replay < position; ++replay)
+      latest[changes.events[replay].signal] = replay;
+    positions.emplace_back(position);
+    states.insert(states.end(), latest.begin(), latest.end());
+  }
+
+  /// @brief the number of events at or before `time`
+  WAVER_NODISCARD inline size_type events_until(const time_t time) const noexcept {
+    const auto next = static_cast<size_type>(std::ranges::upper_bound(changes.times, time) - changes.times.begin());
+    return next == changes.times.size() ? changes.events.size() : changes.offsets[next];
+  }
+
+  /// @brief the index of the last checkpoint at or before event position `end`, or no_event
+  WAVER_NODISCARD inline size_type checkpoint_before(const size_type end) const noexcept {
+    const auto after = static_cast<size_type>(std::ranges::upper_bound(positions, end) - positions.begin());
+    return after == 0 ? no_event : after - 1;
+  }
+
+  /// @brief the value of `signal` as of its event at `position`, falling back to the initial state
+  WAVER_NODISCARD inline value_t value_of(const signal_id_t signal, const size_type position) const {
+    if (position != no_event)
+      return changes.value(changes.events[position]);
+    if (initial[signal])
+      return *initial[signal];
+    return *value_t::from_vcd("bx", signals.width(signal));
+  }
+
+private:
+  const value_changes &changes;
+  const dumpvars      &dumps;
+  const signal_table  &signals;
+  /// @brief signal id -> `$dumpvars` value, null if the signal has none
+  std::vector<const value_t *> initial;
+  /// @brief the event position of each checkpoint, ascending
+  std::vector<size_type> positions;
+  /// @brief for each checkpoint and signal, the position of the signal's latest event before it, or no_event
+  std::vector<size_type> states;
+  /// @brief events between two regular checkpoints, and the position of the next one
+  size_type step;
+  size_type next_checkpoint;
+  /// @brief the replay cursor: the position of each signal's latest event before `replay`
+  std::vector<size_type> latest;
+  size_type              replay = 0;
+  /// @brief the number of `$dumpall`s checkpointed
+  size_type dumpall = 0;
+};
+} // namespace net::ancillarycat::waver
@@ -1,6 +1,7 @@
 #pragma once
 #include <absl/strings/string_view.h>
 #include <algorithm>
+#include <array>
 #ifdef WAVER_USE_BOOST_CONTRACT
 #include <boost/contract.hpp>
 #include <boost/contract/check.hpp>
@@ -11,6 +12,7 @@
 #include <csignal>
 #include <cstddef>
 #include <cstdint>
+#include <exception>
 #include <expected>
 #include <filesystem>
 #include <fstream>
@@ -18,6 +20,8 @@
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <memory_resource>
+#include <new>
 #include <nlohmann/json.hpp>
 #include <numeric>
 #include <optional>
@@ -27,11 +31,21 @@
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
+#include <variant>
 #include <vector>
+#include "body_scanner.hpp"
 #include "config.hpp"
+#include "generator.hpp"
+#include "json_writer.hpp"
 #include "lexer.hpp"
 #include "meta_elements.hpp"
+#include "name_index.hpp"
+#include "parse_stats.hpp"
+#include "seek_index.hpp"
+#include "signal_filter.hpp"
+#include "value_index.hpp"
 #include "vcd_fwd.hpp"
 
 #include <absl/status/statusor.h>
@@ -40,25 +54,176 @@
 /// 		Declaration
 //////////////////////////////////////////////////////////////////////////////
 namespace net::ancillarycat::waver {
+/// @brief options controlling how value_change_dump::parse reads its source
+struct parse_options {
+  using size_type = std::size_t;
+
+  /// @brief lex the file through a bounded window instead of mapping and tokenizing it whole;
+  ///        ignored when parsing from a string, which is already in memory
+  bool streaming = false;
+  /// @brief the number of bytes read per window in streaming mode
+  size_type window_size = lexer</* default template arguments */>::default_window_size;
+  /// @brief the number of workers parsing the value changes, 0 for one per hardware thread;
+  ///        ignored in streaming mode
+  size_type threads = 1;
+  /// @brief the smallest slice of the value change section handed to a worker, in bytes
+  size_type min_chunk_size = size_type{1} << 20;
+  /// @brief scan the value change section of an input in memory byte by byte, see body_scanner, instead of lexing it
+  ///        into tokens; ignored in streaming mode
+  bool byte_scanner = true;
+  /// @brief only record the changes of the signals this selects; the header always lists every signal
+  signal_filter filter;
+  /// @brief where to record per-phase counters, none if null; only filled in if `WAVER_ENABLE_STATS` is defined
+  parse_stats *stats = nullptr;
+  /// @brief timestamps between two entries of a seek index built for a time-window parse
+  size_type seek_interval = seek_index::default_interval;
+  /// @brief where to look a file up before parsing it, and to store it after, none if null; a filtered parse
+  ///        bypasses the cache, which holds complete dumps only
+  parse_cache *cache = nullptr;
+  /// @brief where the model is allocated, the default resource if null; e.g. an arena, to free a whole dump at once
+  ///        or to cap its memory. A parse that runs out of it fails with a resource-exhausted status.
+  /// @note only the thread calling parse() allocates from it, the workers of a parallel parse fill their slices on
+  ///       the default resource and the result is copied over, so it need not be thread-safe
+  std::pmr::memory_resource *memory = nullptr;
+
+  /// @brief the allocator on `memory`
+  WAVER_NODISCARD inline allocator_t allocator() const noexcept {
+    return allocator_t{memory ? memory : std::pmr::get_default_resource()};
+  }
+
+  /// @brief the number of workers actually used for `threads`
+  WAVER_NODISCARD inline size_type concurrency() const noexcept {
+    return threads ? threads : std::max(size_type{std::thread::hardware_concurrency()}, size_type{1});
+  }
+};
+
+/// @brief a change met by value_change_dump::stream()
+struct change_view {
+  /// @brief the time of the enclosing timestamp, 0 for a `$dumpvars` before the first one
+  timestamp::time_t time = 0;
+  signal_id_t       signal = invalid_signal_id;
+  /// @brief the value as written in the dump, e.g. `1` or `b0101`, not validated; it points into the input, so it
+  ///        is only valid until the generator is resumed
+  std::string_view value;
+};
+
+/// @brief an item of value_change_dump::stream(): first the dump with only its header parsed, then every change in
+///        file order, or the error that ends the stream
+using stream_item = std::variant<const value_change_dump *, change_view, Status>;
+
+/// @brief a `$var` declaration met by a parse_handler; the views point into the input and are only valid during the
+///        call
+struct var_view {
+  enum port::type  type   = port::kUnknown;
+  std::size_t      width  = 0;
+  signal_id_t      signal = invalid_signal_id;
+  std::string_view code;
+  std::string_view name;
+  std::string_view reference;
+};
+
+/// @brief a type value_change_dump::parse() can report a dump to, instead of building the model; it has any of
+/// - `on_scope_begin(scope_kind, std::string_view name)` and `on_scope_end()`
+/// - `on_var(const var_view &)`
+/// - `on_time(timestamp::time_t)`, at every timestamp of the value change section
+/// - `on_dump_begin(std::string_view keyword)` and `on_dump_end(std::string_view keyword)`, around `$dumpvars`,
+///   `$dumpall`, `$dumpon` and `$dumpoff`
+/// - `on_change(signal_id_t, std::string_view value)`, returning void, or false to reject the value and fail the parse
+/// - `on_end()`, once the whole input has been parsed successfully
+template <typename Handler>
+concept parse_handler =
+  requires(Handler &handler, const signal_id_t signal, const std::string_view value) {
+    handler.on_change(signal, value);
+  } or requires(Handler &handler, const timestamp::time_t time) { handler.on_time(time); } or
+  requires(Handler &handler, const var_view &var) { handler.on_var(var); } or
+  requires(Handler &handler, const scope_kind kind, const std::string_view name) {
+    handler.on_scope_begin(kind, name);
+  } or requires(Handler &handler) { handler.on_end(); };
+
 /// @brief Represents a Value Change Dump (VCD) file
 /// @note the VCD file is a standard file format used to simulate digital circuits
 class value_change_dump {
+  enum WAVER_NODISCARD parse_error : std::uint8_t;
+
+  /// @brief the parse handler building the model, i.e. the header, dumpvars and value_changes of a dump
+  class model_handler {
+  public:
+    /// @param vcd the dump to fill in
+    /// @param signals where the widths of the signals are looked up; the table of `vcd`, except in a worker of the
+    ///        parallel parser
+    inline explicit model_handler(value_change_dump &vcd, const signal_table &signals) noexcept :
+        vcd(vcd), signals(signals) {}
+
+  public:
+    inline void on_scope_begin(const scope_kind kind, const std::string_view name) {
+      vcd.header.scopes.open(kind, name);
+    }
+    inline void on_scope_end() { vcd.header.scopes.close(); }
+    inline void on_var(const var_view &var) {
+      vcd.header.scopes.add_port(var.type, var.width, var.signal, var.name, var.reference);
+    }
+    WAVER_FORCEINLINE void on_time(const timestamp::time_t time) { vcd.value_changes.begin_timestamp(time); }
+    inline void            on_dump_begin(const std::string_view keyword) {
+      in_dumpvars = keyword == keywords::$dumpvars;
+    }
+    inline void            on_dump_end(const std::string_view keyword) {
+      in_dumpvars = false;
+      if (keyword == keywords::$dumpall)
+        vcd.value_changes.mark_dumpall();
+    }
+    /// @return false if `value` is not a valid value of the signal
+    WAVER_NODISCARD WAVER_FORCEINLINE bool on_change(const signal_id_t signal, const std::string_view value) {
+      if (not in_dumpvars) [[likely]]
+        return vcd.value_changes.append(signal, value, signals.width(signal));
+      auto initial = ports_value_t::from_vcd(value, signals.width(signal));
+      if (not initial)
+        return false;
+      vcd.dumpvars.changes.emplace_back(signal, std::move(*initial));
+      return true;
+    }
+
+  public:
+    value_change_dump  &vcd;
+    const signal_table &signals;
+
+  private:
+    /// @brief whether the changes go to the `$dumpvars` of the dump
+    bool in_dumpvars = false;
+  };
+
   /// @brief Represents the value change dump parser
-  /// @note the parser is used to parse the VCD file
-  class parser {
+  /// @tparam Handler receives what the parser meets, see parse_handler; model_handler to build the model, or an
+  ///         lvalue reference to the caller's handler
+  /// @note the handler is called directly, not through a virtual function, so its callbacks can be inlined into the
+  ///       loop over the changes
+  template <typename Handler>
+  class basic_parser {
+    friend class follower;
+
+  public:
+    /// @brief whether the parser builds the model, which the parallel body and the time-window parse need
+    static inline constexpr bool builds_model = std::same_as<Handler, model_handler>;
+
   public:
-    inline constexpr explicit parser(value_change_dump &vcd) noexcept : vcd(vcd) {}
+    inline explicit basic_parser(value_change_dump &vcd, parse_options options = {}) noexcept
+      requires builds_model
+        : handler(vcd, vcd.header.signals), declared(&vcd.header.signals), signals(vcd.header.signals),
+          options(std::move(options)) {}
+    /// @param handler see Handler
+    /// @param signals where the declarations are interned, and the identifier codes looked up
+    /// @param options see parse_options
+    inline explicit basic_parser(Handler handler, signal_table &signals, parse_options options = {}) noexcept :
+        handler(std::forward<Handler>(handler)), declared(&signals), signals(signals), options(std::move(options)) {}
 
-    inline constexpr  parser(const parser &)     = delete;
-    inline constexpr  parser(parser &&) noexcept = delete;
-    inline constexpr ~parser() noexcept          = default;
+    inline constexpr  basic_parser(const basic_parser &)     = delete;
+    inline constexpr  basic_parser(basic_parser &&) noexcept = delete;
+    inline constexpr ~basic_parser() noexcept                = default;
 
-    inline constexpr parser &operator=(const parser &)     = delete;
-    inline constexpr parser &operator=(parser &&) noexcept = delete;
+    inline constexpr basic_parser &operator=(const basic_parser &)     = delete;
+    inline constexpr basic_parser &operator=(basic_parser &&) noexcept = delete;
 
 
   public:
-    enum WAVER_NODISCARD parse_error : std::uint8_t;
     using value_type      = value_change_dump;
     using parse_error_t   = parse_error;
     using reference       = value_type &;
@@ -69,57 +234,193 @@ class value_change_dump {
     using string_view_t   = std::string_view;
     using size_type       = std::string::size_type;
     using lexer_t         = lexer</* default template arguments */>;
+    using token_t         = lexer_t::token_t;
+    /// @brief a change whose value still points into the lexer's input
+    using change_view_t = std::pair<signal_id_t, string_view_t>;
     template <typename Data>
     using optional_t = std::optional<Data>;
     template <typename Data>
     using expected_t = std::expected<Data, parse_error_t>;
 
   public:
-    WAVER_NODISCARD inline constexpr reference       get() noexcept { return vcd; }
-    WAVER_NODISCARD inline constexpr const_reference get() const noexcept { return vcd; }
-    WAVER_NODISCARD inline constexpr pointer         data() const noexcept { return &vcd; }
-    WAVER_NODISCARD inline constexpr const_pointer   data() noexcept { return &vcd; }
-    inline Status load(const std::filesystem::path &filepath) noexcept { return lexer.load(filepath); }
-    inline Status load(string_t &&content) noexcept { return lexer.load(std::forward<string_t>(content)); }
+    WAVER_NODISCARD inline constexpr reference get() noexcept
+      requires builds_model
+    {
+      return handler.vcd;
+    }
+    WAVER_NODISCARD inline constexpr const_reference get() const noexcept
+      requires builds_model
+    {
+      return handler.vcd;
+    }
+    WAVER_NODISCARD inline constexpr const_pointer data() const noexcept
+      requires builds_model
+    {
+      return &handler.vcd;
+    }
+    WAVER_NODISCARD inline constexpr pointer data() noexcept
+      requires builds_model
+    {
+      return &handler.vcd;
+    }
+    inline Status load(const std::filesystem::path &filepath) noexcept {
+      WAVER_STATS(const auto timer = parse_stats::timer{options.stats, parse_stats::kLoad};)
+      auto res = options.streaming ? lexer.load_stream(filepath, options.window_size) : lexer.load(filepath);
+      WAVER_STATS(record(parse_stats::kLoad, lexer.view().size());)
+      return res;
+    }
+    inline Status load(string_t &&content) noexcept {
+      WAVER_STATS(const auto timer = parse_stats::timer{options.stats, parse_stats::kLoad};)
+      auto res = lexer.load(std::forward<string_t>(content));
+      WAVER_STATS(record(parse_stats::kLoad, lexer.view().size());)
+      return res;
+    }
+
+    /// @brief lex into buffers an earlier parser released, see lexer::reuse()
+    inline void reuse(lexer_t::buffers_t &&buffers) noexcept { lexer.reuse(std::move(buffers)); }
+    /// @brief give up the buffers of the lexer for a later parser, see lexer::release()
+    WAVER_NODISCARD inline lexer_t::buffers_t release() noexcept { return lexer.release(); }
 
   public:
     /// @brief parse the VCD file
     /// @return OkStatus() if successful, various errors otherwise
     inline Status parse();
+    /// @brief parse the header and only the part of the value change section covering `range`
+    /// @param dump the path the input was loaded from; its seek index is loaded, or built and saved
+    /// @return OkStatus() if successful, various errors otherwise
+    inline Status parse(const std::filesystem::path &dump, const time_range &range);
+    /// @brief stream `source` through a window and yield its changes instead of recording them, see
+    ///        value_change_dump::stream()
+    template <typename Source>
+    inline static generator<stream_item> stream(Source source, parse_options options);
+
+  private:
+    /// @brief a worker parsing a slice of the value change section into `partial`, looking codes up in `signals`
+    inline explicit basic_parser(value_change_dump &partial, const signal_table &signals, std::vector<bool> selected)
+      requires builds_model
+        : handler(partial, signals), signals(signals), selected(std::move(selected)) {}
+
+  private:
+    /// @brief lex and parse everything up to and including `$enddefinitions $end`
+    /// @param body_offset where the value change section starts, only the bytes before are lexed; npos to lex all
+    inline Status parse_definitions(size_type body_offset);
+    /// @brief parse the window of the value change section that `index` locates for `range`
+    inline Status parse(const seek_index &index, const time_range &range);
 
   private:
     inline parse_error_t        parse_value_changes();
     inline parse_error_t        parse_header();
+    /// @brief skip a `$version` or `$date` block, up to and including its `$end`
     inline parse_error_t        parse_version();
     inline parse_error_t        parse_comments();
     inline parse_error_t        parse_timescale();
-    inline parse_error_t        parse_scope_fwd(scope *);
+    inline parse_error_t        parse_scope_fwd();
     inline parse_error_t        parse_body();
+    inline parse_error_t        parse_body(string_view_t body, size_type workers);
+    /// @brief parse the value changes in `body` with a body_scanner instead of the lexer
+    inline parse_error_t        scan_body(string_view_t body);
     inline parse_error_t        parse_dumpvars();
-    inline parse_error_t        parse_module(scope *);
-    inline parse_error_t        parse_variable(const scope *);
-    inline expected_t<change_t> parse_change();
+    inline parse_error_t        parse_scope(scope_kind kind);
+    inline parse_error_t        parse_variable();
+    inline expected_t<change_view_t> parse_change();
+
+  private:
+    /// @brief forward to the handler's callback of the same name, if it has one
+    WAVER_FORCEINLINE void on_scope_begin(const scope_kind kind, const string_view_t name) {
+      if constexpr (requires { handler.on_scope_begin(kind, name); })
+        handler.on_scope_begin(kind, name);
+    }
+    WAVER_FORCEINLINE void on_scope_end() {
+      if constexpr (requires { handler.on_scope_end(); })
+        handler.on_scope_end();
+    }
+    WAVER_FORCEINLINE void on_var(const var_view &var) {
+      if constexpr (requires { handler.on_var(var); })
+        handler.on_var(var);
+    }
+    WAVER_FORCEINLINE void on_time(const timestamp::time_t time) {
+      if constexpr (requires { handler.on_time(time); })
+        handler.on_time(time);
+    }
+    WAVER_FORCEINLINE void on_dump_begin(const string_view_t keyword) {
+      if constexpr (requires { handler.on_dump_begin(keyword); })
+        handler.on_dump_begin(keyword);
+    }
+    WAVER_FORCEINLINE void on_dump_end(const string_view_t keyword) {
+      if constexpr (requires { handler.on_dump_end(keyword); })
+        handler.on_dump_end(keyword);
+    }
+    /// @return false if the handler rejects the change
+    WAVER_NODISCARD WAVER_FORCEINLINE bool on_change(const signal_id_t signal, const string_view_t value) {
+      if constexpr (requires {
+                      { handler.on_change(signal, value) } -> std::convertible_to<bool>;
+                    })
+        return handler.on_change(signal, value);
+      else if constexpr (requires { handler.on_change(signal, value); })
+        handler.on_change(signal, value);
+      return true;
+    }
+    WAVER_FORCEINLINE void on_end() {
+      if constexpr (requires { handler.on_end(); })
+        handler.on_end();
+    }
 
   private:
-    value_type   &vcd;
-    lexer_t       lexer;
-    string_view_t token;
+    /// @brief the offset just past the `$enddefinitions $end` of `source`, or npos if there is none
+    WAVER_NODISCARD inline static size_type find_body(string_view_t source) noexcept;
+    /// @brief split `body` into at most `count` slices, each starting at a `#` timestamp at the beginning of a line
+    WAVER_NODISCARD inline static std::vector<string_view_t> split_body(string_view_t body, size_type count,
+                                                                        size_type min_size);
+    /// @brief add to the counters of a phase, if there are stats to record
+    inline void record(const parse_stats::phase which, const size_type bytes, const size_type tokens = 0,
+                       const size_type changes = 0) const noexcept {
+      if (not options.stats)
+        return;
+      auto &counters = (*options.stats)[which];
+      counters.bytes += bytes;
+      counters.tokens += tokens;
+      counters.changes += changes;
+    }
+    /// @brief whether the changes of `signal` are recorded, see parse_options::filter
+    WAVER_NODISCARD WAVER_FORCEINLINE bool is_selected(const signal_id_t signal) const noexcept {
+      return selected.empty() or selected[signal];
+    }
+
+  private:
+    Handler handler;
+    /// @brief where the declarations are interned, null in a worker of the parallel parser, which sees none
+    signal_table       *declared = nullptr;
+    const signal_table &signals;
+    parse_options       options;
+    lexer_t             lexer;
+    token_t             token;
+    /// @brief the names of the scopes enclosing the current declaration, outermost first; copied, a streaming lexer
+    ///        does not keep them
+    std::vector<string_t> scope_path;
+    /// @brief signal id -> selected, empty if the filter selects everything
+    std::vector<bool> selected;
+    /// @brief the `$dumpall`, `$dumpon` or `$dumpoff` whose `$end` has not been met yet, kEof if none
+    token_kind open_block = token_kind::kEof;
   };
 
 public:
-  using json_t        = nlohmann::json;
-  using parser_t      = net::ancillarycat::waver::value_change_dump::parser;
-  using lexer_t       = net::ancillarycat::waver::lexer</* default templat arguments */>;
-  using path_t        = std::filesystem::path;
-  using string_t      = std::string;
-  using string_view_t = std::string_view;
-  using expected_t    = absl::StatusOr<value_change_dump>;
+  using json_t         = nlohmann::json;
+  using parser_t       = basic_parser<model_handler>;
+  using lexer_t        = net::ancillarycat::waver::lexer</* default templat arguments */>;
+  using path_t         = std::filesystem::path;
+  using string_t       = std::string;
+  using string_view_t  = std::string_view;
+  using expected_t     = absl::StatusOr<value_change_dump>;
+  using allocator_type = allocator_t;
 
 public:
-  inline explicit constexpr value_change_dump() = default;
+  /// @param allocator where the header, the dumpvars and the value changes are allocated, see allocator_t
+  inline explicit value_change_dump(const allocator_type &allocator = {}) :
+      header(allocator), dumpvars(allocator), value_changes(allocator) {}
 
-  inline constexpr value_change_dump(const value_change_dump &);
-  inline           value_change_dump(value_change_dump &&) noexcept;
+  inline value_change_dump(const value_change_dump &, const allocator_type &allocator = {});
+  inline value_change_dump(value_change_dump &&) noexcept;
+  inline value_change_dump(value_change_dump &&, const allocator_type &allocator);
 
   inline value_change_dump           &operator=(value_change_dump &&) noexcept;
   inline constexpr value_change_dump &operator=(const value_change_dump &rhs) = default;
@@ -128,19 +429,87 @@ public:
 
 public:
   /// @brief parse the VCD file
-  /// @param source the path to the file
+  /// @param source the path to the file, or the contents of the file
+  /// @param options see parse_options
   /// @return OkStatus() if successful, various errors otherwise
-  WAVER_NODISCARD inline static expected_t parse(auto &&source)
+  WAVER_NODISCARD inline static expected_t parse(auto &&source, const parse_options &options = {})
     requires std::same_as<std::remove_cvref_t<decltype(source)>, path_t> or
     std::same_as<std::remove_cvref_t<decltype(source)>, string_t>
   {
-    auto vcd    = value_change_dump{};
-    auto parser = parser_t{vcd};
-    if (auto res = parser.load(std::forward<std::remove_cvref_t<decltype(source)>>(source)); res != OkStatus())
-      return {res};
-    if (auto res = parser.parse(); res != OkStatus())
-      return {res};
-    return {vcd};
+    using source_t = std::remove_cvref_t<decltype(source)>;
+    try {
+      if constexpr (std::same_as<source_t, path_t>)
+        if (options.cache and options.filter.empty())
+          return parse_cached(source, options);
+      auto vcd    = value_change_dump{options.allocator()};
+      auto parser = parser_t{vcd, options};
+      // an lvalue source is copied rather than moved from, the caller keeps its string
+      if (auto res = parser.load(source_t(std::forward<decltype(source)>(source))); res != OkStatus())
+        return {res};
+      if (auto res = parser.parse(); res != OkStatus())
+        return {res};
+      return {std::move(vcd)};
+    } catch (const std::bad_alloc &) {
+      return out_of_memory();
+    }
+  }
+
+  /// @brief parse the VCD file, reporting what it contains to `handler` instead of building a value_change_dump
+  /// @param source the path to the file, or the contents of the file
+  /// @param handler see parse_handler; its callbacks are called directly and can be inlined into the parse loop
+  /// @param options see parse_options; the value changes are parsed by one thread, `cache` is ignored
+  /// @return OkStatus() if successful, various errors otherwise
+  /// @note the views handed to `handler` point into the input, copy what has to outlive the call. With
+  ///       `options.streaming` nothing but the handler's own state grows with the length of the dump.
+  template <parse_handler Handler>
+  WAVER_NODISCARD inline static Status parse(auto &&source, Handler &handler, const parse_options &options = {})
+    requires std::same_as<std::remove_cvref_t<decltype(source)>, path_t> or
+    std::same_as<std::remove_cvref_t<decltype(source)>, string_t>
+  {
+    using source_t = std::remove_cvref_t<decltype(source)>;
+    try {
+      auto signals = signal_table{options.allocator()};
+      auto parser  = basic_parser<Handler &>{handler, signals, options};
+      if (auto res = parser.load(source_t(std::forward<decltype(source)>(source))); res != OkStatus())
+        return res;
+      return parser.parse();
+    } catch (const std::bad_alloc &) {
+      return out_of_memory();
+    }
+  }
+
+  /// @brief parse the header of the VCD file and only the value changes within `range`
+  /// @param path the path to the file
+  /// @param range the times to keep; the state just before `range.first` becomes the `$dumpvars` of the result
+  /// @param options see parse_options; `streaming` is ignored
+  /// @return OkStatus() if successful, various errors otherwise
+  /// @note a seek index (see seek_index) is built on the first call and stored next to the file, later calls
+  ///       only parse from the nearest full state before `range.first` up to `range.last`.
+  WAVER_NODISCARD inline static expected_t parse(const path_t &path, const time_range &range,
+                                                 parse_options options = {}) {
+    options.streaming = false;
+    try {
+      auto vcd    = value_change_dump{options.allocator()};
+      auto parser = parser_t{vcd, options};
+      if (auto res = parser.load(path); res != OkStatus())
+        return {res};
+      if (auto res = parser.parse(path, range); res != OkStatus())
+        return {res};
+      return {std::move(vcd)};
+    } catch (const std::bad_alloc &) {
+      return out_of_memory();
+    }
+  }
+
+  /// @brief parse the VCD file lazily, yielding each change instead of building value_changes
+  /// @param source the path to the file, or the contents of the file
+  /// @param options see parse_options; the input is always streamed, `threads` and `cache` are ignored
+  /// @return see stream_item; memory stays bounded by the window size however long the dump is, and destroying the
+  ///         generator early stops the parse
+  template <typename Source>
+    requires std::same_as<Source, path_t> or std::same_as<Source, string_t>
+  WAVER_NODISCARD inline static generator<stream_item> stream(Source source, parse_options options = {}) {
+    return parser_t::stream(std::move(source), std::move(options));
   }
 
 public:
@@ -154,10 +523,45 @@ public:
   /// @param vcd the value change dump to serialize
   friend void to_json(json_t &j, const value_change_dump &vcd) {
     to_json(j, vcd.header);
-    to_json(j, vcd.dumpvars);
-    to_json(j, vcd.value_changes);
+    to_json(j, vcd.dumpvars, vcd.header.signals);
+    to_json(j, vcd.value_changes, vcd.header.signals);
+  }
+
+  /// @brief serialize straight to `output`, with the same schema as as_json() but without building a DOM
+  /// @param output the stream to write to
+  /// @param indent spaces per nesting level; negative for compact output
+  inline void write_json(std::ostream &output, int indent = -1) const;
+
+public:
+  /// @brief build an index answering value-at-time queries over this dump
+  /// @param interval events between two checkpoints, see value_index
+  /// @note the index refers to this dump, which must outlive it and stay unmodified
+  WAVER_NODISCARD inline value_index index(const std::size_t interval = value_index::default_interval) const {
+    return value_index{value_changes, dumpvars, header.signals, interval};
+  }
+
+  /// @brief look up a signal by its hierarchical name, e.g. `TOP.ALU4.out`
+  /// @return the signal id, or invalid_signal_id if no port has that name
+  /// @note walks the scopes; for many lookups, or prefix and glob searches, build a names() index once
+  WAVER_NODISCARD inline signal_id_t find_signal(string_view_t path) const;
+
+  /// @brief build an index of the hierarchical names of all signals, see name_index
+  WAVER_NODISCARD inline name_index names(const allocator_type &allocator = {}) const {
+    return name_index{header.scopes, allocator};
   }
 
+  WAVER_NODISCARD inline allocator_type get_allocator() const noexcept { return value_changes.get_allocator(); }
+
+private:
+  /// @brief the status of a parse whose allocator, e.g. a capped arena, ran out
+  WAVER_NODISCARD inline static Status out_of_memory() {
+    return absl::ResourceExhaustedError("Ran out of memory while building the dump");
+  }
+  /// @brief write every scope, nested as in the hierarchy
+  inline void write_json(json_writer &writer, const scope_table &scopes) const;
+  /// @brief parse through `options.cache`, defined in parse_cache.hpp
+  WAVER_NODISCARD inline static expected_t parse_cached(const path_t &path, parse_options options);
+
 public:
   /// @brief Represents the header of the VCD file
   header header;
@@ -171,16 +575,13 @@ public:
 ///				 Implementation
 //////////////////////////////////////////////////////////////////////////////
 namespace net::ancillarycat::waver {
-inline constexpr value_change_dump::value_change_dump(const value_change_dump &rhs) {
-  header        = rhs.header;
-  dumpvars      = rhs.dumpvars;
-  value_changes = rhs.value_changes;
-}
-inline value_change_dump::value_change_dump(value_change_dump &&rhs) noexcept {
-  header        = std::move(rhs.header);
-  dumpvars      = std::move(rhs.dumpvars);
-  value_changes = std::move(rhs.value_changes);
-}
+inline value_change_dump::value_change_dump(const value_change_dump &rhs, const allocator_type &allocator) :
+    header(rhs.header, allocator), dumpvars(rhs.dumpvars, allocator), value_changes(rhs.value_changes, allocator) {}
+inline value_change_dump::value_change_dump(value_change_dump &&rhs) noexcept :
+    header(std::move(rhs.header)), dumpvars(std::move(rhs.dumpvars)), value_changes(std::move(rhs.value_changes)) {}
+inline value_change_dump::value_change_dump(value_change_dump &&rhs, const allocator_type &allocator) :
+    header(std::move(rhs.header), allocator), dumpvars(std::move(rhs.dumpvars), allocator),
+    value_changes(std::move(rhs.value_changes), allocator) {}
 inline value_change_dump &value_change_dump::operator=(value_change_dump &&rhs) noexcept {
   header        = std::move(rhs.header);
   dumpvars      = std::move(rhs.dumpvars);
@@ -188,8 +589,92 @@ inline value_change_dump &value_change_dump::operator=(value_change_dump &&rhs)
   return *this;
 }
 
+inline void value_change_dump::write_json(std::ostream &output, const int indent) const {
+  const auto &signals = header.signals;
+  auto        writer  = json_writer{output, indent};
+  auto        value   = string_t{};
+  writer.begin_object();
+
+  writer.key("scopes").begin_array();
+  write_json(writer, header.scopes);
+  writer.end_array();
+  writer.key("version").value(header.version.description);
+  if (not header.date.time_point.empty())
+    writer.key("date").value(header.date.time_point);
+  if (not header.timescale.time.empty())
+    writer.key("timescale").value(header.timescale.time);
+
+  writer.key("dumpvars").begin_array().begin_array();
+  for (const auto &[signal, change] : dumpvars.changes)
+    writer.begin_array().value(signals.code(signal)).value(change.to_string()).end_array();
+  writer.end_array().end_array();
+
+  writer.key("value_changes").begin_object();
+  // a time the dump repeats is one key, and so is a signal changing twice at one time, with its last value, as in
+  // to_json(); the timestamps are in time order, so the repeats of a time are adjacent
+  auto latest  = std::vector<const change_event *>(signals.size());
+  auto changed = std::vector<signal_id_t>{};
+  for (std::size_t first = 0, next = 0; first < value_changes.size(); first = next) {
+    const auto time = value_changes[first].time;
+    for (; next < value_changes.size() and value_changes[next].time == time; ++next)
+      for (const auto &event : value_changes[next].changes) {
+        if (not latest[event.signal])
+          changed.emplace_back(event.signal);
+        latest[event.signal] = &event;
+      }
+    char       digits[24];
+    const auto [end, _] = std::to_chars(digits, digits + sizeof digits, time);
+    writer.key({digits, end}).begin_object();
+    for (const auto signal : changed) {
+      value.clear();
+      value_changes.format(*std::exchange(latest[signal], nullptr), value);
+      writer.key(signals.code(signal)).value(value);
+    }
+    changed.clear();
+    writer.end_object();
+  }
+  writer.end_object();
+
+  writer.end_object();
+}
+
+inline signal_id_t value_change_dump::find_signal(const string_view_t path) const {
+  const auto *const port = header.scopes.find_port(path);
+  return port ? port->signal : invalid_signal_id;
+}
 
-enum WAVER_NODISCARD value_change_dump::parser::parse_error : std::uint8_t {
+inline void value_change_dump::write_json(json_writer &writer, const scope_table &scopes) const {
+  // the ends of the subtrees being written, innermost last
+  auto open = std::vector<scope_table::index_t>{};
+  for (scope_table::index_t index = 0; index < scopes.size(); ++index) {
+    for (; not open.empty() and open.back() == index; open.pop_back())
+      writer.end_array().end_object();
+    writer.begin_object();
+    writer.key("type").value(scope_table::name_of(scopes.kind(index)));
+    if (scopes.kind(index) == scope_kind::kUnknown)
+      writer.key("data").null();
+    else {
+      writer.key("data").begin_object().key("ports").begin_object();
+      for (const auto &port : scopes.ports(index)) {
+        writer.key(port.name).begin_object();
+        writer.key("type").value(std::to_underlying(port.type));
+        writer.key("width").value(port.width);
+        writer.key("identifier").value(header.signals.code(port.signal));
+        writer.key("reference").value(port.reference);
+        writer.end_object();
+      }
+      writer.end_object().end_object();
+    }
+    writer.key("name").value(scopes.name(index));
+    writer.key("subscopes").begin_array();
+    open.emplace_back(scopes.end(index));
+  }
+  for (; not open.empty(); open.pop_back())
+    writer.end_array().end_object();
+}
+
+
+enum WAVER_NODISCARD value_change_dump::parse_error : std::uint8_t {
   // success
   kSuccess = 0,
   // unrecoverable errors
@@ -200,124 +685,349 @@ enum WAVER_NODISCARD value_change_dump::parser::parse_error : std::uint8_t {
   // recoverable errors
   kInvalidSignalType,
   kInvalidTimestamp,
+  kUnknownIdentifier,
+  kInvalidValue,
   // unknown error
   kUnknown = std::numeric_limits<std::uint8_t>::max(),
 };
-inline Status value_change_dump::parser::parse() {
-  if (const auto res = lexer.lex(); res != OkStatus())
+template <typename Handler>
+inline Status value_change_dump::basic_parser<Handler>::parse() {
+  // only the model can be assembled from the slices of several workers
+  const auto workers = builds_model ? options.concurrency() : size_type{1};
+  // with several workers, or the body_scanner, only the header is tokenized up front; the workers tokenize or scan
+  // their own slice of the body
+  const auto scanned     = options.byte_scanner and not lexer.view().empty();
+  const auto body_offset = workers > 1 or scanned ? find_body(lexer.view()) : string_view_t::npos;
+  if (const auto res = parse_definitions(body_offset); res != OkStatus())
+    // a truncated or corrupted compressed input is the more useful error
+    return lexer.stream_status().ok() ? res : lexer.stream_status();
+
+  WAVER_STATS(auto body_timer = parse_stats::timer{options.stats, parse_stats::kBody};
+              const auto tokens_before = lexer.tokens_produced();
+              const auto bytes_before  = lexer.bytes_tokenized();)
+  auto res = parse_error_t::kSuccess;
+  if constexpr (builds_model)
+    res = body_offset == string_view_t::npos ? parse_body() : parse_body(lexer.view().substr(body_offset), workers);
+  else if (body_offset == string_view_t::npos)
+    res = parse_body();
+  else {
+    WAVER_STATS(record(parse_stats::kBody, lexer.view().size() - body_offset);)
+    res = scan_body(lexer.view().substr(body_offset));
+  }
+  // a stream is read while it is lexed, so what load() read of it is only known now
+  WAVER_STATS(record(parse_stats::kLoad, lexer.bytes_read());)
+  if (auto status = lexer.stream_status(); not status.ok())
+    return status;
+  if (res != parse_error_t::kSuccess)
+    return InvalidArgumentError("Failed to parse body at token" + std::string(token.text()));
+  WAVER_STATS(body_timer.stop(); if constexpr (builds_model) record(
+                parse_stats::kBody, lexer.bytes_tokenized() - bytes_before, lexer.tokens_produced() - tokens_before,
+                handler.vcd.value_changes.event_count() + handler.vcd.dumpvars.changes.size());)
+
+  on_end();
+  return OkStatus();
+}
+
+template <typename Handler>
+inline Status
+value_change_dump::basic_parser<Handler>::parse(const std::filesystem::path &dump, const time_range &range) {
+  if (lexer.view().empty())
+    return absl::UnimplementedError("A time-window parse needs random access, decompress " + dump.string() + " first");
+  auto index = seek_index::load(seek_index::sidecar_path(dump), dump, options.seek_interval);
+  if (not index.ok()) {
+    const auto body_offset = find_body(lexer.view());
+    if (body_offset == string_view_t::npos)
+      return InvalidArgumentError("No `$enddefinitions $end` in " + dump.string());
+    index = seek_index::scan(lexer.view(), body_offset, options.seek_interval);
+    // best effort, without a writable directory the next open scans again
+    (void)index->save(seek_index::sidecar_path(dump), dump);
+  }
+  return parse(*index, range);
+}
+
+template <typename Handler>
+inline Status value_change_dump::basic_parser<Handler>::parse(const seek_index &index, const time_range &range) {
+  if (const auto res = parse_definitions(index.body_offset()); res != OkStatus())
+    return res;
+
+  WAVER_STATS(auto body_timer = parse_stats::timer{options.stats, parse_stats::kBody};)
+  const auto [begin, end] = index.locate(range);
+  if (end > lexer.view().size())
+    return InvalidArgumentError("The seek index reaches past the end of the dump");
+  if (const auto res = parse_body(lexer.view().substr(begin, end - begin), options.concurrency());
+      res != parse_error_t::kSuccess) {
+    const auto where = token.text();
+    return InvalidArgumentError(
+      "Failed to parse the value changes of the window at token " + std::string(where) + " at byte " +
+      std::to_string(where.empty() ? begin : static_cast<size_type>(where.data() - lexer.view().data())));
+  }
+
+  auto &vcd = handler.vcd;
+  // the window starts at a full state; everything before the first time becomes the initial state
+  auto initial = std::vector<std::optional<ports_value_t>>(signals.size());
+  for (auto &[signal, value] : vcd.dumpvars.changes)
+    initial[signal] = std::move(value);
+  for (const auto timestamp : vcd.value_changes.timestamps())
+    if (timestamp.time < range.first)
+      for (const auto &event : timestamp.changes)
+        initial[event.signal] = vcd.value_changes.value(event);
+  vcd.dumpvars.changes.clear();
+  for (signal_id_t signal = 0; signal < initial.size(); ++signal)
+    if (initial[signal])
+      vcd.dumpvars.changes.emplace_back(signal, std::move(*initial[signal]));
+  vcd.value_changes = vcd.value_changes.window(range.first, range.last);
+  // parse_body() has recorded the bytes
+  WAVER_STATS(body_timer.stop(); record(parse_stats::kBody, 0, 0, vcd.value_changes.event_count());)
+  return OkStatus();
+}
+
+template <typename Handler>
+template <typename Source>
+inline generator<stream_item> value_change_dump::basic_parser<Handler>::stream(Source source, parse_options options) {
+  auto  vcd    = value_change_dump{options.allocator()};
+  auto  parser = basic_parser{vcd, std::move(options)};
+  auto &lexer  = parser.lexer;
+  auto &token  = parser.token;
+
+  auto res = OkStatus();
+  if constexpr (std::same_as<Source, std::filesystem::path>)
+    res = lexer.load_stream(source, parser.options.window_size);
+  else
+    // windows of a string in memory still bound the tokens held at a time
+    res = lexer.load_stream(
+      [content = std::move(source), offset = size_type{0}](char *buffer, const size_type size) mutable {
+        const auto count = std::min(size, content.size() - offset);
+        std::ranges::copy(std::string_view{content}.substr(offset, count), buffer);
+        offset += count;
+        return count;
+      },
+      parser.options.window_size);
+  if (res.ok())
+    res = parser.parse_definitions(string_view_t::npos);
+  if (not res.ok()) {
+    co_yield stream_item{lexer.stream_status().ok() ? std::move(res) : lexer.stream_status()};
+    co_return;
+  }
+  co_yield stream_item{static_cast<const value_change_dump *>(&vcd)};
+
+  auto time     = timestamp::time_t{0};
+  auto timed    = false; // whether a timestamp has been met
+  auto in_block = false; // whether the cursor is inside `$dumpvars`, `$dumpall`, `$dumpon` or `$dumpoff`
+  for (token = lexer.current(); not token.is(token_kind::kEof); token = lexer.current()) {
+    switch (token.kind()) {
+    case token_kind::kTime: {
+      const auto text = token.text();
+      if (const auto [_, ec] = std::from_chars(text.data() + 1, text.data() + text.size(), time); ec != std::errc()) {
+        co_yield stream_item{InvalidArgumentError("Invalid timestamp " + string_t{text})};
+        co_return;
+      }
+      timed = true;
+      lexer.consume();
+      continue;
+    }
+    case token_kind::kComment:
+      if (parser.parse_comments() != parse_error_t::kSuccess) {
+        co_yield stream_item{InvalidArgumentError("Unterminated `$comment`")};
+        co_return;
+      }
+      continue;
+    case token_kind::kEnd:
+      in_block = false;
+      lexer.consume();
+      continue;
+    case token_kind::kWord:
+    case token_kind::kScalarChange:
+    case token_kind::kVectorChange:
+      break;
+    default:
+      // the changes these blocks enclose are yielded like any other
+      in_block = true;
+      lexer.consume();
+      continue;
+    }
+    if (not timed and not in_block) {
+      co_yield stream_item{
+        InvalidArgumentError("A value change before the first timestamp: " + string_t{token.text()})};
+      co_return;
+    }
+    const auto change = parser.parse_change();
+    if (not change) {
+      co_yield stream_item{InvalidArgumentError("Failed to parse a value change at #" + std::to_string(time))};
+      co_return;
+    }
+    if (parser.is_selected(change->first))
+      co_yield stream_item{change_view{time, change->first, change->second}};
+  }
+  if (auto status = lexer.stream_status(); not status.ok())
+    co_yield stream_item{std::move(status)};
+}
+
+template <typename Handler>
+inline Status value_change_dump::basic_parser<Handler>::parse_definitions(const size_type body_offset) {
+  WAVER_STATS(auto lex_timer = parse_stats::timer{options.stats, parse_stats::kLex};)
+  if (const auto res = lexer.lex(body_offset); res != OkStatus())
     return res;
   if (lexer.is_empty())
     return NotFoundError("no tokens to parse");
+  WAVER_STATS(lex_timer.stop(); record(parse_stats::kLex, lexer.bytes_tokenized(), lexer.tokens_produced());)
   // we have a bunch of tokens, now we can parse them
+  WAVER_STATS(auto header_timer = parse_stats::timer{options.stats, parse_stats::kHeader};)
   token = lexer.front();
   if (const auto res = parse_header(); res != parse_error_t::kSuccess)
-    return InvalidArgumentError("Failed to parse header" + std::string(token.begin(), token.end()));
+    return InvalidArgumentError("Failed to parse header" + std::string(token.text()));
+  WAVER_STATS(header_timer.stop();)
 
   // token was at `$enddefinitions`, so does lexer.current(); call
   // lexer.consume() should also yield `$enddefinitions`
   lexer.consume(2);
   // token was at `$end` now
   token = lexer.current(); // token should be the first token after `$end`
-  // auto _ = parse_body();
-  if (const auto res = parse_body(); res != parse_error_t::kSuccess)
-    return InvalidArgumentError("Failed to parse body at token" + std::string(token.begin(), token.end()));
-
   return OkStatus();
 }
 
-inline value_change_dump::parser::parse_error_t value_change_dump::parser::parse_dumpvars() {
-  WAVER_PRECONDITION(token == keywords::$dumpvars);
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::parse_dumpvars() -> parse_error_t {
+  WAVER_PRECONDITION(token.is(token_kind::kDumpvars));
 
-  lexer.consume(2); // consume $dumpvars
-  for (token = lexer.current(); token != keywords::$end; token = lexer.current()) {
+  lexer.consume(); // consume $dumpvars
+  on_dump_begin(keywords::$dumpvars);
+  for (token = lexer.current(); not token.is(token_kind::kEnd); token = lexer.current()) {
+    if (token.is(token_kind::kEof))
+      return parse_error_t::kUnexpectedEndOfFile;
     auto maybe_change = parse_change();
     if (not maybe_change)
       return maybe_change.error();
-    vcd.dumpvars.changes.emplace_back(std::move(*maybe_change));
+    const auto [signal, value] = *maybe_change;
+    if (not is_selected(signal))
+      continue;
+    if (not on_change(signal, value))
+      return parse_error_t::kInvalidValue;
   }
-  return kSuccess;
+  lexer.consume(); // consume $end
+  on_dump_end(keywords::$dumpvars);
+  return parse_error_t::kSuccess;
 }
-inline auto value_change_dump::parser::parse_change()
-  -> std::expected<change_t, value_change_dump::parser::parse_error_t> {
-
-  if (token.size() == 2)
-    // means it's a one-bit signal
-    return change_t{identifier_t{token.back()}, ports_value_t{token.front()}};
-
-  // it's a multi-bit signal
-  ports_value_t value = {token.begin(), token.end()};
-  if (token = lexer.consume(); token == empty_sv)
-    return std::unexpected(parse_error_t::kUnexpectedEndOfFile);
-  token                   = lexer.current();
-  identifier_t identifier = {token.begin(), token.end()};
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::parse_change() -> expected_t<change_view_t> {
+  WAVER_PRECONDITION(not token.is(token_kind::kEof));
 
+  auto value = token.text();
+  auto code  = string_view_t{};
+  if (token.is(token_kind::kScalarChange)) {
+    // a scalar change, the value is immediately followed by the identifier code
+    code  = value.substr(1);
+    value = value.substr(0, 1);
+  } else {
+    // a vector (`b`), real (`r`) or string (`s`) change, the identifier code is the next token
+    lexer.consume();
+    if (token = lexer.current(); token.is(token_kind::kEof))
+      return std::unexpected(parse_error_t::kUnexpectedEndOfFile);
+    code = token.text();
+  }
+  lexer.consume();
 
-  return change_t{identifier, value};
+  const auto signal = signals.find(code);
+  if (signal == invalid_signal_id)
+    return std::unexpected(parse_error_t::kUnknownIdentifier);
+  return change_view_t{signal, value};
 }
-inline value_change_dump::parser::parse_error_t value_change_dump::parser::parse_value_changes() {
-  for (/*token = lexer.current()*/; token != lexer.back(); token = lexer.current()) {
-    if (token.starts_with('#')) {
-      timestamp timestamp;
-      if (const auto [_, ec] = std::from_chars(token.data() + 1, token.data() + token.size(), timestamp.time);
-          ec != std::errc())
-        return parse_error_t::kInvalidTimestamp;
-
-      token = lexer.consume(2);
-      for (token = lexer.current(); token != lexer.back() && not token.starts_with('#'); token = lexer.current()) {
-        auto maybe_change = parse_change();
-        if (not maybe_change)
-          return maybe_change.error();
-        timestamp.changes.insert(std::move(*maybe_change));
-
-        token = lexer.consume();
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::parse_value_changes() -> parse_error_t {
+  for (/*token = lexer.current()*/; not token.is(token_kind::kEof); token = lexer.current()) {
+    if (not token.is(token_kind::kTime))
+      return parse_error_t::kInvalidTimestamp;
+    const auto text = token.text();
+    auto       time = timestamp::time_t{};
+    if (const auto [_, ec] = std::from_chars(text.data() + 1, text.data() + text.size(), time); ec != std::errc())
+      return parse_error_t::kInvalidTimestamp;
+    on_time(time);
+
+    lexer.consume(); // consume the timestamp
+    for (token = lexer.current(); not token.is(token_kind::kEof) and not token.is(token_kind::kTime);
+         token = lexer.current()) {
+      switch (token.kind()) {
+      case token_kind::kScalarChange:
+      case token_kind::kVectorChange:
+      case token_kind::kWord:
+        break;
+      case token_kind::kDumpvars:
+        if (const auto res = parse_dumpvars(); res != parse_error_t::kSuccess)
+          return res;
+        continue;
+      case token_kind::kComment:
+        if (const auto res = parse_comments(); res != parse_error_t::kSuccess)
+          return res;
+        continue;
+      // $dumpall, $dumpon, $dumpoff and their $end; the changes they enclose are recorded as usual
+      case token_kind::kDumpall:
+      case token_kind::kDumpon:
+      case token_kind::kDumpoff:
+        open_block = token.kind();
+        on_dump_begin(keyword_table::text(open_block));
+        lexer.consume();
+        continue;
+      case token_kind::kEnd:
+        if (open_block != token_kind::kEof)
+          on_dump_end(keyword_table::text(std::exchange(open_block, token_kind::kEof)));
+        [[fallthrough]];
+      default:
+        // any other keyword is skipped
+        lexer.consume();
+        continue;
       }
-      vcd.value_changes.timestamps.emplace_back(std::move(timestamp));
+      const auto maybe_change = parse_change();
+      if (not maybe_change)
+        return maybe_change.error();
+      const auto [signal, value] = *maybe_change;
+      if (not is_selected(signal))
+        continue;
+      if (not on_change(signal, value))
+        return parse_error_t::kInvalidValue;
     }
   }
   return parse_error_t::kSuccess;
 }
-inline value_change_dump::parser::parse_error_t value_change_dump::parser::parse_header() {
-  WAVER_PRECONDITION(lexer.current() == lexer.front());
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::parse_header() -> parse_error_t {
+  WAVER_PRECONDITION(lexer.current().text() == lexer.front().text());
 
-  for (/*token = lexer.front()*/; token != keywords::$enddefinitions; token = lexer.current()) {
-    if (token == keywords::$version) {
-      if (auto res = parse_version(); res != parse_error_t::kSuccess)
-        return res;
-      else
-        continue;
-    }
-    if (token == keywords::$comment) {
-      if (auto res = parse_comments(); res != parse_error_t::kSuccess)
-        return res;
-      else
-        continue;
-    }
-    if (token == keywords::$timescale) {
-      if (auto res = parse_timescale(); res != parse_error_t::kSuccess)
-        return res;
-      else
-        continue;
-    }
-    if (token == keywords::$scope) {
-      if (auto res = parse_scope_fwd(nullptr); res != parse_error_t::kSuccess)
-        return res;
-      else
-        continue;
+  for (/*token = lexer.front()*/; not token.is(token_kind::kEnddefinitions); token = lexer.current()) {
+    auto res = parse_error_t::kSuccess;
+    switch (token.kind()) {
+    case token_kind::kVersion:
+    case token_kind::kDate:
+      res = parse_version();
+      break;
+    case token_kind::kComment:
+      res = parse_comments();
+      break;
+    case token_kind::kTimescale:
+      res = parse_timescale();
+      break;
+    case token_kind::kScope:
+      res = parse_scope_fwd();
+      break;
+    case token_kind::kEof:
+      return parse_error_t::kUnexpectedEndOfFile;
+    default:
+      return parse_error_t::kUnknownKeyword;
     }
-    std::println("token: {}", token);
+    if (res != parse_error_t::kSuccess)
+      return res;
   }
-  WAVER_POSTCONDITION(lexer.current() == keywords::$enddefinitions);
+  WAVER_POSTCONDITION(lexer.current().is(token_kind::kEnddefinitions));
   return parse_error_t::kSuccess;
 }
-inline value_change_dump::parser::parse_error_t value_change_dump::parser::parse_version() {
-  WAVER_PRECONDITION(token == keywords::$version);
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::parse_version() -> parse_error_t {
+  WAVER_PRECONDITION(token.is(token_kind::kVersion) or token.is(token_kind::kDate));
 
-  lexer.consume(); // consume $version
+  lexer.consume(); // consume $version, or $date, whose text is skipped alike
 
   // currently do nothing but consume the token
   token = lexer.consume();
-  while (token != lexer.back())
-    if (token == keywords::$end)
+  while (not token.is(token_kind::kEof))
+    if (token.is(token_kind::kEnd))
       return parse_error_t::kSuccess; // cursor has passed the `$end`, i.e.,
                                       // now the cursor is the one after the
                                       // `$end`
@@ -325,15 +1035,16 @@ inline value_change_dump::parser::parse_error_t value_change_dump::parser::parse
       token = lexer.consume();
   return parse_error_t::kUnexpectedEndOfFile;
 }
-inline value_change_dump::parser::parse_error_t value_change_dump::parser::parse_comments() {
-  WAVER_PRECONDITION(token == keywords::$comment);
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::parse_comments() -> parse_error_t {
+  WAVER_PRECONDITION(token.is(token_kind::kComment));
 
   lexer.consume(); // consume $comment
 
   // currently do nothing but consume the token
   token = lexer.consume();
-  while (token != lexer.back())
-    if (token == keywords::$end)
+  while (not token.is(token_kind::kEof))
+    if (token.is(token_kind::kEnd))
       return parse_error_t::kSuccess; // cursor has passed the `$end`, i.e.,
                                       // now the cursor is the one after the
                                       // `$end`
@@ -341,15 +1052,16 @@ inline value_change_dump::parser::parse_error_t value_change_dump::parser::parse
       token = lexer.consume();
   return parse_error_t::kUnexpectedEndOfFile;
 }
-inline value_change_dump::parser::parse_error_t value_change_dump::parser::parse_timescale() {
-  WAVER_PRECONDITION(token == keywords::$timescale);
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::parse_timescale() -> parse_error_t {
+  WAVER_PRECONDITION(token.is(token_kind::kTimescale));
 
   lexer.consume(); // consume $timescale
 
   // currently do nothing but consume the token
   token = lexer.consume();
-  while (token != lexer.back()) {
-    if (token == keywords::$end)
+  while (not token.is(token_kind::kEof)) {
+    if (token.is(token_kind::kEnd))
       return parse_error_t::kSuccess; // cursor has passed the `$end`, i.e.,
                                       // now the cursor is the one after the
                                       // `$end`
@@ -357,142 +1069,329 @@ inline value_change_dump::parser::parse_error_t value_change_dump::parser::parse
   }
   return parse_error_t::kUnexpectedEndOfFile;
 }
-inline value_change_dump::parser::parse_error_t
-value_change_dump::parser::parse_scope_fwd(scope *parent) { // NOLINT(misc-no-recursion)
-  WAVER_PRECONDITION(token == keywords::$scope);
-
-  auto current_scope = std::make_shared<scope>();
-  if (parent == nullptr) {
-    current_scope = vcd.header.scopes.emplace_back(new scope{});
-  }
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::parse_scope_fwd() -> parse_error_t { // NOLINT(misc-no-recursion)
+  WAVER_PRECONDITION(token.is(token_kind::kScope));
 
   lexer.consume(); // consume $scope
 
-  // currently do nothing but consume the token
   token = lexer.current();
-  while (token != lexer.back()) {
-    if (token == keywords::$upscope) {
-      lexer.consume();
-      token = lexer.consume();
-      if (token = lexer.consume(); token != keywords::$end)
-        return parse_error_t::kUnknownKeyword;
-      if (parent)
-        parent->subscopes.emplace_back(std::move(current_scope));
-      else
-        vcd.header.scopes.emplace_back(std::move(current_scope));
-      return parse_error_t::kSuccess;
-    }
-    if (token == keywords::module) {
-      if (auto res = parse_module(current_scope.get()); res != parse_error_t::kSuccess)
-        return res;
-      if (parent)
-        parent->subscopes.emplace_back(std::move(current_scope));
-      // else // already added in the upper lines
-      // 	vcd.header.scopes.emplace_back(std::move(current_scope));
-      return parse_error_t::kSuccess;
-    }
+  if (token.is(token_kind::kEof))
+    return parse_error_t::kUnexpectedEndOfFile;
+  if (token.is(token_kind::kUpscope)) {
+    lexer.consume();
+    token = lexer.consume();
+    if (token = lexer.consume(); not token.is(token_kind::kEnd))
+      return parse_error_t::kUnknownKeyword;
+    // a scope of unknown kind, with neither a name nor a declaration
+    on_scope_begin(scope_kind::kUnknown, {});
+    on_scope_end();
+    return parse_error_t::kSuccess;
   }
-
-  return parse_error_t::kUnexpectedEndOfFile;
+  if (const auto kind = scope_table::kind_of(token.text()); kind != scope_kind::kUnknown)
+    return parse_scope(kind);
+  return parse_error_t::kInvalidScope;
 }
-inline value_change_dump::parser::parse_error_t
-value_change_dump::parser::parse_module(scope *current_scope) { // NOLINT(misc-no-recursion)
-  WAVER_PRECONDITION(token == keywords::module);
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::parse_scope(const scope_kind kind)
+  -> parse_error_t { // NOLINT(misc-no-recursion)
+  WAVER_PRECONDITION(scope_table::kind_of(token.text()) == kind);
 
-  lexer.consume(); // consume `module` keyword
-  token = lexer.consume(); // module name
-  // auto current_module = std::make_shared<module>();
+  lexer.consume(); // consume the kind, e.g. `module`
+  token = lexer.consume(); // scope name
 
-  if (token != lexer.back())
-    current_scope->name = {token.begin(), token.end()};
-  else
+  if (token.is(token_kind::kEof))
     return parse_error_t::kUnexpectedEndOfFile;
+  const auto name = token.text();
 
   token = lexer.consume();
-  if (token != keywords::$end)
+  if (not token.is(token_kind::kEnd))
     return parse_error_t::kInvalidScope;
 
-  current_scope->data = std::make_shared<module>();
+  on_scope_begin(kind, name);
+  scope_path.emplace_back(name);
 
-  for (token = lexer.current(); token != keywords::$upscope; token = lexer.current()) {
-    if (token == keywords::$var) {
-      if (auto res = parse_variable(current_scope); res != parse_error_t::kSuccess)
-        return res;
-    }
-    if (token == keywords::$scope) {
-      if (auto res = parse_scope_fwd(current_scope); res != parse_error_t::kSuccess)
-        return res;
+  for (token = lexer.current(); not token.is(token_kind::kUpscope); token = lexer.current()) {
+    auto res = parse_error_t::kSuccess;
+    switch (token.kind()) {
+    case token_kind::kVar:
+      res = parse_variable();
+      break;
+    case token_kind::kScope:
+      res = parse_scope_fwd();
+      break;
+    case token_kind::kComment:
+      res = parse_comments();
+      break;
+    case token_kind::kEof:
+      return parse_error_t::kUnexpectedEndOfFile;
+    default:
+      return parse_error_t::kInvalidScope;
     }
+    if (res != parse_error_t::kSuccess)
+      return res;
   }
   lexer.consume();
-  if (token = lexer.consume(); token != keywords::$end)
+  if (token = lexer.consume(); not token.is(token_kind::kEnd))
     return parse_error_t::kInvalidScope;
 
+  scope_path.pop_back();
+  on_scope_end();
   return parse_error_t::kSuccess;
 }
-inline value_change_dump::parser::parse_error_t value_change_dump::parser::parse_variable(const scope *current_scope) {
-  WAVER_PRECONDITION(token == keywords::$var);
-  WAVER_PRECONDITION(current_scope->data->get_type() == scope_value_base::scope_type::kModule);
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::parse_variable() -> parse_error_t {
+  WAVER_PRECONDITION(token.is(token_kind::kVar));
+  WAVER_PRECONDITION(declared != nullptr and not scope_path.empty());
 
   lexer.consume(); // consume $var
 
   token            = lexer.consume();
   auto signal_type = port::kUnknown;
-  if (token == "wire"sv)
+  if (token.text() == "wire"sv)
     signal_type = port::kWire;
-  else if (token == "reg"sv)
+  else if (token.text() == "reg"sv)
     signal_type = port::kRegistor;
   else
     return parse_error_t::kInvalidSignalType;
 
   token = lexer.consume();
   size_t signal_width;
-  if (const auto [_, ec] = std::from_chars(token.data(), token.data() + token.size(), signal_width); ec != std::errc())
+  if (const auto text = token.text();
+      std::from_chars(text.data(), text.data() + text.size(), signal_width).ec != std::errc())
     return parse_error_t::kInvalidSignalWidth;
 
   token = lexer.consume();
-  if (token.size() != 1)
-    return parse_error_t::kInvalidSignalWidth;
-  identifier_t identifier = {token[0]};
+  if (token.text().empty())
+    return parse_error_t::kUnexpectedEndOfFile;
+  // the same code declared in several scopes is the same signal
+  const auto code   = token.text();
+  const auto signal = declared->intern(code, signal_width);
 
-  token            = lexer.consume();
-  std::string name = {token.begin(), token.end()};
+  token           = lexer.consume();
+  const auto name = token.text();
+  if (not options.filter.empty()) {
+    auto path = string_t{};
+    for (const auto &scope_name : scope_path)
+      path.append(scope_name).push_back(signal_filter::separator);
+    path.append(name);
+    if (selected.size() <= signal)
+      selected.resize(signal + 1, false);
+    // an alias is selected if any of its names is
+    if (options.filter.matches(path))
+      selected[signal] = true;
+  }
+  // before the rest of the declaration is consumed, which may move a streaming lexer past the window of `name`
+  on_var({signal_type, signal_width, signal, code, name, /* reference */ {}});
 
   // bad implementation, need to be fixed
-  std::string reference;
-  for (; token != keywords::$end; token = lexer.consume()) {
+  for (; not token.is(token_kind::kEnd); token = lexer.consume()) {
+    if (token.is(token_kind::kEof))
+      return parse_error_t::kUnexpectedEndOfFile;
     // reference += token; // fixme
   }
-  std::dynamic_pointer_cast<module>(current_scope->data)
-    ->ports.emplace_back(signal_type, signal_width, std::move(identifier), std::move(name), std::move(reference));
   return parse_error_t::kSuccess; /// token should be the one after `$end`
 }
 
-inline value_change_dump::parser::parse_error_t value_change_dump::parser::parse_body() {
-  for (; token != lexer.back(); token = lexer.current()) {
-    if (token.starts_with('#')) {
-      // parse value changes
-      if (auto res = parse_value_changes(); res != parse_error_t::kSuccess)
-        return res;
-      else
-        (void)res; // temporary do nothing
-    } else if (token == keywords::$dumpvars) {
-      // parse dumpvars
-      if (auto res = parse_dumpvars(); res != parse_error_t::kSuccess)
-        return res;
-      else
-        (void)res;
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::parse_body() -> parse_error_t {
+  for (; not token.is(token_kind::kEof); token = lexer.current()) {
+    auto res = parse_error_t::kSuccess;
+    switch (token.kind()) {
+    case token_kind::kTime:
+      res = parse_value_changes();
+      break;
+    case token_kind::kDumpvars:
+      res = parse_dumpvars();
+      break;
+    case token_kind::kComment:
+      res = parse_comments();
+      break;
+    case token_kind::kWord:
+    case token_kind::kScalarChange:
+    case token_kind::kVectorChange:
+      // a value change before the first timestamp
+      return parse_error_t::kInvalidTimestamp;
+    default:
+      // $dumpall, $dumpon, $dumpoff, $end and any other keyword
+      lexer.consume();
+      continue;
+    }
+    if (res != parse_error_t::kSuccess)
+      return res;
+  }
+
+  return parse_error_t::kSuccess;
+}
+
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::parse_body(const string_view_t body, const size_type workers)
+  -> parse_error_t {
+  const auto chunks = split_body(body, workers, options.min_chunk_size);
+  if (options.byte_scanner and chunks.size() == 1) {
+    // a single slice is scanned into the dump directly, without a worker and its partial dump
+    WAVER_STATS(record(parse_stats::kBody, body.size());)
+    return scan_body(body);
+  }
+
+  auto partials = std::vector<value_change_dump>(chunks.size());
+  auto errors   = std::vector<parse_error_t>(chunks.size(), parse_error_t::kSuccess);
+  WAVER_STATS(auto lexed = std::vector<std::pair<size_type, size_type>>(chunks.size());)
+  // what a worker threw, rethrown on this thread once all have finished, e.g. a std::bad_alloc that parse() reports
+  auto thrown = std::vector<std::exception_ptr>(chunks.size());
+  // the token a worker stopped at, which points into `body`
+  auto stopped = std::vector<token_t>(chunks.size());
+  const auto run = [&](const size_type i) {
+    try {
+      auto worker = basic_parser{partials[i], signals, selected};
+      if (options.byte_scanner) {
+        errors[i]  = worker.scan_body(chunks[i]);
+        stopped[i] = worker.token;
+        WAVER_STATS(lexed[i] = {chunks[i].size(), 0};)
+        return;
+      }
+      if (worker.lexer.borrow(chunks[i]) != OkStatus() or worker.lexer.lex() != OkStatus())
+        return; // whitespace only
+      worker.token = worker.lexer.front();
+      errors[i]    = worker.parse_body();
+      stopped[i]   = worker.token;
+      WAVER_STATS(lexed[i] = {worker.lexer.bytes_tokenized(), worker.lexer.tokens_produced()};)
+    } catch (...) {
+      errors[i] = parse_error_t::kUnknown;
+      thrown[i] = std::current_exception();
     }
-    // else if (token == keywords::$dumpall) {
-    // 	// parse dumpall
-    // } else if (token == keywords::$dumpon) {
-    // 	// parse dumpon
-    // } else if (token == keywords::$dumpoff) {
-    // 	// parse dumpoff
-    // }
+  };
+  if (chunks.size() == 1)
+    run(0);
+  else {
+    auto threads = std::vector<std::jthread>{};
+    threads.reserve(chunks.size());
+    for (size_type i = 0; i < chunks.size(); ++i)
+      threads.emplace_back(run, i);
+  }
+  for (const auto &exception : thrown)
+    if (exception)
+      std::rethrow_exception(exception);
+  if (const auto error = std::ranges::find_if(errors, [](auto error) { return error != parse_error_t::kSuccess; });
+      error != errors.end()) {
+    token = stopped[static_cast<size_type>(error - errors.begin())];
+    return *error;
   }
+  WAVER_STATS(for (const auto [bytes, tokens] : lexed) record(parse_stats::kBody, bytes, tokens);)
 
+  // every slice starts at a timestamp and a `$dumpvars` block never contains one, so concatenating the slices in
+  // order yields exactly what the serial parser would have produced
+  auto &vcd = handler.vcd;
+  for (auto &partial : partials) {
+    std::ranges::move(partial.dumpvars.changes, std::back_inserter(vcd.dumpvars.changes));
+    vcd.value_changes.splice(std::move(partial.value_changes));
+  }
   return parse_error_t::kSuccess;
 }
 
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::scan_body(const string_view_t body) -> parse_error_t {
+  // forwards what the scanner meets to the handler, leaving out the changes the filter drops
+  struct visitor {
+    WAVER_FORCEINLINE void on_time(const timestamp::time_t time) { parser.on_time(time); }
+    WAVER_FORCEINLINE void on_dump_begin(const string_view_t keyword) { parser.on_dump_begin(keyword); }
+    WAVER_FORCEINLINE void on_dump_end(const string_view_t keyword) { parser.on_dump_end(keyword); }
+    WAVER_NODISCARD WAVER_FORCEINLINE bool on_change(const signal_id_t signal, const string_view_t value) {
+      return not parser.is_selected(signal) or parser.on_change(signal, value);
+    }
+    basic_parser &parser;
+  } forward{*this};
+
+  auto       scanner = body_scanner{signals};
+  const auto res     = scanner.scan(body, forward);
+  if (res == body_scanner::status::kSuccess)
+    return parse_error_t::kSuccess;
+  // where parse() reports the error
+  token = token_t{scanner.where()};
+  switch (res) {
+  case body_scanner::status::kInvalidTimestamp:
+    return parse_error_t::kInvalidTimestamp;
+  case body_scanner::status::kUnknownIdentifier:
+    return parse_error_t::kUnknownIdentifier;
+  case body_scanner::status::kUnexpectedEndOfFile:
+    return parse_error_t::kUnexpectedEndOfFile;
+  case body_scanner::status::kInvalidValue:
+    return parse_error_t::kInvalidValue;
+  default:
+    return parse_error_t::kUnknown;
+  }
+}
+
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::find_body(const string_view_t source) noexcept -> size_type {
+  auto in_comment     = false;
+  auto in_definitions = false;
+  for (auto begin = source.find_first_not_of(lexer_t::separators); begin != string_view_t::npos;
+       begin      = source.find_first_not_of(lexer_t::separators, begin)) {
+    const auto end   = std::min(source.find_first_of(lexer_t::separators, begin), source.size());
+    const auto token = source.substr(begin, end - begin);
+    begin            = end;
+    if (token == keywords::$end) {
+      if (in_definitions)
+        return end;
+      in_comment = false;
+    } else if (in_comment)
+      continue;
+    else if (token == keywords::$comment)
+      in_comment = true;
+    else if (token == keywords::$enddefinitions)
+      in_definitions = true;
+  }
+  return string_view_t::npos;
+}
+
+template <typename Handler>
+inline auto value_change_dump::basic_parser<Handler>::split_body(const string_view_t body, const size_type count,
+                                                                 const size_type     min_size)
+  -> std::vector<string_view_t> {
+  WAVER_PRECONDITION(count > 0);
+
+  const auto chunk_size = std::max(body.size() / count, std::max(min_size, size_type{1}));
+  auto       chunks     = std::vector<string_view_t>{};
+  auto       begin      = size_type{0};
+  // every `$comment` starting before this offset has been closed before it
+  auto scanned = size_type{0};
+  // the offset past the `$end` of a `$comment` that starts in [scanned, at) and is still open at `at`, npos if none
+  const auto comment_around = [&](const size_type at) {
+    for (auto comment = body.find(keywords::$comment, scanned); comment < at;
+         comment      = body.find(keywords::$comment, scanned)) {
+      const auto close = body.find(keywords::$end, comment + keywords::$comment.size());
+      if (close == string_view_t::npos)
+        return body.size();
+      scanned = close + keywords::$end.size();
+      if (scanned > at)
+        return scanned;
+    }
+    return string_view_t::npos;
+  };
+  while (begin < body.size()) {
+    auto end = begin + chunk_size;
+    // move the cut forward to the next line that starts with a timestamp, outside of a `$comment`
+    while (end < body.size()) {
+      end = body.find("\n#", end);
+      if (end == string_view_t::npos or end + 2 >= body.size())
+        break;
+      if (const auto closed = comment_around(end); closed != string_view_t::npos) {
+        end = closed;
+        continue;
+      }
+      scanned = end;
+      if (std::isdigit(static_cast<unsigned char>(body[end + 2])))
+        break;
+      end += 2;
+    }
+    end = std::min(end == string_view_t::npos ? body.size() : end + 1, body.size());
+    chunks.emplace_back(body.substr(begin, end - begin));
+    begin = end;
+  }
+  return chunks;
+}
+
 } // namespace net::ancillarycat::waver
+// parse_cached() is defined by parse_cache.hpp, which waveform_db.hpp includes once both classes are complete
+#include "waveform_db.hpp"
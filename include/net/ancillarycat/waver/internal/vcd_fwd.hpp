@@ -19,12 +19,12 @@ class file_reader;
 template <typename StringType, typename StringViewType, typename PathType, typename BooleanType, typename StatusType>
 class lexer;
 
+class mapped_file;
+
 class port;
-class scope_value_base;
-class module;
-class task;
-class scope;
-class timestamp;
+enum class scope_kind : std::uint8_t;
+class scope_table;
+struct timestamp;
 class version;
 class date;
 class timescale;
@@ -33,8 +33,18 @@ class value_change_dump;
 class dumpvars;
 
 class value_changes;
+struct change_event;
+class signal_table;
+class value_index;
+class waveform_db;
+class four_state_value;
+
+struct parse_options;
+class parse_stats;
+class parse_cache;
+class follower;
 
-using ports_value_t                      = std::string;
+using ports_value_t                      = four_state_value;
 using string_t                           = std::string;
-using change_t                           = std::pair<identifier_t, ports_value_t>;
+using change_t                           = std::pair<signal_id_t, ports_value_t>;
 } // namespace net::ancillarycat::waver
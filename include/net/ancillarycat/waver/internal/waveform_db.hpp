@@ -0,0 +1,803 @@
+/**************************************************************************************
+ * @file waveform_db.hpp
+ * @brief a compact, versioned binary form of a parsed dump, queried in place through a memory mapping.
+ * @copyright see @file waver.hpp
+ *************************************************************************************/
+#pragma once
+#include <absl/status/status.h>
+#include <absl/status/statusor.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "config.hpp"
+#include "contract.hpp"
+#include "four_state.hpp"
+#include "mapped_file.hpp"
+#include "meta_elements.hpp"
+#include "seek_index.hpp"
+#include "vcd.hpp"
+
+namespace net::ancillarycat::waver {
+/// @brief a value_change_dump converted to a binary file that answers hierarchy and value queries without being
+///        deserialized, see write() and open()
+/// @note the file is a fixed header followed by 8-byte aligned sections:
+///       - strings: the names, references and identifier codes, and the version, date and timescale text
+///       - scopes, ports: the hierarchy; scopes are stored breadth-first, so the children of a scope are contiguous
+///       - signals: the interned signal table; each signal points to its blocks and to its `$dumpvars` value
+///       - blocks, streams: the changes of each signal in blocks of up to `block_size` changes; times are varint
+///         deltas, logic planes varints, reals and strings raw bytes
+///       - times, offsets, order, dumpall: the time index, i.e. the timestamps, the first event of each, the signal
+///         of every event in file order and the `$dumpall` marks; with them to_dump() rebuilds the event log exactly
+///       - dumpvars: the `$dumpvars` values in file order
+/// @note records are in native byte order and are read in place; open() only checks that the header and every
+///       record points within the file, and that the blocks hold as many changes as the time index has events, so
+///       reopening a converted dump costs little more than mapping it.
+class waveform_db {
+public:
+  using size_type     = std::size_t;
+  using time_t        = timestamp::time_t;
+  using path_t        = std::filesystem::path;
+  using string_view_t = std::string_view;
+  using string_t      = std::string;
+  using value_t       = four_state_value;
+  using word_t        = four_state::word_t;
+  using byte_t        = std::uint8_t;
+
+  /// @brief a string in the strings section
+  struct string_ref {
+    std::uint64_t offset = 0;
+    std::uint64_t size   = 0;
+  };
+  struct scope_record {
+    string_ref    name;
+    /// @brief a scope_kind
+    std::uint32_t type        = 0;
+    std::uint32_t parent      = 0;
+    std::uint32_t first_child = 0;
+    std::uint32_t children    = 0;
+    std::uint32_t first_port  = 0;
+    std::uint32_t ports       = 0;
+  };
+  struct port_record {
+    string_ref    name;
+    string_ref    reference;
+    std::uint64_t width = 0;
+    /// @brief a port::type
+    std::uint32_t type   = 0;
+    signal_id_t   signal = invalid_signal_id;
+  };
+  struct signal_record {
+    string_ref    code;
+    std::uint64_t width       = 0;
+    std::uint64_t first_block = 0;
+    std::uint64_t blocks      = 0;
+    /// @brief the offset of the `$dumpvars` value in the dumpvars section, or no_value
+    std::uint64_t initial = 0;
+  };
+  struct block_record {
+    std::uint64_t first_time = 0;
+    std::uint64_t last_time  = 0;
+    /// @brief the offset of the first change in the streams section
+    std::uint64_t offset = 0;
+    std::uint64_t count  = 0;
+  };
+
+  enum section : std::uint8_t {
+    kStrings      = 0,
+    kScopes       = 1,
+    kPorts        = 2,
+    kSignals      = 3,
+    kBlocks       = 4,
+    kStreams      = 5,
+    kTimes        = 6,
+    kOffsets      = 7,
+    kOrder        = 8,
+    kDumpall      = 9,
+    kDumpvars     = 10,
+    kSectionCount = 11,
+  };
+
+  /// @brief the first bytes of a database
+  static inline constexpr auto magic = "WAVERWDB"sv;
+  /// @brief bumped whenever the layout changes
+  static inline constexpr std::uint32_t version = 1;
+  /// @brief default number of changes per block
+  static inline constexpr size_type default_block_size = 256;
+  /// @brief the parent of a top-level scope
+  static inline constexpr auto no_scope = std::numeric_limits<std::uint32_t>::max();
+  /// @brief a signal without a `$dumpvars` value
+  static inline constexpr auto no_value = std::numeric_limits<std::uint64_t>::max();
+
+public:
+  inline explicit waveform_db() noexcept = default;
+
+public:
+  /// @brief convert `vcd` and write it to `path`, atomically
+  /// @param block_size the number of changes per block; smaller blocks make value_at() decode less
+  inline static Status write(const value_change_dump &vcd, const path_t &path,
+                             size_type block_size = default_block_size);
+
+  /// @brief map the database at `path`
+  WAVER_NODISCARD inline static absl::StatusOr<waveform_db> open(const path_t &path);
+
+  /// @brief whether the file at `path` starts like a database
+  WAVER_NODISCARD inline static bool is_database(const path_t &path);
+
+  /// @brief deserialize the whole database; the result equals the dump it was written from
+  /// @param allocator where the dump is allocated, see parse_options::memory
+  WAVER_NODISCARD inline absl::StatusOr<value_change_dump> to_dump(const allocator_t &allocator = {}) const;
+
+public:
+  /// @brief all scopes, breadth-first; the top-level ones come first
+  WAVER_NODISCARD inline std::span<const scope_record> scopes() const noexcept {
+    return records<scope_record>(kScopes);
+  }
+  WAVER_NODISCARD inline std::span<const scope_record> roots() const noexcept { return scopes().first(head->roots); }
+  WAVER_NODISCARD inline std::span<const scope_record> children(const scope_record &scope) const noexcept {
+    return scopes().subspan(scope.first_child, scope.children);
+  }
+  WAVER_NODISCARD inline std::span<const port_record> ports(const scope_record &scope) const noexcept {
+    return records<port_record>(kPorts).subspan(scope.first_port, scope.ports);
+  }
+  WAVER_NODISCARD inline string_view_t string(const string_ref &ref) const noexcept {
+    return {file.data() + head->sections[kStrings].offset + ref.offset, static_cast<size_type>(ref.size)};
+  }
+
+  /// @brief look up a signal by its hierarchical name, e.g. `TOP.ALU4.out`
+  /// @return the signal id, or invalid_signal_id if no port has that name
+  WAVER_NODISCARD inline signal_id_t find_signal(string_view_t path) const noexcept;
+
+  /// @brief the number of distinct signals
+  WAVER_NODISCARD inline size_type signal_count() const noexcept { return records<signal_record>(kSignals).size(); }
+  /// @brief the identifier code of a signal
+  WAVER_NODISCARD inline string_view_t code(const signal_id_t signal) const noexcept {
+    WAVER_PRECONDITION(signal < signal_count());
+
+    return string(records<signal_record>(kSignals)[signal].code);
+  }
+  /// @brief the declared width of a signal
+  WAVER_NODISCARD inline size_type width(const signal_id_t signal) const noexcept {
+    WAVER_PRECONDITION(signal < signal_count());
+
+    return static_cast<size_type>(records<signal_record>(kSignals)[signal].width);
+  }
+
+  /// @brief the time of every timestamp, ascending
+  WAVER_NODISCARD inline std::span<const std::uint64_t> timestamps() const noexcept {
+    return records<std::uint64_t>(kTimes);
+  }
+  WAVER_NODISCARD inline string_view_t version_text() const noexcept { return string(head->version_text); }
+  WAVER_NODISCARD inline string_view_t date() const noexcept { return string(head->date); }
+  WAVER_NODISCARD inline string_view_t timescale() const noexcept { return string(head->timescale); }
+
+  /// @brief the value of `signal` at `time`, i.e. after all changes at or before `time`
+  /// @return the latest value, the `$dumpvars` value if it has not changed yet, or all x if it has neither
+  /// @note decodes a single block of the signal
+  WAVER_NODISCARD inline value_t value_at(signal_id_t signal, time_t time) const;
+
+  /// @brief the changes of `signal` within `range`, in time order
+  WAVER_NODISCARD inline std::vector<std::pair<time_t, value_t>> changes(signal_id_t      signal,
+                                                                         const time_range &range = {}) const;
+
+private:
+  struct extent {
+    std::uint64_t offset = 0;
+    std::uint64_t size   = 0;
+  };
+  struct file_header {
+    char          magic[8]   = {};
+    std::uint32_t version    = 0;
+    /// @brief byte_order_mark as written, to reject a file written on a machine of the other endianness
+    std::uint32_t byte_order = 0;
+    std::uint32_t roots      = 0;
+    std::uint32_t block_size = 0;
+    string_ref    version_text;
+    string_ref    date;
+    string_ref    timescale;
+    extent        sections[kSectionCount];
+  };
+  static inline constexpr std::uint32_t byte_order_mark = 0x01020304;
+  /// @brief the descriptor before the first change of a block
+  static inline constexpr std::uint32_t no_descriptor = std::numeric_limits<std::uint32_t>::max();
+
+  /// @brief walks the changes of one block
+  struct block_cursor {
+    const byte_t *position   = nullptr;
+    const byte_t *end        = nullptr;
+    std::uint64_t remaining  = 0;
+    std::uint64_t time       = 0;
+    std::uint32_t descriptor = no_descriptor;
+    /// @brief the encoded value of the current change
+    const byte_t *value = nullptr;
+
+    /// @brief move to the next change, skipping over the value of the current one
+    inline bool next() noexcept {
+      if (remaining == 0)
+        return false;
+      if (value)
+        skip_value(position, end, descriptor);
+      --remaining;
+      const auto header = get_varint(position, end);
+      time += header >> 1;
+      if (not(header & 1))
+        descriptor = static_cast<std::uint32_t>(get_varint(position, end));
+      value = position;
+      return true;
+    }
+  };
+
+private:
+  template <typename Record>
+  WAVER_NODISCARD inline std::span<const Record> records(const section which) const noexcept {
+    const auto &extent = head->sections[which];
+    return {reinterpret_cast<const Record *>(file.data() + extent.offset),
+            static_cast<size_type>(extent.size / sizeof(Record))};
+  }
+  WAVER_NODISCARD inline const byte_t *bytes(const section which) const noexcept {
+    return reinterpret_cast<const byte_t *>(file.data() + head->sections[which].offset);
+  }
+  WAVER_NODISCARD inline block_cursor cursor(const block_record &block) const noexcept {
+    const auto *const streams = bytes(kStreams);
+    return {streams + block.offset, streams + head->sections[kStreams].size, block.count, block.first_time};
+  }
+  WAVER_NODISCARD inline value_t initial(signal_id_t signal) const;
+
+  /// @brief the number of words a value of `descriptor` decodes into
+  WAVER_NODISCARD inline static constexpr size_type words_of(const std::uint32_t descriptor) noexcept {
+    const auto event = change_event{0, descriptor};
+    return event.kind() == change_event::kind_t::kReal ? 1 : value_changes::pooled_words(event);
+  }
+  inline static void put_varint(string_t &out, std::uint64_t value);
+  WAVER_NODISCARD inline static std::uint64_t get_varint(const byte_t *&position, const byte_t *end) noexcept;
+  /// @brief append the encoded `words` of a value of `descriptor` to `out`
+  inline static void put_value(string_t &out, std::uint32_t descriptor, const word_t *words);
+  /// @brief decode a value of `descriptor` into words_of(descriptor) zeroed `words`
+  inline static void get_value(const byte_t *&position, const byte_t *end, std::uint32_t descriptor,
+                               word_t *words) noexcept;
+  inline static void skip_value(const byte_t *&position, const byte_t *end, std::uint32_t descriptor) noexcept;
+  /// @brief build a value from its decoded words
+  WAVER_NODISCARD inline static value_t make_value(std::uint32_t descriptor, const word_t *words);
+  /// @brief the descriptor and words of a `$dumpvars` value
+  WAVER_NODISCARD inline static std::pair<std::uint32_t, const word_t *> words_of(const value_t &value) noexcept;
+  WAVER_NODISCARD inline Status validate() const;
+
+private:
+  mapped_file        file;
+  const file_header *head = nullptr;
+};
+} // namespace net::ancillarycat::waver
+
+namespace net::ancillarycat::waver {
+inline Status waveform_db::write(const value_change_dump &vcd, const path_t &path, const size_type block_size) {
+  WAVER_PRECONDITION(block_size > 0);
+  static_assert(sizeof(time_t) == sizeof(std::uint64_t) and sizeof(value_changes::size_type) == sizeof(std::uint64_t));
+
+  const auto &header  = vcd.header;
+  const auto &changes = vcd.value_changes;
+  const auto &signals = header.signals;
+  auto        head    = file_header{};
+  auto        strings = string_t{};
+  const auto  intern  = [&](const string_view_t text) {
+    const auto ref = string_ref{strings.size(), text.size()};
+    strings.append(text);
+    return ref;
+  };
+  std::ranges::copy(magic, head.magic);
+  head.version      = version;
+  head.byte_order   = byte_order_mark;
+  head.block_size   = static_cast<std::uint32_t>(block_size);
+  head.roots        = 0;
+  for (auto root = header.scopes.first_root(); root != scope_table::npos; root = header.scopes.next_sibling(root))
+    ++head.roots;
+  head.version_text = intern(header.version.description);
+  head.date         = intern(header.date.time_point);
+  head.timescale    = intern(header.timescale.time);
+
+  // write next to the destination, then rename over it, so a reader never sees half a database; the name is
+  // unique so that writers of the same path do not interleave
+  auto temporary = path_t{path} += "." + std::to_string(std::random_device{}()) + ".tmp";
+  auto file      = std::ofstream{temporary, std::ios::binary | std::ios::trunc};
+  if (not file)
+    return absl::PermissionDeniedError("Unable to write " + temporary.string());
+  auto       written = std::uint64_t{sizeof head};
+  const auto begin   = [&](const section which) {
+    constexpr char padding[8] = {};
+    const auto     pad        = (8 - written % 8) % 8;
+    file.write(padding, static_cast<std::streamsize>(pad));
+    written += pad;
+    head.sections[which] = {written, 0};
+  };
+  const auto append = [&](const section which, const void *data, const size_type size) {
+    file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+    written += size;
+    head.sections[which].size += size;
+  };
+  const auto emit = [&](const section which, const auto &range) {
+    begin(which);
+    append(which, std::ranges::data(range), std::ranges::size(range) * sizeof(*std::ranges::data(range)));
+  };
+  file.write(reinterpret_cast<const char *>(&head), sizeof head);
+
+  // the positions of the events of each signal, in time order: a counting sort by signal
+  auto starts = std::vector<size_type>(signals.size() + 1, 0);
+  for (const auto &event : changes.events) {
+    WAVER_PRECONDITION(event.signal < signals.size());
+    ++starts[event.signal + 1];
+  }
+  std::partial_sum(starts.begin(), starts.end(), starts.begin());
+  auto positions = std::vector<size_type>(changes.events.size());
+  {
+    auto next = std::vector<size_type>(starts.begin(), starts.end() - 1);
+    for (size_type position = 0; position < changes.events.size(); ++position)
+      positions[next[changes.events[position].signal]++] = position;
+  }
+
+  // the `$dumpvars` values; a signal points to its last one
+  auto signal_records = std::vector<signal_record>(signals.size(), {.initial = no_value});
+  auto dumpvars       = string_t{};
+  put_varint(dumpvars, vcd.dumpvars.changes.size());
+  for (const auto &[signal, value] : vcd.dumpvars.changes) {
+    const auto [descriptor, words] = words_of(value);
+    put_varint(dumpvars, signal);
+    signal_records[signal].initial = dumpvars.size();
+    put_varint(dumpvars, descriptor);
+    put_value(dumpvars, descriptor, words);
+  }
+
+  // one stream per signal, cut into blocks
+  auto blocks = std::vector<block_record>{};
+  auto stream = string_t{};
+  begin(kStreams);
+  for (signal_id_t signal = 0; signal < signals.size(); ++signal) {
+    auto &record       = signal_records[signal];
+    record.code        = intern(signals.code(signal));
+    record.width       = signals.width(signal);
+    record.first_block = blocks.size();
+    auto timestamp = size_type{0};
+    auto scratch   = std::array<word_t, 2>{};
+    for (auto first = starts[signal]; first < starts[signal + 1]; first += block_size) {
+      const auto last       = std::min(first + block_size, starts[signal + 1]);
+      auto       block      = block_record{0, 0, head.sections[kStreams].size + stream.size(), last - first};
+      auto       previous   = std::uint64_t{0};
+      auto       descriptor = no_descriptor;
+      for (auto index = first; index < last; ++index) {
+        const auto  position = positions[index];
+        const auto &event    = changes.events[position];
+        // the timestamp holding the event; positions ascend, so the search only moves forward
+        timestamp = static_cast<size_type>(
+          std::upper_bound(changes.offsets.begin() + static_cast<std::ptrdiff_t>(timestamp), changes.offsets.end(),
+                           position) - changes.offsets.begin() - 1);
+        const auto time = changes.times[timestamp];
+        if (index == first)
+          block.first_time = previous = time;
+        block.last_time = time;
+        put_varint(stream, (time - previous) << 1 | (event.descriptor == descriptor));
+        if (event.descriptor != descriptor)
+          put_varint(stream, event.descriptor);
+        previous   = time;
+        descriptor = event.descriptor;
+
+        const auto *words = scratch.data();
+        if (event.kind() == change_event::kind_t::kReal)
+          scratch[0] = event.value;
+        else if (event.is_inline()) {
+          scratch[0] = event.value & ((word_t{1} << change_event::inline_bits) - 1);
+          scratch[1] = event.value >> change_event::inline_bits;
+        } else
+          words = changes.words.data() + event.value;
+        put_value(stream, descriptor, words);
+      }
+      blocks.emplace_back(block);
+    }
+    record.blocks = blocks.size() - record.first_block;
+    if (stream.size() >= size_type{1} << 20) {
+      append(kStreams, stream.data(), stream.size());
+      stream.clear();
+    }
+  }
+  append(kStreams, stream.data(), stream.size());
+  emit(kBlocks, blocks);
+
+  // the hierarchy, breadth-first
+  const auto &scopes        = header.scopes;
+  auto        queue         = std::vector<scope_table::index_t>{};
+  auto        scope_records = std::vector<scope_record>{};
+  auto        port_records  = std::vector<port_record>{};
+  for (auto root = scopes.first_root(); root != scope_table::npos; root = scopes.next_sibling(root))
+    queue.emplace_back(root);
+  scope_records.resize(queue.size(), {.parent = no_scope});
+  for (size_type index = 0; index < queue.size(); ++index) {
+    const auto scope   = queue[index];
+    auto       record  = scope_records[index];
+    record.name        = intern(scopes.name(scope));
+    record.type        = static_cast<std::uint32_t>(scopes.kind(scope));
+    record.first_child = static_cast<std::uint32_t>(queue.size());
+    record.first_port  = static_cast<std::uint32_t>(port_records.size());
+    for (auto child = scopes.first_child(scope); child != scope_table::npos; child = scopes.next_sibling(child)) {
+      queue.emplace_back(child);
+      scope_records.push_back({.parent = static_cast<std::uint32_t>(index)});
+    }
+    record.children = static_cast<std::uint32_t>(queue.size() - record.first_child);
+    for (const auto &port : scopes.ports(scope))
+      port_records.push_back({intern(port.name), intern(port.reference), port.width, port.type, port.signal});
+    record.ports         = static_cast<std::uint32_t>(port_records.size() - record.first_port);
+    scope_records[index] = record;
+  }
+  emit(kScopes, scope_records);
+  emit(kPorts, port_records);
+  emit(kSignals, signal_records);
+
+  // the time index
+  auto order = std::vector<signal_id_t>{};
+  order.reserve(changes.events.size());
+  std::ranges::transform(changes.events, std::back_inserter(order), &change_event::signal);
+  emit(kTimes, changes.times);
+  emit(kOffsets, changes.offsets);
+  emit(kOrder, order);
+  emit(kDumpall, changes.dumpall);
+  emit(kDumpvars, dumpvars);
+  emit(kStrings, strings);
+
+  file.seekp(0);
+  file.write(reinterpret_cast<const char *>(&head), sizeof head);
+  auto ec = std::error_code{};
+  if (not file.flush()) {
+    file.close();
+    std::filesystem::remove(temporary, ec);
+    return absl::DataLossError("Unable to write " + temporary.string());
+  }
+  file.close();
+  std::filesystem::rename(temporary, path, ec);
+  if (ec) {
+    std::filesystem::remove(temporary, ec);
+    return absl::PermissionDeniedError("Unable to rename " + temporary.string() + " to " + path.string());
+  }
+  return OkStatus();
+}
+
+inline absl::StatusOr<waveform_db> waveform_db::open(const path_t &path) {
+  auto db = waveform_db{};
+  db.file = mapped_file{path};
+  if (db.file.empty())
+    return NotFoundError("Unable to map " + path.string());
+  db.head = reinterpret_cast<const file_header *>(db.file.data());
+  if (db.file.size() < sizeof(file_header) or string_view_t{db.head->magic, magic.size()} != magic)
+    return InvalidArgumentError("Not a waveform database: " + path.string());
+  if (db.head->version != version)
+    return InvalidArgumentError("Unsupported waveform database version " + std::to_string(db.head->version) + ": " +
+                                path.string());
+  if (db.head->byte_order != byte_order_mark)
+    return InvalidArgumentError("Waveform database of another byte order: " + path.string());
+  if (auto res = db.validate(); res != OkStatus())
+    return absl::DataLossError(std::string{res.message()} + ": " + path.string());
+  return db;
+}
+
+inline bool waveform_db::is_database(const path_t &path) {
+  auto file   = std::ifstream{path, std::ios::binary};
+  auto header = std::string(magic.size(), '\0');
+  file.read(header.data(), static_cast<std::streamsize>(header.size()));
+  return file and header == magic;
+}
+
+inline Status waveform_db::validate() const {
+  for (const auto &extent : head->sections)
+    if (extent.offset % 8 or extent.offset > file.size() or extent.size > file.size() - extent.offset)
+      return InvalidArgumentError("Section out of bounds");
+  const auto strings = head->sections[kStrings].size;
+  const auto fits    = [&](const string_ref &ref) {
+    return ref.offset <= strings and ref.size <= strings - ref.offset;
+  };
+  if (not fits(head->version_text) or not fits(head->date) or not fits(head->timescale))
+    return InvalidArgumentError("String out of bounds");
+
+  const auto scopes = this->scopes();
+  const auto ports  = records<port_record>(kPorts);
+  if (head->roots > scopes.size())
+    return InvalidArgumentError("Scope out of bounds");
+  // children come after their parent, so that walking the hierarchy ends
+  for (size_type index = 0; index < scopes.size(); ++index)
+    if (const auto &scope = scopes[index];
+        not fits(scope.name) or scope.type > std::to_underlying(scope_kind::kFork) or
+        std::uint64_t{scope.first_child} + scope.children > scopes.size() or
+        (scope.children and scope.first_child <= index) or std::uint64_t{scope.first_port} + scope.ports > ports.size())
+      return InvalidArgumentError("Scope out of bounds");
+  for (const auto &port : ports)
+    if (not fits(port.name) or not fits(port.reference) or port.signal >= signal_count())
+      return InvalidArgumentError("Port out of bounds");
+
+  const auto blocks = records<block_record>(kBlocks);
+  for (const auto &signal : records<signal_record>(kSignals))
+    if (not fits(signal.code) or signal.first_block > blocks.size() or
+        signal.blocks > blocks.size() - signal.first_block or
+        (signal.initial != no_value and signal.initial >= head->sections[kDumpvars].size))
+      return InvalidArgumentError("Signal out of bounds");
+  const auto times   = timestamps();
+  const auto offsets = records<std::uint64_t>(kOffsets);
+  const auto order   = records<signal_id_t>(kOrder);
+  // every change takes at least a byte of its stream, and every event of the time index is one change
+  auto changes = std::uint64_t{0};
+  for (const auto &block : blocks) {
+    const auto streams = head->sections[kStreams].size;
+    if (block.offset > streams or block.count > streams - block.offset or block.count > order.size() - changes)
+      return InvalidArgumentError("Block out of bounds");
+    changes += block.count;
+  }
+  if (changes != order.size())
+    return InvalidArgumentError("Block counts do not match the time index");
+
+  const auto dumpall = records<std::uint64_t>(kDumpall);
+  // the events of a time run from its offset to the next one, so the offsets may not decrease
+  const auto in_order = [&](const auto &marks) {
+    return std::ranges::is_sorted(marks) and (marks.empty() or marks.back() <= order.size());
+  };
+  if (offsets.size() != times.size() or not in_order(offsets))
+    return InvalidArgumentError("Time index out of bounds");
+  if (not in_order(dumpall))
+    return InvalidArgumentError("Dumpall mark out of bounds");
+  return OkStatus();
+}
+
+inline absl::StatusOr<value_change_dump> waveform_db::to_dump(const allocator_t &allocator) const {
+  auto  vcd     = value_change_dump{allocator};
+  auto &header  = vcd.header;
+  auto &changes = vcd.value_changes;
+  header.version.description = string(head->version_text);
+  header.date.time_point     = string(head->date);
+  header.timescale.time      = string(head->timescale);
+  for (const auto &signal : records<signal_record>(kSignals))
+    header.signals.intern(string(signal.code), static_cast<size_type>(signal.width));
+
+  // the hierarchy, from breadth-first records back to pre-order: a scope is opened when it is reached, and closed
+  // once all of its children are
+  const auto scopes = this->scopes();
+  const auto open   = [&](const scope_record &record) {
+    header.scopes.open(static_cast<scope_kind>(record.type), string(record.name));
+    for (const auto &port : ports(record))
+      header.scopes.add_port(static_cast<enum port::type>(port.type), static_cast<size_type>(port.width), port.signal,
+                             string(port.name), string(port.reference));
+  };
+  // the scopes being visited, with the number of their children visited so far
+  auto visiting = std::vector<std::pair<const scope_record *, std::uint32_t>>{};
+  for (const auto &root : roots()) {
+    open(root);
+    visiting.emplace_back(&root, 0);
+    while (not visiting.empty()) {
+      auto &[record, visited] = visiting.back();
+      if (visited == record->children) {
+        header.scopes.close();
+        visiting.pop_back();
+        continue;
+      }
+      const auto &child = scopes[record->first_child + visited++];
+      open(child);
+      visiting.emplace_back(&child, 0);
+    }
+  }
+
+  // the `$dumpvars` values
+  const auto *position = bytes(kDumpvars);
+  const auto *const end = position + head->sections[kDumpvars].size;
+  auto       words     = std::vector<word_t>{};
+  for (auto count = get_varint(position, end); count; --count) {
+    const auto signal     = static_cast<signal_id_t>(get_varint(position, end));
+    const auto descriptor = static_cast<std::uint32_t>(get_varint(position, end));
+    words.assign(words_of(descriptor), 0);
+    get_value(position, end, descriptor, words.data());
+    if (signal >= signal_count())
+      return absl::DataLossError("Corrupted $dumpvars");
+    vcd.dumpvars.changes.emplace_back(signal, make_value(descriptor, words.data()));
+  }
+
+  // the event log: replay the signal of every event from the next change of its stream
+  const auto times   = timestamps();
+  const auto offsets = records<std::uint64_t>(kOffsets);
+  const auto order   = records<signal_id_t>(kOrder);
+  const auto signals = records<signal_record>(kSignals);
+  const auto blocks  = records<block_record>(kBlocks);
+  changes.times.assign(times.begin(), times.end());
+  changes.offsets.assign(offsets.begin(), offsets.end());
+  const auto dumpall = records<std::uint64_t>(kDumpall);
+  changes.dumpall.assign(dumpall.begin(), dumpall.end());
+  changes.events.reserve(order.size());
+  auto cursors    = std::vector<block_cursor>(signals.size());
+  auto next_block = std::vector<std::uint64_t>(signals.size(), 0);
+  auto scratch    = std::array<word_t, 2>{};
+  for (const auto signal : order) {
+    if (signal >= signals.size())
+      return absl::DataLossError("Corrupted time index");
+    auto &cursor = cursors[signal];
+    if (not cursor.next()) {
+      if (next_block[signal] == signals[signal].blocks)
+        return absl::DataLossError("Truncated stream of " + string_t{code(signal)});
+      cursor = this->cursor(blocks[signals[signal].first_block + next_block[signal]++]);
+      cursor.next();
+    }
+    auto event = change_event{signal, cursor.descriptor};
+    auto value = cursor.value;
+    if (event.is_inline()) {
+      scratch = {};
+      get_value(value, cursor.end, event.descriptor, scratch.data());
+      event.value = event.kind() == change_event::kind_t::kReal ? scratch[0]
+                                                                : scratch[0] | scratch[1] << change_event::inline_bits;
+    } else {
+      event.value = changes.words.size();
+      changes.words.resize(changes.words.size() + words_of(event.descriptor));
+      get_value(value, cursor.end, event.descriptor, changes.words.data() + event.value);
+    }
+    changes.events.emplace_back(event);
+  }
+  return vcd;
+}
+
+inline signal_id_t waveform_db::find_signal(string_view_t path) const noexcept {
+  auto candidates = roots();
+  for (auto separator = path.find(signal_filter::separator); separator != string_view_t::npos;
+       separator      = path.find(signal_filter::separator)) {
+    const auto name  = path.substr(0, separator);
+    const auto scope =
+      std::ranges::find(candidates, name, [&](const scope_record &scope) { return string(scope.name); });
+    if (scope == candidates.end())
+      return invalid_signal_id;
+    path = path.substr(separator + 1);
+    for (const auto &port : ports(*scope))
+      if (string(port.name) == path)
+        return port.signal;
+    candidates = children(*scope);
+  }
+  return invalid_signal_id;
+}
+
+inline waveform_db::value_t waveform_db::value_at(const signal_id_t signal, const time_t time) const {
+  WAVER_PRECONDITION(signal < signal_count());
+
+  const auto &record = records<signal_record>(kSignals)[signal];
+  const auto  blocks = records<block_record>(kBlocks).subspan(record.first_block, record.blocks);
+  // the last block starting at or before `time`; the value is its last change at or before `time`
+  const auto after = std::ranges::upper_bound(blocks, std::uint64_t{time}, {}, &block_record::first_time);
+  if (after == blocks.begin())
+    return initial(signal);
+  auto cursor = this->cursor(*std::prev(after));
+  auto latest = block_cursor{};
+  while (cursor.next() and cursor.time <= time)
+    latest = cursor;
+  auto words = std::vector<word_t>(words_of(latest.descriptor), 0);
+  get_value(latest.value, latest.end, latest.descriptor, words.data());
+  return make_value(latest.descriptor, words.data());
+}
+
+inline std::vector<std::pair<waveform_db::time_t, waveform_db::value_t>>
+waveform_db::changes(const signal_id_t signal, const time_range &range) const {
+  WAVER_PRECONDITION(signal < signal_count());
+
+  const auto &record = records<signal_record>(kSignals)[signal];
+  const auto  blocks = records<block_record>(kBlocks).subspan(record.first_block, record.blocks);
+  auto        result = std::vector<std::pair<time_t, value_t>>{};
+  auto        words  = std::vector<word_t>{};
+  // the first block ending at or after `range.first`
+  for (auto block = std::ranges::lower_bound(blocks, std::uint64_t{range.first}, {}, &block_record::last_time);
+       block != blocks.end() and block->first_time <= range.last; ++block)
+    for (auto cursor = this->cursor(*block); cursor.next();) {
+      if (cursor.time < range.first)
+        continue;
+      if (cursor.time > range.last)
+        break;
+      words.assign(words_of(cursor.descriptor), 0);
+      auto value = cursor.value;
+      get_value(value, cursor.end, cursor.descriptor, words.data());
+      result.emplace_back(cursor.time, make_value(cursor.descriptor, words.data()));
+    }
+  return result;
+}
+
+inline waveform_db::value_t waveform_db::initial(const signal_id_t signal) const {
+  const auto &record = records<signal_record>(kSignals)[signal];
+  if (record.initial == no_value)
+    return *value_t::from_vcd("bx", static_cast<size_type>(record.width));
+  const auto *position   = bytes(kDumpvars) + record.initial;
+  const auto *const end  = bytes(kDumpvars) + head->sections[kDumpvars].size;
+  const auto descriptor  = static_cast<std::uint32_t>(get_varint(position, end));
+  auto       words       = std::vector<word_t>(words_of(descriptor), 0);
+  get_value(position, end, descriptor, words.data());
+  return make_value(descriptor, words.data());
+}
+
+inline void waveform_db::put_varint(string_t &out, std::uint64_t value) {
+  for (; value >= 0x80; value >>= 7)
+    out.push_back(static_cast<char>(value | 0x80));
+  out.push_back(static_cast<char>(value));
+}
+
+inline std::uint64_t waveform_db::get_varint(const byte_t *&position, const byte_t *const end) noexcept {
+  auto value = std::uint64_t{0};
+  for (auto shift = 0u; position < end and shift < 64; shift += 7) {
+    const auto byte = *position++;
+    value |= std::uint64_t{byte & 0x7fu} << shift;
+    if (not(byte & 0x80))
+      break;
+  }
+  return value;
+}
+
+inline void waveform_db::put_value(string_t &out, const std::uint32_t descriptor, const word_t *const words) {
+  const auto event = change_event{0, descriptor};
+  switch (event.kind()) {
+  case change_event::kind_t::kReal:
+    out.append(reinterpret_cast<const char *>(words), sizeof(word_t));
+    return;
+  case change_event::kind_t::kString:
+    out.append(reinterpret_cast<const char *>(words), event.width());
+    return;
+  default:
+    // mostly narrow values with few x/z bits, so most words take one or two bytes
+    for (size_type index = 0; index < words_of(descriptor); ++index)
+      put_varint(out, words[index]);
+  }
+}
+
+inline void waveform_db::get_value(const byte_t *&position, const byte_t *const end, const std::uint32_t descriptor,
+                                   word_t *const words) noexcept {
+  const auto event = change_event{0, descriptor};
+  switch (event.kind()) {
+  case change_event::kind_t::kReal:
+  case change_event::kind_t::kString: {
+    const auto size = std::min<size_type>(event.kind() == change_event::kind_t::kReal ? sizeof(word_t) : event.width(),
+                                          static_cast<size_type>(end - position));
+    if (words)
+      std::memcpy(words, position, size);
+    position += size;
+    return;
+  }
+  default:
+    for (size_type index = 0; index < words_of(descriptor); ++index) {
+      const auto word = get_varint(position, end);
+      if (words)
+        words[index] = word;
+    }
+  }
+}
+
+inline void waveform_db::skip_value(const byte_t *&position, const byte_t *const end,
+                                    const std::uint32_t descriptor) noexcept {
+  get_value(position, end, descriptor, nullptr);
+}
+
+inline waveform_db::value_t waveform_db::make_value(const std::uint32_t descriptor, const word_t *const words) {
+  const auto event = change_event{0, descriptor};
+  switch (event.kind()) {
+  case change_event::kind_t::kReal:
+    return value_t::from_real(std::bit_cast<double>(words[0]));
+  case change_event::kind_t::kString:
+    return value_t::from_string({reinterpret_cast<const char *>(words), event.width()});
+  default:
+    return value_t::from_planes(event.width(), words, words + four_state::words_for(event.width()));
+  }
+}
+
+inline std::pair<std::uint32_t, const waveform_db::word_t *> waveform_db::words_of(const value_t &value) noexcept {
+  switch (value.get_kind()) {
+  case value_t::kReal:
+    return {value_changes::describe(value_t::kReal, four_state::word_bits), value.a_plane().data()};
+  case value_t::kString:
+    return {value_changes::describe(value_t::kString, value.width() / 8), value.a_plane().data()};
+  default:
+    return {value_changes::describe(value_t::kLogic, value.width()), value.a_plane().data()};
+  }
+}
+} // namespace net::ancillarycat::waver
+#include "parse_cache.hpp"
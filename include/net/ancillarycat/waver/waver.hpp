@@ -2,6 +2,26 @@
 #pragma once
 #include "internal/config.hpp"
 #include "internal/vcd_fwd.hpp"
+#include "internal/mapped_file.hpp"
+#include "internal/decompressor.hpp"
+#include "internal/generator.hpp"
+#include "internal/thread_pool.hpp"
+#include "internal/arena.hpp"
+#include "internal/signal_table.hpp"
+#include "internal/signal_filter.hpp"
+#include "internal/four_state.hpp"
+#include "internal/json_writer.hpp"
+#include "internal/parse_stats.hpp"
+#include "internal/tokenizer.hpp"
+#include "internal/token.hpp"
 #include "internal/lexer.hpp"
 #include "internal/meta_elements.hpp"
+#include "internal/body_scanner.hpp"
+#include "internal/value_index.hpp"
+#include "internal/name_index.hpp"
+#include "internal/seek_index.hpp"
 #include "internal/vcd.hpp"
+#include "internal/waveform_db.hpp"
+#include "internal/parse_cache.hpp"
+#include "internal/follower.hpp"
+#include "internal/batch.hpp"
@@ -1,44 +1,262 @@
 #define WAVER_DEBUG_ENABLED 1
 #include <absl/status/status.h>
 #include <absl/status/statusor.h>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <limits>
+#include <new>
 #include <net/ancillarycat/waver/waver.hpp>
 #include <nlohmann/json.hpp>
 #include <fmt/core.h>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 
 
 
+using net::ancillarycat::waver::parse_stats;
+
+/// @brief print one line per phase, with the throughput of the phases that saw any bytes
+static void print_stats(const parse_stats &stats) {
+  fmt::println("{:<10} {:>12} {:>14} {:>12} {:>12} {:>10} {:>14}", "phase", "wall [ms]", "bytes", "tokens",
+               "changes", "MB/s", "peak RSS [MB]");
+  for (const auto which : {parse_stats::kLoad, parse_stats::kLex, parse_stats::kHeader, parse_stats::kBody,
+                           parse_stats::kSerialize}) {
+    const auto &counters = stats[which];
+    const auto  seconds  = std::chrono::duration<double>(counters.wall).count();
+    fmt::println("{:<10} {:>12.3f} {:>14} {:>12} {:>12} {:>10.1f} {:>14.1f}", parse_stats::name(which),
+                 seconds * 1e3, counters.bytes, counters.tokens, counters.changes,
+                 seconds > 0 ? static_cast<double>(counters.bytes) / seconds / 1e6 : 0.0,
+                 static_cast<double>(counters.peak_bytes) / 1e6);
+  }
+}
+
+/// @brief print the last `count` changes of `vcd`, a line per timestamp, each change as `<code>=<value>`
+static void print_changes(const net::ancillarycat::waver::value_change_dump &vcd, std::size_t count) {
+  const auto &changes = vcd.value_changes;
+  auto        first   = changes.size();
+  // the first timestamp holding any of them, and how many changes before them it holds
+  auto skip = std::size_t{0};
+  for (auto seen = std::size_t{0}; first > 0 and seen < count;) {
+    seen += changes[--first].changes.size();
+    skip = seen > count ? seen - count : 0;
+  }
+  auto line = std::string{};
+  for (; first < changes.size(); ++first, skip = 0) {
+    const auto stamp = changes[first];
+    line.assign("#").append(std::to_string(stamp.time));
+    for (const auto &event : stamp.changes.subspan(skip)) {
+      line.append(" ").append(vcd.header.signal_codes().code(event.signal)).append("=");
+      changes.format(event, line);
+    }
+    fmt::println("{}", line);
+  }
+  // a pipe would otherwise hold them back until its buffer fills
+  std::fflush(stdout);
+}
+
+/// @brief convert every file `spec` stands for, printing a line per file and the aggregate throughput
+static int run_batch(const std::filesystem::path &spec, const std::filesystem::path &output_directory,
+                     net::ancillarycat::waver::parse_options options, const std::size_t jobs,
+                     const std::filesystem::path &cache_directory, const std::size_t memory_limit) {
+  using net::ancillarycat::waver::batch;
+  const auto inputs = batch::collect(spec, output_directory);
+  if (not inputs.ok()) {
+    fmt::println("Failed to collect the files to convert: {}", inputs.status().message().data());
+    return EXIT_FAILURE;
+  }
+  auto cache = net::ancillarycat::waver::parse_cache{cache_directory};
+  if (not cache_directory.empty())
+    options.cache = &cache;
+  auto       converter = batch{options, jobs, memory_limit};
+  const auto started   = std::chrono::steady_clock::now();
+  const auto results   = converter.run(*inputs, [](const batch::result &result) {
+    const auto milliseconds = std::chrono::duration<double, std::milli>(result.wall).count();
+    if (result.status.ok())
+      fmt::println("ok     {} -> {} ({:.1f} ms)", result.source.string(), result.output.string(), milliseconds);
+    else
+      fmt::println("FAILED {}: {}", result.source.string(), result.status.message().data());
+  });
+  const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  auto failed = std::size_t{0}, bytes = std::size_t{0}, changes = std::size_t{0};
+  for (const auto &result : results) {
+    failed += not result.status.ok();
+    bytes += result.bytes;
+    changes += result.changes;
+  }
+  fmt::println("{} files, {} failed, {:.1f} MB and {} changes in {:.3f} s on {} threads: {:.1f} MB/s, {:.1f} files/s",
+               results.size(), failed, static_cast<double>(bytes) / 1e6, changes, seconds, converter.threads(),
+               seconds > 0 ? static_cast<double>(bytes) / seconds / 1e6 : 0.0,
+               seconds > 0 ? static_cast<double>(results.size()) / seconds : 0.0);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/// @brief report what is wrong with the command line, and how to use it
+static int usage(const std::string_view problem) {
+  fmt::println("Waver: {}", problem);
+  fmt::println("Usage: waver [options] <source_file> <output_file>");
+  fmt::println("Usage: waver [options] <source_file>");
+  fmt::println("Usage: waver [options] --batch <directory|glob|manifest> [output_directory]");
+  fmt::println("  --filter <pattern>  only keep the changes of signals whose hierarchical name (e.g. top.alu.carry)");
+  fmt::println("                      or enclosing scope matches the pattern; `*` and `?` are wildcards");
+  fmt::println("  --stats             print the time, bytes, tokens and changes of every phase");
+  fmt::println("  --stats-json <file> write the same counters as JSON");
+  fmt::println("  --db <file>         also write a binary waveform database, which can be the source of a later run");
+  fmt::println("  --cache <dir>       reuse the parse of an unchanged source from <dir>, or store it there");
+  fmt::println("  --follow            keep parsing what a running simulation appends to the source and print its");
+  fmt::println("                      changes as they arrive, until interrupted");
+  fmt::println("  --batch <spec>      convert every dump of a directory, every file matching a glob such as");
+  fmt::println("                      `runs/*.vcd`, or every file a manifest lists one per line, on a thread pool");
+  fmt::println("  --jobs <n>          the number of files converted at once in batch mode, 0 for one per core");
+  fmt::println("  --memory-limit <n>  fail a dump whose model takes more than <n> MiB, which is built on an arena");
+  return EXIT_FAILURE;
+}
+
+/// @brief the decimal number `text` spells, if it is all digits and no greater than `max`
+static std::optional<std::size_t> parse_number(const std::string_view text, const std::size_t max) {
+  auto value = std::size_t{};
+  if (const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+      ec != std::errc() or end != text.data() + text.size() or value > max)
+    return std::nullopt;
+  return value;
+}
+
 int main(const int argc, const char *const *const argv) {
-  std::filesystem::path source_file;
-  std::filesystem::path output_file;
-  if (argc == 1) {
-    // source_file = R"(Z:\Cpp-Playground\waver\test\ALU4.vcd)";
-    // output_file = R"(Z:\Cpp-Playground\waver\test\ALU4.json)";
-    fmt::println("Waver: unknown command line arguments");
-    fmt::println("Usage: waver <source_file> <output_file>");
-    fmt::println("Usage: waver <source_file>");
-  }
-  if (argc == 2) {
-    source_file = argv[1];
+  std::filesystem::path                   source_file;
+  std::filesystem::path                   output_file;
+  std::filesystem::path                   stats_file;
+  std::filesystem::path                   database_file;
+  std::filesystem::path                   cache_directory;
+  std::filesystem::path                   batch_spec;
+  std::size_t                             jobs         = 0;
+  std::size_t                             memory_limit = net::ancillarycat::waver::arena::unlimited;
+  net::ancillarycat::waver::parse_options options{.threads = 0};
+  std::vector<std::filesystem::path>      positionals;
+  parse_stats                             stats;
+  auto                                    print  = false;
+  auto                                    follow = false;
+  // the options followed by a value
+  const auto valued = std::array<std::string_view, 7>{"--filter", "--stats-json", "--db",          "--cache",
+                                                      "--batch",  "--jobs",       "--memory-limit"};
+  for (auto i = 1; i < argc; ++i) {
+    const auto arg = std::string_view{argv[i]};
+    if (i + 1 == argc and std::ranges::find(valued, arg) != valued.end())
+      return usage(std::string{arg} + " expects a value");
+    if (arg == "--filter")
+      options.filter.add(argv[++i]);
+    else if (arg.starts_with("--filter="))
+      options.filter.add(std::string{arg.substr(std::string_view{"--filter="}.size())});
+    else if (arg == "--stats")
+      print = true;
+    else if (arg == "--stats-json")
+      stats_file = argv[++i];
+    else if (arg == "--db")
+      database_file = argv[++i];
+    else if (arg == "--cache")
+      cache_directory = argv[++i];
+    else if (arg == "--follow")
+      follow = true;
+    else if (arg == "--batch")
+      batch_spec = argv[++i];
+    else if (arg == "--jobs") {
+      const auto threads = parse_number(argv[++i], std::numeric_limits<std::size_t>::max());
+      if (not threads)
+        return usage("--jobs expects a number of threads, not " + std::string{argv[i]});
+      jobs = *threads;
+    } else if (arg == "--memory-limit") {
+      const auto mebibytes = parse_number(argv[++i], net::ancillarycat::waver::arena::unlimited >> 20);
+      if (not mebibytes)
+        return usage("--memory-limit expects a number of MiB, not " + std::string{argv[i]});
+      memory_limit = *mebibytes << 20;
+    } else if (arg.starts_with("--"))
+      return usage("unknown option " + std::string{arg});
+    else
+      positionals.emplace_back(arg);
+  }
+  if (batch_spec.empty() ? positionals.empty() or positionals.size() > 2 : positionals.size() > 1)
+    return usage("unknown command line arguments");
+  if (not batch_spec.empty())
+    return run_batch(batch_spec, positionals.empty() ? std::filesystem::path{} : positionals.front(), options, jobs,
+                     cache_directory, memory_limit);
+  source_file = positionals.front();
+  if (positionals.size() == 2)
+    output_file = positionals.back();
+  else {
     output_file = source_file;
     output_file.replace_extension(".json");
   }
-  if (argc == 3) {
-    source_file = argv[1];
-    output_file = argv[2];
+  if (print or not stats_file.empty()) {
+    if (not parse_stats::enabled)
+      fmt::println("Waver: built without WAVER_ENABLE_STATS, the stats will be empty");
+    options.stats = &stats;
+  }
+  // outlives everything allocated from it below
+  auto memory = net::ancillarycat::waver::arena{memory_limit};
+  if (memory_limit != net::ancillarycat::waver::arena::unlimited)
+    options.memory = &memory;
+  if (follow) {
+    auto tail = net::ancillarycat::waver::follower{source_file, options};
+    for (;;) {
+      const auto added = tail.update();
+      if (not added.ok()) {
+        fmt::println("Failed to parse the VCD file: {}", added.status().message().data());
+        return EXIT_FAILURE;
+      }
+      if (*added)
+        print_changes(tail.dump(), *added);
+      (void)tail.wait(std::chrono::seconds{1});
+    }
   }
-  const auto res = net::ancillarycat::waver::value_change_dump::parse(source_file);
+  using net::ancillarycat::waver::waveform_db;
+  auto cache = net::ancillarycat::waver::parse_cache{cache_directory};
+  if (not cache_directory.empty())
+    options.cache = &cache;
+  const auto res = [&]() -> net::ancillarycat::waver::value_change_dump::expected_t {
+    if (not waveform_db::is_database(source_file))
+      return net::ancillarycat::waver::value_change_dump::parse(source_file, options);
+    const auto db = waveform_db::open(source_file);
+    if (not db.ok())
+      return db.status();
+    try {
+      return db->to_dump(options.allocator());
+    } catch (const std::bad_alloc &) {
+      return absl::ResourceExhaustedError("The database does not fit in the memory limit");
+    }
+  }();
   if (not res.ok()) {
     fmt::println("Failed to parse the VCD file: {}", res.status().message().data());
     return EXIT_FAILURE;
   }
-  const auto    j = res->as_json();
-  std::ofstream output(output_file);
-  output << j.dump(4);
+  if (not database_file.empty()) {
+    if (const auto written = waveform_db::write(*res, database_file); not written.ok()) {
+      fmt::println("Failed to write the database: {}", written.message().data());
+      return EXIT_FAILURE;
+    }
+  }
+  std::ofstream output(output_file, std::ios::binary);
+  {
+    WAVER_STATS(const auto timer = parse_stats::timer{options.stats, parse_stats::kSerialize};)
+    res->write_json(output, 4);
+    output.flush();
+  }
+  if (not output) {
+    fmt::println("Failed to write to {}", output_file.string());
+    return EXIT_FAILURE;
+  }
+  WAVER_STATS(stats[parse_stats::kSerialize].bytes = static_cast<std::size_t>(output.tellp());
+              stats[parse_stats::kSerialize].changes = res->value_changes.event_count();)
   fmt::println("Successfully wrote to {}", output_file.string());
+  if (print)
+    print_stats(stats);
+  if (not stats_file.empty())
+    std::ofstream(stats_file, std::ios::binary) << nlohmann::json(stats).dump(4);
   return 0;
 }
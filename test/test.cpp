@@ -1,3 +1,7 @@
+#include <bitset>
+#include <cstring>
+#include <fstream>
+#include <future>
 #include <gtest/gtest.h>
 #include <net/ancillarycat/waver/waver.hpp>
 
@@ -16,6 +20,1047 @@ TEST(waver, test) {
   std::println("{}", json.dump(2));
 }
 
+TEST(waver, mapped_file) {
+  using namespace net::ancillarycat::waver;
+  const auto path = std::filesystem::temp_directory_path() / "waver_mapped_file_test.vcd";
+  std::ofstream(path, std::ios::binary) << vcd_string;
+
+  auto from_file   = value_change_dump::parse(path);
+  auto from_memory = value_change_dump::parse(vcd_string);
+  ASSERT_TRUE(from_file.ok());
+  ASSERT_TRUE(from_memory.ok());
+  ASSERT_EQ(from_file->as_json(), from_memory->as_json());
+  std::filesystem::remove(path);
+}
+
+TEST(waver, tokenizer_kernels) {
+  using namespace net::ancillarycat::waver;
+  // every separator, tokens straddling the 64-byte blocks, and bytes >= 0x80
+  auto text = std::string{};
+  for (auto i = 0; i < 100; ++i)
+    text.append(i % 7, 'a').append(1, " \t\r\n\v\f"[i % 6]).append("\x80\xff#1"sv.substr(0, i % 5));
+
+  const auto split_with = [&](const tokenizer::separator_mask_t kernel) {
+    auto tokens = std::vector<std::string_view>{};
+    tokenizer::split(text, [&](auto token) { tokens.emplace_back(token); }, kernel);
+    return tokens;
+  };
+  const auto expected = split_with(&tokenizer::separator_mask_scalar);
+  ASSERT_FALSE(expected.empty());
+  ASSERT_EQ(split_with(tokenizer::separator_mask()), expected);
+}
+
+TEST(waver, signal_table) {
+  using namespace net::ancillarycat::waver;
+  ASSERT_EQ(signal_table::decode("!"), 1u);
+  ASSERT_EQ(signal_table::decode("~"), 94u);
+  ASSERT_EQ(signal_table::decode("!!"), 95u);
+  ASSERT_FALSE(signal_table::decode(""));
+  ASSERT_FALSE(signal_table::decode("a b"));
+
+  auto signals = signal_table{};
+  ASSERT_EQ(signals.intern("!"), 0u);
+  ASSERT_EQ(signals.intern("!!"), 1u);
+  ASSERT_EQ(signals.intern("!"), 0u);
+  ASSERT_EQ(signals.intern("a_very_long_identifier"), 2u);
+  ASSERT_EQ(signals.find("!!"), 1u);
+  ASSERT_EQ(signals.find("a_very_long_identifier"), 2u);
+  ASSERT_EQ(signals.find("#"), invalid_signal_id);
+  ASSERT_EQ(signals.code(1), "!!");
+}
+
+TEST(waver, dumpvars_and_long_identifiers) {
+  using namespace net::ancillarycat::waver;
+  auto vcd = value_change_dump::parse(std::string{R"(
+$scope module top $end
+$var wire 1 ! clk $end
+$var wire 8 !# bus [7:0] $end
+$upscope $end
+$enddefinitions $end
+#0
+$dumpvars
+0!
+bx !#
+$end
+#5
+1!
+b101 !#
+)"});
+  ASSERT_TRUE(vcd.ok());
+  const auto json = vcd->as_json();
+  // values are extended to the declared width
+  ASSERT_EQ(json["dumpvars"][0][1], json_t::array({"!#", "bxxxxxxxx"}));
+  ASSERT_EQ(json["value_changes"]["5"]["!"], "1");
+  ASSERT_EQ(json["value_changes"]["5"]["!#"], "b00000101");
+}
+
+TEST(waver, event_log) {
+  using namespace net::ancillarycat::waver;
+  auto vcd = value_change_dump::parse(vcd_string);
+  ASSERT_TRUE(vcd.ok());
+  const auto &changes = vcd->value_changes;
+  ASSERT_EQ(changes.size(), 4u);
+
+  auto times = std::vector<timestamp::time_t>{};
+  auto count = std::size_t{0};
+  for (const auto timestamp : changes.timestamps(2, 3)) {
+    times.emplace_back(timestamp.time);
+    count += timestamp.changes.size();
+  }
+  ASSERT_EQ(times, (std::vector<timestamp::time_t>{2, 3}));
+  ASSERT_EQ(count, 13u + 6u);
+
+  const auto last = changes[2];
+  ASSERT_EQ(vcd->header.signal_codes().code(last.changes.front().signal), "+");
+  ASSERT_EQ(changes.value(last.changes.front()).to_string(), "b010");
+}
+
+TEST(waver, four_state_value) {
+  using namespace net::ancillarycat::waver;
+  const auto wide = four_state_value::from_vcd("b1xz0" + std::string(96, '1'), 100);
+  ASSERT_TRUE(wide);
+  ASSERT_EQ(wide->width(), 100u);
+  ASSERT_EQ(wide->words(), 2u);
+  ASSERT_EQ(wide->bit(99), '1');
+  ASSERT_EQ(wide->bit(98), 'x');
+  ASSERT_EQ(wide->bit(97), 'z');
+  ASSERT_EQ(wide->bit(96), '0');
+  ASSERT_FALSE(wide->is_known());
+  ASSERT_EQ(wide->to_string(), "b1xz0" + std::string(96, '1'));
+
+  // extension follows the leftmost digit for x and z, and pads with 0 otherwise
+  ASSERT_EQ(four_state_value::from_vcd("bz1", 4)->to_string(), "bzzz1");
+  ASSERT_EQ(four_state_value::from_vcd("b11", 4)->to_string(), "b0011");
+  ASSERT_EQ(four_state_value::from_vcd("X", 1)->to_string(), "x");
+  // a 1-bit vector is written back as a scalar
+  ASSERT_EQ(four_state_value::from_vcd("b1", 1)->to_string(), "1");
+  ASSERT_EQ(four_state_value::from_vcd("r2.5", 64)->to_real(), 2.5);
+  ASSERT_FALSE(four_state_value::from_vcd("b012", 3));
+  ASSERT_EQ(*four_state_value::from_vcd("b0101", 4), *four_state_value::from_vcd("b101", 4));
+}
+
+TEST(waver, streaming_lexer) {
+  using namespace net::ancillarycat::waver;
+  const auto path = std::filesystem::temp_directory_path() / "waver_streaming_lexer_test.vcd";
+  std::ofstream(path, std::ios::binary) << vcd_string;
+
+  auto expected = value_change_dump::parse(vcd_string);
+  ASSERT_TRUE(expected.ok());
+  // tiny windows, so that plenty of tokens straddle two of them
+  for (const auto window_size : {1uz, 7uz, 64uz, lexer<>::default_window_size}) {
+    auto streamed = value_change_dump::parse(path, {.streaming = true, .window_size = window_size});
+    ASSERT_TRUE(streamed.ok());
+    ASSERT_EQ(streamed->as_json(), expected->as_json());
+  }
+  std::filesystem::remove(path);
+}
+
+TEST(waver, json_writer) {
+  using namespace net::ancillarycat::waver;
+  auto vcd = value_change_dump::parse(vcd_string);
+  ASSERT_TRUE(vcd.ok());
+  const auto expected = vcd->as_json();
+  // both layouts of the streamed output have to parse back to the DOM
+  for (const auto indent : {-1, 4}) {
+    auto output = std::ostringstream{};
+    vcd->write_json(output, indent);
+    ASSERT_EQ(json_t::parse(output.str()), expected);
+  }
+
+  // a repeated timestamp, and a signal changing twice within one, are merged alike, the last value winning
+  const auto repeated =
+    value_change_dump::parse(std::string{"$scope module top $end $var wire 1 ! a $end $var wire 2 \" b $end $upscope "
+                                         "$end $enddefinitions $end\n#0\n0!\n#5\n1!\nb01 \"\n0!\n#5\nb10 \"\n"
+                                         "#7\nb1 !\n"});
+  ASSERT_TRUE(repeated.ok());
+  auto output = std::ostringstream{};
+  repeated->write_json(output);
+  const auto streamed = output.str();
+  ASSERT_EQ(json_t::parse(streamed), repeated->as_json());
+  ASSERT_EQ(json_t::parse(streamed)["value_changes"]["5"], (json_t{{"!", "0"}, {"\"", "b10"}}));
+  ASSERT_EQ(streamed.find("\"5\""), streamed.rfind("\"5\""));
+  ASSERT_EQ(json_t::parse(streamed)["value_changes"]["7"]["!"], "1");
+}
+
+TEST(waver, parallel_body) {
+  using namespace net::ancillarycat::waver;
+  const auto expected = value_change_dump::parse(vcd_string);
+  ASSERT_TRUE(expected.ok());
+  // tiny slices so that every timestamp ends up on its own worker
+  for (const auto threads : {2uz, 3uz, 64uz}) {
+    const auto vcd = value_change_dump::parse(vcd_string, {.threads = threads, .min_chunk_size = 1});
+    ASSERT_TRUE(vcd.ok());
+    ASSERT_EQ(vcd->value_changes.event_count(), expected->value_changes.event_count());
+    ASSERT_EQ(vcd->as_json(), expected->as_json());
+  }
+
+  // a `#` line inside a `$comment` of the body is no place to cut
+  const auto commented = std::string{"$scope module top $end $var wire 1 ! a $end $upscope $end $enddefinitions $end\n"
+                                     "#0\n0!\n$comment\n#5\n1!\n$end\n#10\n1!\n$comment\n#15\n"};
+  const auto serial    = value_change_dump::parse(commented + "$end\n#20\n0!\n");
+  ASSERT_TRUE(serial.ok());
+  for (const auto byte_scanner : {true, false}) {
+    const auto vcd = value_change_dump::parse(commented + "$end\n#20\n0!\n",
+                                              {.threads = 4, .min_chunk_size = 1, .byte_scanner = byte_scanner});
+    ASSERT_TRUE(vcd.ok()) << vcd.status();
+    ASSERT_EQ(vcd->as_json(), serial->as_json());
+    ASSERT_FALSE(value_change_dump::parse(commented, {.threads = 4, .min_chunk_size = 1, .byte_scanner = byte_scanner})
+                   .ok());
+  }
+}
+
+TEST(waver, signal_filter) {
+  using namespace net::ancillarycat::waver;
+  ASSERT_TRUE(signal_filter::glob("top.*.c?rry", "top.alu.carry"));
+  ASSERT_TRUE(signal_filter::glob("*", ""));
+  ASSERT_FALSE(signal_filter::glob("top.*.carry", "top.carry"));
+  ASSERT_TRUE(signal_filter{"top.alu"}.matches("top.alu.sub.carry"));
+  ASSERT_FALSE(signal_filter{"top.al"}.matches("top.alu.carry"));
+
+  const auto source = std::string{R"(
+$scope module top $end
+$var wire 1 ! clk $end
+$scope module alu $end
+$var wire 4 " lhs $end
+$var wire 1 # carry $end
+$upscope $end
+$upscope $end
+$enddefinitions $end
+#0
+$dumpvars
+0!
+b0000 "
+0#
+$end
+#1
+1!
+b0101 "
+1#
+)"};
+  for (const auto threads : {1uz, 2uz}) {
+    const auto vcd =
+      value_change_dump::parse(source, {.threads = threads, .min_chunk_size = 1, .filter = {"top.alu.*", "*.clk"}});
+    ASSERT_TRUE(vcd.ok());
+    const auto json = vcd->as_json();
+    ASSERT_EQ(json["dumpvars"][0].size(), 3u);
+    ASSERT_EQ(json["value_changes"]["1"].size(), 3u);
+  }
+  const auto vcd = value_change_dump::parse(source, {.filter = {"top.alu"}});
+  ASSERT_TRUE(vcd.ok());
+  const auto json = vcd->as_json();
+  ASSERT_EQ(json["value_changes"]["1"], (json_t{{"\"", "b0101"}, {"#", "1"}}));
+  ASSERT_EQ(json["dumpvars"][0].size(), 2u);
+}
+
+TEST(waver, parse_stats) {
+  using namespace net::ancillarycat::waver;
+  for (const auto threads : {1uz, 2uz}) {
+    auto       stats = parse_stats{};
+    const auto vcd   = value_change_dump::parse(vcd_string, {.threads = threads, .min_chunk_size = 1, .stats = &stats});
+    ASSERT_TRUE(vcd.ok());
+    const auto json = json_t(stats);
+    ASSERT_TRUE(json.contains("body"));
+    if constexpr (parse_stats::enabled) {
+      ASSERT_EQ(stats[parse_stats::kLoad].bytes, vcd_string.size());
+      ASSERT_EQ(stats[parse_stats::kLex].bytes + stats[parse_stats::kBody].bytes, vcd_string.size());
+      ASSERT_GT(stats[parse_stats::kLex].tokens, 0u);
+      ASSERT_EQ(stats[parse_stats::kBody].changes, vcd->value_changes.event_count());
+      ASSERT_GT(stats[parse_stats::kBody].peak_bytes, 0u);
+    } else
+      ASSERT_EQ(json["body"]["changes"], 0);
+  }
+
+  // a stream is loaded while it is lexed, its bytes count all the same
+  const auto path = std::filesystem::temp_directory_path() / "waver_parse_stats_test.vcd";
+  std::ofstream(path, std::ios::binary) << vcd_string;
+  auto stats = parse_stats{};
+  ASSERT_TRUE(value_change_dump::parse(path, {.streaming = true, .window_size = 64, .stats = &stats}).ok());
+  if constexpr (parse_stats::enabled) {
+    ASSERT_EQ(stats[parse_stats::kLoad].bytes, vcd_string.size());
+  }
+  std::filesystem::remove(path);
+}
+
+TEST(waver, value_index) {
+  using namespace net::ancillarycat::waver;
+  const auto vcd = value_change_dump::parse(std::string{R"(
+$scope module top $end
+$var wire 1 ! clk $end
+$var wire 4 " bus [3:0] $end
+$var wire 1 # rst $end
+$upscope $end
+$enddefinitions $end
+#0
+$dumpvars
+0!
+b0000 "
+$end
+#10
+1!
+#20
+0!
+b0101 "
+#30
+$dumpall
+1!
+b0101 "
+1#
+$end
+#40
+0!
+b1111 "
+)"});
+  ASSERT_TRUE(vcd.ok());
+  const auto clk = vcd->find_signal("top.clk");
+  const auto bus = vcd->find_signal("top.bus");
+  const auto rst = vcd->find_signal("top.rst");
+  ASSERT_NE(bus, invalid_signal_id);
+  ASSERT_EQ(vcd->find_signal("top.nope"), invalid_signal_id);
+
+  // every interval, down to a checkpoint after each event, must answer the same
+  for (const auto interval : {1uz, 2uz, 1000uz}) {
+    const auto index = vcd->index(interval);
+    ASSERT_EQ(index.value_at(clk, 0).to_string(), "0");
+    ASSERT_EQ(index.value_at(clk, 15).to_string(), "1");
+    ASSERT_EQ(index.value_at(bus, 19).to_string(), "b0000");
+    ASSERT_EQ(index.value_at(bus, 20).to_string(), "b0101");
+    ASSERT_EQ(index.value_at(rst, 29).to_string(), "x");
+    ASSERT_EQ(index.value_at(rst, 1000).to_string(), "1");
+    const auto state = index.state_at(35);
+    ASSERT_EQ(state[clk].to_string(), "1");
+    ASSERT_EQ(state[bus].to_string(), "b0101");
+    ASSERT_EQ(index.state_at(40)[bus].to_string(), "b1111");
+  }
+  ASSERT_EQ(vcd->index(1000).checkpoints(), 1u); // the `$dumpall` only
+}
+
+TEST(waver, seek_index) {
+  using namespace net::ancillarycat::waver;
+  auto source = std::string{"$scope module top $end\n$var wire 1 ! clk $end\n$var wire 8 \" count [7:0] $end\n"
+                            "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n0!\nb0 \"\n$end\n"};
+  for (auto time = 1; time < 200; ++time) {
+    source.append("#").append(std::to_string(time * 10)).append("\n");
+    if (time % 50 == 0)
+      source.append("$dumpall\n");
+    source.append(time % 2 ? "1!\n" : "0!\n");
+    source.append("b").append(std::bitset<8>(time).to_string()).append(" \"\n");
+    if (time % 50 == 0)
+      source.append("$end\n");
+  }
+  const auto path = std::filesystem::temp_directory_path() / "waver_seek_index_test.vcd";
+  std::ofstream(path, std::ios::binary) << source;
+  std::filesystem::remove(seek_index::sidecar_path(path));
+
+  const auto full = value_change_dump::parse(source);
+  ASSERT_TRUE(full.ok());
+  const auto index = full->index();
+  for (const auto pass : {0, 1}) {
+    // the first pass builds the sidecar, the second one loads it
+    ASSERT_EQ(std::filesystem::exists(seek_index::sidecar_path(path)), pass == 1);
+    for (const auto range : {time_range{1234, 1500}, time_range{0, 30}, time_range{1990, 5000}}) {
+      const auto window = value_change_dump::parse(path, range, {.seek_interval = 8});
+      ASSERT_TRUE(window.ok());
+      const auto expected = full->value_changes.window(range.first, range.last);
+      ASSERT_EQ(window->value_changes.event_count(), expected.event_count());
+      ASSERT_EQ(window->value_changes.size(), expected.size());
+      // the state at the start of the window is carried in the dumpvars
+      const auto state = window->index().state_at(range.first);
+      ASSERT_EQ(state, index.state_at(range.first));
+    }
+  }
+  const auto sidecar = seek_index::load(seek_index::sidecar_path(path), path, 8);
+  ASSERT_TRUE(sidecar.ok());
+  ASSERT_EQ(sidecar->entries().size(), 25u);
+  ASSERT_EQ(sidecar->interval(), 8u);
+  // the `$dumpall` at #500 is the full state of the entries after it
+  ASSERT_EQ(sidecar->entries()[7].full_state, source.find("#500\n"));
+  // built with another interval
+  ASSERT_FALSE(seek_index::load(seek_index::sidecar_path(path), path).ok());
+
+  // a sidecar cut short, or whose entries point past the dump, is rejected rather than trusted
+  const auto bytes = [&] {
+    auto file = std::ifstream{seek_index::sidecar_path(path), std::ios::binary};
+    return std::string{std::istreambuf_iterator<char>{file}, {}};
+  }();
+  const auto entries_at = bytes.size() - 25 * sizeof(seek_index::entry);
+  const auto rewrite    = [&](const std::string &content) {
+    std::ofstream(seek_index::sidecar_path(path), std::ios::binary | std::ios::trunc) << content;
+    return seek_index::load(seek_index::sidecar_path(path), path, 8);
+  };
+  ASSERT_FALSE(rewrite(bytes.substr(0, bytes.size() - 1)).ok());
+  auto huge = bytes;
+  std::ranges::fill(huge.begin() + static_cast<std::ptrdiff_t>(entries_at) - 8,
+                    huge.begin() + static_cast<std::ptrdiff_t>(entries_at), '\xff');
+  ASSERT_FALSE(rewrite(huge).ok());
+  auto past = bytes;
+  const auto beyond = static_cast<std::uint64_t>(source.size() + 1);
+  std::memcpy(past.data() + entries_at + offsetof(seek_index::entry, offset), &beyond, sizeof beyond);
+  ASSERT_FALSE(rewrite(past).ok());
+  // a rejected sidecar is rebuilt
+  ASSERT_TRUE(value_change_dump::parse(path, {1234, 1500}, {.seek_interval = 8}).ok());
+  ASSERT_TRUE(seek_index::load(seek_index::sidecar_path(path), path, 8).ok());
+}
+
+TEST(waver, waveform_db) {
+  using namespace net::ancillarycat::waver;
+  auto source = vcd_string;
+  // wide, real and string values, and enough changes for several blocks
+  source.replace(source.find("$enddefinitions"), 0, "$scope module extra $end\n$var wire 70 { wide [69:0] $end\n"
+                                                    "$var wire 64 } level $end\n$upscope $end\n");
+  for (auto time = 100; time < 300; ++time)
+    source.append("#").append(std::to_string(time)).append("\nb1x").append(std::bitset<8>(time).to_string())
+      .append(time % 7 ? " {\nr" + std::to_string(time) + ".5 }\n" : " {\nsidle }\n");
+  source.append("#300\n$dumpall\nb0 {\nr0.5 }\n$end\n");
+  const auto vcd = value_change_dump::parse(source);
+  ASSERT_TRUE(vcd.ok());
+
+  const auto path = std::filesystem::temp_directory_path() / "waver_waveform_db_test.wdb";
+  ASSERT_EQ(waveform_db::write(*vcd, path, 16), OkStatus());
+  ASSERT_TRUE(waveform_db::is_database(path));
+  const auto db = waveform_db::open(path);
+  ASSERT_TRUE(db.ok());
+
+  // a full round trip
+  const auto dump = db->to_dump();
+  ASSERT_TRUE(dump.ok());
+  ASSERT_EQ(dump->as_json(), vcd->as_json());
+
+  // queries straight from the mapping
+  ASSERT_EQ(db->signal_count(), vcd->header.signal_codes().size());
+  ASSERT_EQ(db->timestamps().size(), vcd->value_changes.size());
+  ASSERT_EQ(db->roots().size(), 2u);
+  const auto wide = db->find_signal("extra.wide");
+  ASSERT_EQ(wide, vcd->find_signal("extra.wide"));
+  ASSERT_EQ(db->find_signal("TOP.nope"), invalid_signal_id);
+  const auto index = vcd->index();
+  for (signal_id_t signal = 0; signal < db->signal_count(); ++signal)
+    for (const auto time : {0uz, 1uz, 2uz, 5uz, 150uz, 200uz, 1000uz})
+      ASSERT_EQ(db->value_at(signal, time), index.value_at(signal, time)) << signal << " @ " << time;
+  const auto changes = db->changes(wide, {120, 129});
+  ASSERT_EQ(changes.size(), 10u);
+  ASSERT_EQ(changes.front().first, 120u);
+  ASSERT_EQ(changes.front().second, index.value_at(wide, 120));
+
+  // anything but an intact database is rejected: the time index, whose events run from one offset to the next...
+  const auto times    = db->timestamps().size();
+  const auto pristine = std::string{std::istreambuf_iterator{std::ifstream{path, std::ios::binary}.rdbuf()}, {}};
+  const auto corrupt  = [&](const std::size_t section, const std::size_t record, const std::uint64_t value) {
+    // the extents of the sections follow the magic, four 32-bit fields and three string references
+    auto extent = std::uint64_t{};
+    std::memcpy(&extent, pristine.data() + 72 + 16 * section, sizeof extent);
+    auto damaged = pristine;
+    std::memcpy(damaged.data() + extent + 8 * record, &value, sizeof value);
+    std::ofstream{path, std::ios::binary | std::ios::trunc} << damaged;
+    return waveform_db::open(path);
+  };
+  ASSERT_TRUE(corrupt(7, times - 1, 0).status().message().find("Time index out of bounds") == 0);
+  ASSERT_TRUE(corrupt(7, 1, 1u << 20).status().message().find("Time index out of bounds") == 0);
+  // ...and the `$dumpall` marks
+  ASSERT_TRUE(corrupt(9, 0, 1u << 20).status().message().find("Dumpall mark out of bounds") == 0);
+  ASSERT_TRUE(corrupt(9, 0, 0).ok());
+  // ...and the number of changes in a block, the fourth field of its record
+  ASSERT_TRUE(corrupt(4, 3, std::uint64_t{1} << 62).status().message().find("Block out of bounds") == 0);
+  ASSERT_TRUE(corrupt(4, 3, 0).status().message().find("Block counts do not match") == 0);
+  std::ofstream{path, std::ios::binary | std::ios::trunc} << pristine;
+  ASSERT_TRUE(waveform_db::open(path).ok());
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+  ASSERT_FALSE(waveform_db::open(path).ok());
+  std::filesystem::remove(path);
+}
+
+TEST(waver, parse_cache) {
+  using namespace net::ancillarycat::waver;
+  const auto directory = std::filesystem::temp_directory_path() / "waver_parse_cache_test";
+  const auto first     = std::filesystem::temp_directory_path() / "waver_parse_cache_first.vcd";
+  const auto second    = std::filesystem::temp_directory_path() / "waver_parse_cache_second.vcd";
+  std::filesystem::remove_all(directory);
+  std::ofstream(first, std::ios::binary) << vcd_string;
+  std::ofstream(second, std::ios::binary) << vcd_string << "#5\nb0001 )\n";
+
+  auto cache = parse_cache{directory};
+  ASSERT_FALSE(cache.load(first).ok());
+  const auto parsed = value_change_dump::parse(first, {.cache = &cache});
+  ASSERT_TRUE(parsed.ok());
+  // the second parse is a hit, and equals the first
+  const auto cached = cache.load(first);
+  ASSERT_TRUE(cached.ok());
+  ASSERT_EQ(cached->as_json(), parsed->as_json());
+  ASSERT_EQ(value_change_dump::parse(first, {.cache = &cache})->as_json(), parsed->as_json());
+
+  // same header, different file: a different key
+  ASSERT_NE(*parse_cache::key(first), *parse_cache::key(second));
+  ASSERT_TRUE(value_change_dump::parse(second, {.cache = &cache}).ok());
+  ASSERT_TRUE(cache.load(second).ok());
+
+  // a change of the dump is a miss
+  std::ofstream(first, std::ios::binary | std::ios::app) << "#6\nb0010 )\n";
+  ASSERT_FALSE(cache.load(first).ok());
+
+  // only the entry used last fits
+  const auto size = std::filesystem::file_size(cache.entry(*parse_cache::key(second)));
+  cache.evict(size);
+  ASSERT_TRUE(cache.load(second).ok());
+  ASSERT_EQ(std::distance(std::filesystem::directory_iterator{directory}, {}), 1);
+
+  std::filesystem::remove_all(directory);
+  std::filesystem::remove(first);
+  std::filesystem::remove(second);
+}
+
+TEST(waver, compressed_input) {
+  using namespace net::ancillarycat::waver;
+  // larger than a buffer of the ring, so that decompression and lexing overlap
+  auto source = vcd_string;
+  for (auto time = 100; source.size() < 3 * decompressor::default_buffer_size; ++time)
+    source.append("#").append(std::to_string(time)).append(time % 2 ? "\nb0101 )\n" : "\nb1010 )\n");
+  const auto expected = value_change_dump::parse(source);
+  ASSERT_TRUE(expected.ok());
+  ASSERT_EQ(decompressor::detect("\x1f\x8b\x08"), compression::kGzip);
+  ASSERT_EQ(decompressor::detect("$date"), compression::kNone);
+
+  const auto check = [&](const std::filesystem::path &path) {
+    ASSERT_EQ(file_reader<>{path}.get_contents(), source);
+    for (const auto streaming : {false, true}) {
+      const auto vcd = value_change_dump::parse(path, {.streaming = streaming, .threads = 0});
+      ASSERT_TRUE(vcd.ok()) << vcd.status();
+      ASSERT_EQ(vcd->value_changes.event_count(), expected->value_changes.event_count());
+      ASSERT_EQ(vcd->as_json(), expected->as_json());
+    }
+  };
+#ifdef WAVER_USE_ZLIB
+  {
+    // two gzip members, as `cat a.gz b.gz` makes
+    const auto path = std::filesystem::temp_directory_path() / "waver_compressed_input_test.vcd.gz";
+    const auto half = source.size() / 2;
+    for (const auto [offset, mode] : {std::pair{0uz, "wb"}, std::pair{half, "ab"}}) {
+      auto *const file = gzopen(path.string().c_str(), mode);
+      const auto  part = std::string_view{source}.substr(offset, offset ? std::string_view::npos : half);
+      ASSERT_EQ(gzwrite(file, part.data(), static_cast<unsigned>(part.size())), static_cast<int>(part.size()));
+      gzclose(file);
+    }
+    check(path);
+
+    // a truncated file is an error, not a shorter dump
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 100);
+    const auto truncated = value_change_dump::parse(path);
+    ASSERT_FALSE(truncated.ok());
+    ASSERT_EQ(truncated.status().code(), absl::StatusCode::kDataLoss);
+    std::filesystem::remove(path);
+  }
+#endif
+#ifdef WAVER_USE_ZSTD
+  {
+    const auto path       = std::filesystem::temp_directory_path() / "waver_compressed_input_test.vcd.zst";
+    auto       compressed = std::string(ZSTD_compressBound(source.size()), '\0');
+    compressed.resize(ZSTD_compress(compressed.data(), compressed.size(), source.data(), source.size(), 3));
+    std::ofstream(path, std::ios::binary) << compressed;
+    check(path);
+    std::filesystem::remove(path);
+  }
+#endif
+}
+
+TEST(waver, follower) {
+  using namespace net::ancillarycat::waver;
+  const auto path     = std::filesystem::temp_directory_path() / "waver_follower_test.vcd";
+  const auto expected = value_change_dump::parse(vcd_string);
+  ASSERT_TRUE(expected.ok());
+  std::filesystem::remove(path);
+
+  auto follow = follower{path, {.threads = 2, .min_chunk_size = 1}, 2};
+  ASSERT_FALSE(follow.wait(std::chrono::milliseconds{1}));
+  ASSERT_EQ(*follow.update(), 0u); // not created yet
+  {
+    // append in pieces that cut through the header, lines and timestamps
+    auto output = std::ofstream{path, std::ios::binary};
+    auto       events     = 0uz;
+    const auto header_end = vcd_string.find("$enddefinitions $end") + "$enddefinitions $end"sv.size();
+    for (auto offset = 0uz; offset < vcd_string.size(); offset += 37) {
+      output << vcd_string.substr(offset, 37) << std::flush;
+      ASSERT_TRUE(follow.wait(std::chrono::milliseconds{1000}));
+      const auto added = follow.update();
+      ASSERT_TRUE(added.ok()) << added.status();
+      events += *added;
+      ASSERT_EQ(follow.dump().value_changes.event_count(), events);
+      // only whole timestamps are committed
+      ASSERT_TRUE(follow.committed() <= header_end or vcd_string[follow.committed()] == '#');
+    }
+  }
+  ASSERT_TRUE(follow.ready());
+  ASSERT_NE(follow.dump().as_json(), expected->as_json()); // `#4` is held back
+  ASSERT_TRUE(follow.flush().ok());
+  ASSERT_EQ(follow.committed(), vcd_string.size());
+  ASSERT_EQ(follow.dump().as_json(), expected->as_json());
+  const auto index = expected->index(2);
+  const auto bus   = expected->find_signal("TOP.ALU4.sel");
+  for (const auto time : {0, 1, 2, 3, 10, 1000})
+    ASSERT_EQ(follow.index().value_at(bus, time), index.value_at(bus, time));
+
+  // a rewritten file is followed from its beginning
+  std::ofstream(path, std::ios::binary) << vcd_string.substr(0, vcd_string.find("#2"));
+  ASSERT_TRUE(follow.flush().ok());
+  const auto restarted = value_change_dump::parse(vcd_string.substr(0, vcd_string.find("#2")));
+  ASSERT_EQ(follow.dump().as_json(), restarted->as_json());
+
+  // wait() wakes up on an append rather than at its timeout
+  auto writer = std::jthread{[&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    std::ofstream(path, std::ios::binary | std::ios::app) << "#5\n";
+  }};
+  ASSERT_TRUE(follow.wait(std::chrono::seconds{10}));
+  writer.join();
+  std::filesystem::remove(path);
+}
+
+TEST(waver, stream) {
+  using namespace net::ancillarycat::waver;
+  auto source = vcd_string;
+  source.insert(source.find("$enddefinitions $end") + "$enddefinitions $end"sv.size(),
+                "\n$dumpvars\nb0000 )\n0#\n$end");
+  const auto expected = value_change_dump::parse(source);
+  ASSERT_TRUE(expected.ok());
+  const auto &codes   = expected->header.signal_codes();
+  auto        changes = std::vector<std::tuple<timestamp::time_t, signal_id_t, std::string>>{
+    {0, codes.find(")"), "b0000"}, {0, codes.find("#"), "0"}};
+  for (const auto timestamp : expected->value_changes.timestamps())
+    for (const auto &event : timestamp.changes)
+      changes.emplace_back(timestamp.time, event.signal, expected->value_changes.value(event).to_string());
+
+  // a window smaller than most lines, so that values straddle refills
+  const auto path = std::filesystem::temp_directory_path() / "waver_stream_test.vcd";
+  std::ofstream(path, std::ios::binary) << source;
+  const auto check = [&](generator<stream_item> items) {
+    const value_change_dump *header = nullptr;
+    auto                     seen   = 0uz;
+    for (auto &&item : items) {
+      ASSERT_FALSE(std::holds_alternative<Status>(item)) << std::get<Status>(item);
+      if (const auto *dump = std::get_if<const value_change_dump *>(&item)) {
+        ASSERT_EQ(header, nullptr);
+        header = *dump;
+        ASSERT_EQ(header->find_signal("TOP.ALU4.sel"), expected->find_signal("TOP.ALU4.sel"));
+        ASSERT_EQ(header->value_changes.event_count(), 0u);
+        continue;
+      }
+      ASSERT_NE(header, nullptr);
+      const auto &change = std::get<change_view>(item);
+      const auto  value  = four_state_value::from_vcd(change.value, header->header.signal_codes().width(change.signal));
+      ASSERT_LT(seen, changes.size());
+      ASSERT_EQ(std::tuple(change.time, change.signal, value->to_string()), changes[seen++]);
+    }
+    ASSERT_EQ(seen, changes.size());
+  };
+  check(value_change_dump::stream(source, {.window_size = 7}));
+  check(value_change_dump::stream(path));
+  std::filesystem::remove(path);
+
+  // stopping early, and errors
+  auto items = value_change_dump::stream(vcd_string);
+  ASSERT_TRUE(std::holds_alternative<const value_change_dump *>(*items.begin()));
+  auto bad = value_change_dump::stream(std::string{"$enddefinitions $end\n#0\n1!\n"});
+  auto it  = bad.begin();
+  ASSERT_TRUE(std::holds_alternative<const value_change_dump *>(*it));
+  ++it;
+  ASSERT_TRUE(std::holds_alternative<Status>(*it));
+}
+
+TEST(waver, parse_handler) {
+  using namespace net::ancillarycat::waver;
+  struct counter {
+    void on_scope_begin(scope_kind, std::string_view name) {
+      open.emplace_back(scopes.emplace_back(name));
+    }
+    void on_scope_end() {
+      open.pop_back();
+      ++closed;
+    }
+    void on_var(const var_view &var) { vars.emplace_back(open.back() + "." + std::string{var.name}); }
+    void on_time(timestamp::time_t) { ++times; }
+    void on_dump_begin(std::string_view keyword) { in_dumpvars = keyword == "$dumpvars"sv; }
+    void on_dump_end(std::string_view) { in_dumpvars = false; }
+    void on_change(signal_id_t, std::string_view value) {
+      ++(in_dumpvars ? initial : changes);
+      bytes += value.size();
+    }
+    void on_end() { ended = true; }
+
+    std::vector<std::string> scopes, open, vars;
+    std::size_t              closed = 0, times = 0, initial = 0, changes = 0, bytes = 0;
+    bool                     in_dumpvars = false, ended = false;
+  };
+  static_assert(parse_handler<counter>);
+  static_assert(not parse_handler<time_range>);
+
+  auto source = vcd_string;
+  source.insert(source.find("$enddefinitions $end") + "$enddefinitions $end"sv.size(),
+                "\n$dumpvars\nb0000 )\n0#\n$end");
+  const auto expected = value_change_dump::parse(source);
+  ASSERT_TRUE(expected.ok());
+
+  auto handler = counter{};
+  ASSERT_TRUE(value_change_dump::parse(source, handler).ok());
+  ASSERT_TRUE(handler.ended);
+  ASSERT_TRUE(handler.open.empty());
+  ASSERT_EQ(handler.closed, handler.scopes.size());
+  ASSERT_EQ(handler.scopes.front(), "TOP");
+  ASSERT_NE(std::ranges::find(handler.vars, "ALU4.sel"), handler.vars.end());
+  ASSERT_EQ(handler.times, expected->value_changes.timestamps().size());
+  ASSERT_EQ(handler.initial, 2u);
+  ASSERT_EQ(handler.changes, expected->value_changes.event_count());
+
+  // streamed, the values reach the handler all the same
+  const auto path = std::filesystem::temp_directory_path() / "waver_parse_handler_test.vcd";
+  std::ofstream(path, std::ios::binary) << source;
+  auto streamed = counter{};
+  ASSERT_TRUE(value_change_dump::parse(path, streamed, {.streaming = true, .window_size = 7}).ok());
+  std::filesystem::remove(path);
+  ASSERT_EQ(streamed.vars, handler.vars);
+  ASSERT_EQ(std::tuple(streamed.times, streamed.changes, streamed.bytes),
+            std::tuple(handler.times, handler.changes, handler.bytes));
+
+  // a handler only interested in one callback, and one rejecting a value
+  struct rejecter {
+    bool on_change(signal_id_t, std::string_view value) { return value != "1"sv; }
+  } reject;
+  const auto one_bit =
+    std::string{"$scope module m $end $var wire 1 ! a $end $upscope $end $enddefinitions $end\n#0\n0!\n"};
+  ASSERT_TRUE(value_change_dump::parse(one_bit, reject).ok());
+  ASSERT_FALSE(value_change_dump::parse(one_bit + "#1\n1!\n", reject).ok());
+  auto signals = 0uz;
+  struct {
+    std::size_t &signals;
+    void         on_var(const var_view &) { ++signals; }
+  } declarations{signals};
+  ASSERT_TRUE(value_change_dump::parse(vcd_string, declarations).ok());
+  ASSERT_EQ(signals, handler.vars.size());
+}
+TEST(waver, batch) {
+  using namespace net::ancillarycat::waver;
+  // more tasks than threads, all of them run before wait() returns
+  {
+    auto pool  = thread_pool{3};
+    auto count = std::atomic<std::size_t>{0};
+    for (auto i = 0; i < 100; ++i)
+      pool.submit([&](const std::size_t self) {
+        ASSERT_LT(self, pool.size());
+        ++count;
+      });
+    pool.wait();
+    ASSERT_EQ(count, 100u);
+  }
+  // tasks start in the order they were submitted, the first one holding the only thread until all are queued
+  {
+    auto pool    = thread_pool{1};
+    auto queued  = std::promise<void>{};
+    auto started = std::vector<int>{};
+    pool.submit([&, ready = queued.get_future().share()](std::size_t) {
+      ready.wait();
+      started.emplace_back(0);
+    });
+    for (auto i = 1; i < 6; ++i)
+      pool.submit([&, i](std::size_t) { started.emplace_back(i); });
+    queued.set_value();
+    pool.wait();
+    ASSERT_EQ(started, (std::vector{0, 1, 2, 3, 4, 5}));
+  }
+
+  const auto directory = std::filesystem::temp_directory_path() / "waver_batch_test";
+  const auto outputs   = directory / "json";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  std::ofstream(directory / "a.vcd", std::ios::binary) << vcd_string;
+  std::ofstream(directory / "b.vcd", std::ios::binary) << vcd_string << "#5\nb0001 )\n";
+  std::ofstream(directory / "broken.vcd", std::ios::binary) << "$enddefinitions $end\n#0\n1!\n";
+  std::ofstream(directory / "notes.txt", std::ios::binary) << "not a dump";
+  std::ofstream(directory / "list.txt", std::ios::binary) << "# nightly\na.vcd\n\nb.vcd\tb-out.json\n";
+
+  const auto all = batch::collect(directory, outputs);
+  ASSERT_TRUE(all.ok());
+  ASSERT_EQ(all->size(), 3u);
+  ASSERT_EQ(all->front().output, outputs / "a.json");
+  const auto matching = batch::collect(directory / "?.vcd");
+  ASSERT_TRUE(matching.ok());
+  ASSERT_EQ(matching->size(), 2u);
+  ASSERT_EQ(matching->back().output, directory / "b.json");
+  const auto listed = batch::collect(directory / "list.txt");
+  ASSERT_TRUE(listed.ok());
+  ASSERT_EQ(listed->size(), 2u);
+  ASSERT_EQ(listed->back().output, directory / "b-out.json");
+  ASSERT_EQ(batch::output_of("x/run.vcd.gz", "y"), std::filesystem::path{"y/run.json"});
+  ASSERT_FALSE(batch::collect(directory / "missing.txt").ok());
+
+  // two threads, so that the buffers of a thread are reused for its second file
+  auto       converter = batch{{}, 2};
+  auto       reported  = std::size_t{0};
+  const auto results   = converter.run(*all, [&](const batch::result &) { ++reported; });
+  ASSERT_EQ(results.size(), 3u);
+  ASSERT_EQ(reported, 3u);
+  for (const auto &result : results) {
+    if (result.source.filename() == "broken.vcd") {
+      ASSERT_FALSE(result.status.ok());
+      continue;
+    }
+    ASSERT_TRUE(result.status.ok()) << result.status;
+    const auto expected = value_change_dump::parse(result.source);
+    ASSERT_EQ(nlohmann::json::parse(std::ifstream{result.output}), expected->as_json());
+    ASSERT_EQ(result.changes, expected->value_changes.event_count());
+    ASSERT_EQ(result.bytes, std::filesystem::file_size(result.source));
+  }
+  // on one thread, the largest file is converted first
+  {
+    auto order = std::vector<std::filesystem::path>{};
+    (void)batch{{}, 1}.run(*matching, [&](const batch::result &result) { order.emplace_back(result.source); });
+    ASSERT_EQ(order, (std::vector{directory / "b.vcd", directory / "a.vcd"}));
+  }
+  // again, into the buffers left over
+  const auto again = converter.run(*matching);
+  ASSERT_TRUE(std::ranges::all_of(again, [](const auto &result) { return result.status.ok(); }));
+  // a source that is gone fails, and is not counted as any bytes
+  const auto gone = converter.run({{directory / "gone.vcd", directory / "gone.json"}});
+  ASSERT_FALSE(gone.front().status.ok());
+  ASSERT_EQ(gone.front().bytes, 0u);
+  std::filesystem::remove_all(directory);
+}
+
+TEST(waver, arena) {
+  using namespace net::ancillarycat::waver;
+  const auto expected = value_change_dump::parse(vcd_string);
+  ASSERT_TRUE(expected.ok());
+  auto memory = arena{};
+  {
+    const auto vcd = value_change_dump::parse(vcd_string, {.memory = &memory});
+    ASSERT_TRUE(vcd.ok());
+    ASSERT_EQ(vcd->get_allocator().resource(), &memory);
+    ASSERT_GT(memory.used(), 0u);
+    ASSERT_EQ(vcd->as_json(), expected->as_json());
+    // the slices of the workers are copied onto the arena
+    const auto parallel = value_change_dump::parse(vcd_string, {.threads = 3, .min_chunk_size = 1, .memory = &memory});
+    ASSERT_TRUE(parallel.ok());
+    ASSERT_EQ(parallel->value_changes.get_allocator().resource(), &memory);
+    ASSERT_EQ(parallel->as_json(), expected->as_json());
+    // a copy is on the default resource unless given another allocator
+    const auto copy = *vcd;
+    ASSERT_EQ(copy.get_allocator().resource(), std::pmr::get_default_resource());
+    ASSERT_EQ(copy.as_json(), expected->as_json());
+  }
+  memory.release();
+  ASSERT_EQ(memory.used(), 0u);
+
+  auto tiny      = arena{256};
+  const auto vcd = value_change_dump::parse(vcd_string, {.memory = &tiny});
+  ASSERT_EQ(vcd.status().code(), absl::StatusCode::kResourceExhausted);
+  ASSERT_LE(tiny.used(), tiny.limit());
+  // the handler overload reports it alike, its signal table being on the arena
+  struct counter {
+    void        on_change(signal_id_t, std::string_view) { ++changes; }
+    std::size_t changes = 0;
+  } handler;
+  tiny.release();
+  ASSERT_EQ(value_change_dump::parse(vcd_string, handler, {.memory = &tiny}).code(),
+            absl::StatusCode::kResourceExhausted);
+}
+
+TEST(waver, scope_table) {
+  using namespace net::ancillarycat::waver;
+  // `c` is declared in `top` after `sub` has ended, and the kinds other than module carry ports too
+  const auto vcd = value_change_dump::parse(std::string{"$scope module top $end\n$var wire 1 ! a $end\n"
+                                            "$scope task sub $end\n$var reg 1 \" b $end\n"
+                                            "$scope begin blk $end\n$var reg 1 # d $end\n$upscope $end\n$upscope $end\n"
+                                            "$var wire 1 $ c $end\n$scope function f $end\n$upscope $end\n"
+                                            "$scope fork j $end\n$upscope $end\n$upscope $end\n"
+                                            "$enddefinitions $end\n#0\n0!\n1\"\n0#\n1$\n"});
+  ASSERT_TRUE(vcd.ok());
+  const auto &scopes = vcd->header.hierarchy();
+  ASSERT_EQ(scopes.size(), 5u);
+  ASSERT_EQ(scopes.kind(0), scope_kind::kModule);
+  ASSERT_EQ(scopes.kind(1), scope_kind::kTask);
+  ASSERT_EQ(scopes.kind(2), scope_kind::kBegin);
+  ASSERT_EQ(scopes.kind(3), scope_kind::kFunction);
+  ASSERT_EQ(scopes.kind(4), scope_kind::kFork);
+  ASSERT_EQ(scopes.name(2), "blk");
+  ASSERT_EQ(scopes.parent(2), 1u);
+  ASSERT_EQ(scopes.first_child(0), 1u);
+  ASSERT_EQ(scopes.next_sibling(1), 3u);
+  ASSERT_EQ(scopes.next_sibling(4), scope_table::npos);
+  ASSERT_EQ(scopes.first_child(3), scope_table::npos);
+
+  // ports are grouped by scope, in pre-order
+  const auto names = [](const auto ports) {
+    auto result = std::string{};
+    for (const auto &port : ports)
+      result += port.get_name();
+    return result;
+  };
+  ASSERT_EQ(names(scopes.ports(0)), "ac");
+  ASSERT_EQ(names(scopes.ports(1)), "b");
+  ASSERT_EQ(names(scopes.subtree_ports(1)), "bd");
+  ASSERT_EQ(names(scopes.ports()), "acbd");
+  ASSERT_EQ(scopes.owner(1), 0u);
+  ASSERT_EQ(scopes.owner(3), 2u);
+  ASSERT_EQ(vcd->find_signal("top.c"), vcd->header.signal_codes().find("$"));
+  ASSERT_EQ(vcd->find_signal("top.sub.blk.d"), vcd->header.signal_codes().find("#"));
+  ASSERT_EQ(vcd->find_signal("top.blk.d"), invalid_signal_id);
+
+  const auto expected = vcd->as_json();
+  ASSERT_EQ(expected["scopes"][0]["subscopes"][0]["data"]["ports"]["b"]["type"], port::kRegistor);
+  auto output = std::ostringstream{};
+  vcd->write_json(output, 4);
+  ASSERT_EQ(json_t::parse(output.str()), expected);
+
+  const auto path = std::filesystem::temp_directory_path() / "waver_scope_table_test.wdb";
+  ASSERT_EQ(waveform_db::write(*vcd, path), OkStatus());
+  const auto db = waveform_db::open(path);
+  ASSERT_TRUE(db.ok());
+  const auto dump = db->to_dump();
+  ASSERT_TRUE(dump.ok());
+  ASSERT_EQ(dump->as_json(), expected);
+  std::filesystem::remove(path);
+}
+
+TEST(waver, name_index) {
+  using namespace net::ancillarycat::waver;
+  const auto vcd = value_change_dump::parse(vcd_string);
+  ASSERT_TRUE(vcd.ok());
+  const auto names = vcd->names();
+  // every declaration, aliases included
+  ASSERT_EQ(names.size(), vcd->header.hierarchy().ports().size());
+  for (const auto &declaration : names.all()) {
+    const auto path = names.path(declaration);
+    ASSERT_EQ(names.find(path), vcd->find_signal(path)) << path;
+  }
+  ASSERT_EQ(names.find("TOP.ALU4.cla4.out"), vcd->header.signal_codes().find("1"));
+  ASSERT_EQ(names.find("TOP.ALU4.cla4"), invalid_signal_id);
+  ASSERT_EQ(names.find("TOP.ALU4.cla4.ou"), invalid_signal_id);
+
+  // `)` is declared in four scopes and stored once
+  const auto lhs = names.find("TOP.lhs");
+  ASSERT_EQ(names.aliases(lhs), (std::vector<std::string_view>{"TOP.ALU4.cla4.lhs", "TOP.ALU4.cmp4_identical.lhs",
+                                                                "TOP.ALU4.cmp4_rhs.lhs", "TOP.ALU4.lhs", "TOP.lhs"}));
+
+  const auto paths = [&](const auto declarations) {
+    auto result = std::vector<std::string_view>{};
+    for (const auto &declaration : declarations)
+      result.emplace_back(names.path(declaration));
+    return result;
+  };
+  ASSERT_EQ(paths(names.prefix("TOP.ALU4.cmp4_r")),
+            (std::vector<std::string_view>{"TOP.ALU4.cmp4_rhs.lhs", "TOP.ALU4.cmp4_rhs.out", "TOP.ALU4.cmp4_rhs.rhs"}));
+  ASSERT_EQ(paths(names.prefix("TOP.ALU4.d38.")),
+            (std::vector<std::string_view>{"TOP.ALU4.d38.enable_signal", "TOP.ALU4.d38.in", "TOP.ALU4.d38.out"}));
+  ASSERT_EQ(paths(names.prefix("TOP.ALU4.op_")).size(), 8u);
+  ASSERT_EQ(names.prefix("").size(), names.size());
+  ASSERT_EQ(names.prefix("TOP.").size(), names.size());
+  ASSERT_TRUE(names.prefix("TOP.nope.").empty());
+  ASSERT_TRUE(names.prefix("X").empty());
+
+  // matches of the same signal count once
+  ASSERT_EQ(names.glob("TOP.*.lhs"), std::vector<signal_id_t>{lhs});
+  ASSERT_EQ(names.glob("TOP.ALU4.cmp4_*.out"),
+            (std::vector<signal_id_t>{std::min(names.find("TOP.ALU4.is_eq"), names.find("TOP.ALU4.is_rhs_bigger")),
+                                      std::max(names.find("TOP.ALU4.is_eq"), names.find("TOP.ALU4.is_rhs_bigger"))}));
+  ASSERT_EQ(names.glob("*carry*").size(), 2u);
+  ASSERT_TRUE(names.glob("nope*").empty());
+
+  const auto empty = name_index{scope_table{}};
+  ASSERT_EQ(empty.find("TOP.lhs"), invalid_signal_id);
+  ASSERT_TRUE(empty.prefix("").empty());
+  ASSERT_TRUE(empty.aliases(0).empty());
+}
+
+TEST(waver, typed_tokens) {
+  using namespace net::ancillarycat::waver;
+  // every keyword has a slot of its own
+  for (const auto &[keyword, kind] : keyword_table::entries) {
+    ASSERT_EQ(keyword_table::find(keyword), kind) << keyword;
+    ASSERT_EQ(keyword_table::text(kind), keyword);
+  }
+  static_assert(keyword_table::find("$enddefinitions") == token_kind::kEnddefinitions);
+  static_assert(token::classify("$upscope") == token_kind::kUpscope);
+  for (const auto word : {"$"sv, "$foo"sv, "$en"sv, "$endd"sv, "$End"sv, "$dumpvarsx"sv})
+    ASSERT_EQ(token::classify(word), token_kind::kUnknownKeyword) << word;
+
+  ASSERT_EQ(token::classify("#120"), token_kind::kTime);
+  ASSERT_EQ(token::classify("1!"), token_kind::kScalarChange);
+  ASSERT_EQ(token::classify("z%"), token_kind::kScalarChange);
+  ASSERT_EQ(token::classify("b0101"), token_kind::kVectorChange);
+  ASSERT_EQ(token::classify("r1.5"), token_kind::kVectorChange);
+  ASSERT_EQ(token::classify("module"), token_kind::kWord);
+  ASSERT_EQ(token::classify(""), token_kind::kEof);
+
+  auto lexer = net::ancillarycat::waver::lexer<>{};
+  ASSERT_TRUE(lexer.borrow("$scope module TOP $end\n#5\nb10 ! 0\" $end").ok());
+  ASSERT_TRUE(lexer.lex().ok());
+  auto kinds = std::vector<token_kind>{};
+  auto texts = std::vector<std::string_view>{};
+  for (auto token = lexer.consume(); not token.is(token_kind::kEof); token = lexer.consume()) {
+    kinds.emplace_back(token.kind());
+    texts.emplace_back(token.text());
+  }
+  ASSERT_EQ(kinds, (std::vector{token_kind::kScope, token_kind::kWord, token_kind::kWord, token_kind::kEnd,
+                                token_kind::kTime, token_kind::kVectorChange, token_kind::kWord,
+                                token_kind::kScalarChange, token_kind::kEnd}));
+  ASSERT_EQ(texts, (std::vector<std::string_view>{"$scope", "module", "TOP", "$end", "#5", "b10", "!", "0\"",
+                                                   "$end"}));
+
+  // every header keyword is dispatched, and anything else ends the header with an error
+  const auto scopes = std::string{"$scope module top $end $var wire 1 ! a $end $upscope $end "};
+  const auto body   = std::string{"$enddefinitions $end #0 1!"};
+  const auto dated  = value_change_dump::parse("$date today $end $version v $end " + scopes + body);
+  ASSERT_TRUE(dated.ok()) << dated.status();
+  ASSERT_FALSE(value_change_dump::parse("$date today $end " + scopes).ok());
+  ASSERT_FALSE(value_change_dump::parse("stray " + scopes + body).ok());
+  ASSERT_FALSE(value_change_dump::parse("$foo " + scopes + body).ok());
+
+  // and so is every keyword inside a scope, up to the end of the input
+  const auto commented =
+    value_change_dump::parse("$scope module top $end $comment a b $end $var wire 1 ! a $end $upscope $end " + body);
+  ASSERT_TRUE(commented.ok()) << commented.status();
+  ASSERT_EQ(commented->find_signal("top.a"), 0u);
+  ASSERT_FALSE(value_change_dump::parse("$scope module top $end stray $upscope $end " + body).ok());
+  ASSERT_FALSE(value_change_dump::parse(std::string{"$scope module top $end $var wire 1 ! a"}).ok());
+  ASSERT_FALSE(value_change_dump::parse(std::string{"$scope module top $end $var wire 1 ! a $end"}).ok());
+}
+
+TEST(waver, body_scanner) {
+  using namespace net::ancillarycat::waver;
+  const auto decode = [](const std::string_view digits) -> std::optional<std::pair<timestamp::time_t, std::size_t>> {
+    auto time = timestamp::time_t{};
+    if (const auto *end = body_scanner::decode_time(digits.data(), digits.data() + digits.size(), time))
+      return std::pair{time, static_cast<std::size_t>(end - digits.data())};
+    return std::nullopt;
+  };
+  ASSERT_EQ(decode("0"), (std::pair{0uz, 1uz}));
+  ASSERT_EQ(decode("1234567"), (std::pair{1234567uz, 7uz}));
+  ASSERT_EQ(decode("12345678"), (std::pair{12345678uz, 8uz}));
+  ASSERT_EQ(decode("120 1!\n"), (std::pair{120uz, 3uz}));
+  ASSERT_EQ(decode("123456789012345\n#5"), (std::pair{123456789012345uz, 15uz}));
+  ASSERT_EQ(decode("18446744073709551615"), (std::pair{18446744073709551615uz, 20uz}));
+  ASSERT_FALSE(decode("18446744073709551616"));
+  ASSERT_FALSE(decode(""));
+  ASSERT_FALSE(decode("x1234567"));
+
+  // the same dump either way, serially and in slices
+  for (const auto threads : {1uz, 2uz}) {
+    const auto scanned = value_change_dump::parse(vcd_string, {.threads = threads, .min_chunk_size = 1});
+    const auto lexed =
+      value_change_dump::parse(vcd_string, {.threads = threads, .min_chunk_size = 1, .byte_scanner = false});
+    ASSERT_TRUE(scanned.ok());
+    ASSERT_TRUE(lexed.ok());
+    ASSERT_EQ(scanned->as_json(), lexed->as_json());
+  }
+
+  const auto header = std::string{"$scope module top $end $var wire 1 ! a $end $var wire 4 \" b $end $upscope $end "
+                                  "$enddefinitions $end\n"};
+  const auto vcd =
+    value_change_dump::parse(header + "$dumpvars 0! bxxxx \" $end\n#0\n$comment #1 $end 1!\n#10\r\nb0101\t\"\n");
+  ASSERT_TRUE(vcd.ok());
+  ASSERT_EQ(vcd->as_json()["dumpvars"][0].size(), 2u);
+  ASSERT_EQ(vcd->value_changes.timestamps().size(), 2u);
+  ASSERT_EQ(vcd->value_changes.event_count(), 2u);
+  for (const auto *body : {"1!\n#0\n", "#0\n1?\n", "#0\nb01\n", "#0x\n1!\n", "$dumpvars #0 $end\n", "$dumpvars 1!\n",
+                           "#0 $comment 1!\n"})
+    ASSERT_FALSE(value_change_dump::parse(header + body).ok()) << body;
+}
+
 std::string vcd_string = R"(
 $version Generated by VerilatedVcd $end
 $timescale 1s $end